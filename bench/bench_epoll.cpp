@@ -0,0 +1,112 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "epoll.hpp"
+
+extern "C"
+{
+#include <sys/eventfd.h>
+}
+
+/** @brief Eventfds that stay readable, so every wait reports them all */
+struct ReadyFds
+{
+  explicit ReadyFds(size_t n)
+  {
+    uint64_t one = 1;
+
+    while (fds.size() < n)
+      {
+        auto &fd = fds.emplace_back(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+
+        if (::write(fd.fd(), &one, sizeof(one)) != sizeof(one))
+          {
+            throw std::system_error(errno, std::system_category(), "eventfd");
+          }
+      }
+  }
+
+  std::vector<Sukat::Fd> fds;
+};
+
+static void BM_EpollWait(benchmark::State &state)
+{
+  ReadyFds ready(state.range(0));
+  Sukat::Epoll epoll;
+  size_t dispatched = 0;
+
+  for (auto &fd : ready.fds)
+    {
+      if (!epoll.ctl(fd.fd()))
+        {
+          state.SkipWithError("epoll_ctl failed");
+          return;
+        }
+    }
+  for (auto _ : state)
+    {
+      epoll.wait([&](const struct epoll_event &ev) -> std::optional<int> {
+        benchmark::DoNotOptimize(ev.data.fd);
+        dispatched++;
+        return {};
+      });
+    }
+  state.SetItemsProcessed(dispatched);
+}
+BENCHMARK(BM_EpollWait)->Arg(1)->Arg(16)->Arg(128);
+
+static void BM_ReactorPoll(benchmark::State &state)
+{
+  ReadyFds ready(state.range(0));
+  Sukat::Reactor reactor;
+  size_t dispatched = 0;
+  Sukat::EventCallback<std::function<void(uint32_t)>> handler(
+    [&](uint32_t) { dispatched++; });
+
+  for (auto &fd : ready.fds)
+    {
+      if (!reactor.add(fd.fd(), handler))
+        {
+          state.SkipWithError("Reactor add failed");
+          return;
+        }
+    }
+  for (auto _ : state)
+    {
+      reactor.poll(0);
+    }
+  state.SetItemsProcessed(dispatched);
+}
+BENCHMARK(BM_ReactorPoll)->Arg(1)->Arg(16)->Arg(128);
+
+/** @brief Arm timers spread over a second and fire them all */
+static void BM_TimerWheel(benchmark::State &state)
+{
+  Sukat::TimerWheel wheel;
+  std::vector<std::unique_ptr<Sukat::Timer>> timers;
+  auto now = Sukat::TimerWheel::clock::now();
+  size_t fired = 0;
+
+  while (timers.size() < static_cast<size_t>(state.range(0)))
+    {
+      timers.emplace_back(std::make_unique<Sukat::Timer>([&]() { fired++; }));
+    }
+  for (auto _ : state)
+    {
+      size_t i = 0;
+
+      for (auto &timer : timers)
+        {
+          wheel.schedule(*timer, std::chrono::milliseconds(i++ % 1000));
+        }
+      // Jump ahead instead of sleeping. Delays count from the wheel's time
+      // once it's ahead of the clock, so keep clear of the last jump.
+      now += std::chrono::seconds(2);
+      wheel.advance(now);
+    }
+  state.SetItemsProcessed(fired);
+}
+BENCHMARK(BM_TimerWheel)->Arg(1)->Arg(1024);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,76 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <string_view>
+
+#include "logging.hpp"
+
+using namespace Sukat;
+
+/**
+ * The logger is set up once per process, pick the sink with
+ * SUKAT_BENCH_LOG=sync|async|binary. Lines go to SUKAT_BENCH_LOGFILE,
+ * /dev/null by default.
+ */
+static void setupLogger()
+{
+  const char *mode = std::getenv("SUKAT_BENCH_LOG");
+  const char *file = std::getenv("SUKAT_BENCH_LOGFILE");
+  const std::string logfile = (file) ? file : "/dev/null";
+
+  if (mode && std::string_view(mode) == "async")
+    {
+      Logger::initializeAsync(Logger::LogLevel::ERROR, logfile);
+    }
+  else if (mode && std::string_view(mode) == "binary")
+    {
+      Logger::initializeBinary(Logger::LogLevel::ERROR, logfile);
+    }
+  else
+    {
+      Logger::initialize(Logger::LogLevel::ERROR, logfile);
+    }
+}
+
+static void BM_LogDisabled(benchmark::State &state)
+{
+  int fd = 3;
+  size_t len = 1500;
+
+  Logger::setLevel(Logger::LogLevel::ERROR);
+  for (auto _ : state)
+    {
+      LOG_DBG("Sending ", len, " bytes to fd ", fd);
+      benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_LogDisabled);
+
+static void BM_LogEnabled(benchmark::State &state)
+{
+  int fd = 3;
+  size_t len = 1500;
+
+  Logger::setLevel(Logger::LogLevel::DEBUG);
+  for (auto _ : state)
+    {
+      LOG_DBG("Sending ", len, " bytes to fd ", fd);
+    }
+  Logger::flush();
+  Logger::setLevel(Logger::LogLevel::ERROR);
+  state.counters["dropped"] = Logger::dropped();
+}
+BENCHMARK(BM_LogEnabled)->Threads(1)->Threads(4);
+
+int main(int argc, char **argv)
+{
+  setupLogger();
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+      return EXIT_FAILURE;
+    }
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::Shutdown();
+  return EXIT_SUCCESS;
+}
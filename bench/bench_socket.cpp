@@ -0,0 +1,218 @@
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+
+#include "buffer.hpp"
+#include "socket.hpp"
+
+extern "C"
+{
+#include <sys/socket.h>
+#include <unistd.h>
+}
+
+/** @brief A connected client and its accepted peer over loopback */
+struct Pair
+{
+  explicit Pair(__socket_type type, int family)
+    : listener(makeListener(type, family)),
+      client(makeClient(type, family, *listener))
+  {
+    if (type == SOCK_DGRAM)
+      {
+        // The UDP listener accepts a peer from, and consumes, its first
+        // datagram.
+        client.write("hello");
+      }
+    auto accepted = listener->accept();
+
+    if (accepted.size() != 1)
+      {
+        throw std::runtime_error("Failed to accept benchmark peer");
+      }
+    server.emplace(std::move(accepted.front()));
+    client.ready(1000);
+  }
+
+  static std::unique_ptr<Sukat::SocketListener> makeListener(
+    __socket_type type, int family)
+  {
+    if (type == SOCK_DGRAM)
+      {
+        return std::make_unique<Sukat::SocketListenerUdp>(family);
+      }
+    if (family == AF_UNIX)
+      {
+        return std::make_unique<Sukat::SocketListenerStream>(
+          Sukat::Socket::make_endpoint(socketPath(), true));
+      }
+    return std::make_unique<Sukat::SocketListenerStream>(family);
+  }
+
+  static Sukat::SocketConnection makeClient(
+    __socket_type type, int family, const Sukat::SocketListener &listener)
+  {
+    if (family == AF_UNIX)
+      {
+        auto path = socketPath();
+
+        return Sukat::SocketConnection(path, true);
+      }
+    return Sukat::SocketConnection(type, listener.getSource().value());
+  }
+
+  static std::filesystem::path socketPath()
+  {
+    return "sukat-bench-" + std::to_string(::getpid());
+  }
+
+  /** @brief Read until something arrives. Loopback delivers right away. */
+  static size_t drain(const Sukat::SocketConnection &conn, Sukat::Buffer &buf)
+  {
+    size_t total = 0;
+
+    buf.clear();
+    while (!total)
+      {
+        auto res = conn.read(buf);
+
+        if (res.status == Sukat::SocketConnection::readStatus::READ_ERROR ||
+            res.status == Sukat::SocketConnection::readStatus::READ_EOF)
+          {
+            throw std::runtime_error("Benchmark peer failed");
+          }
+        total += res.bytes;
+      }
+    return total;
+  }
+
+  std::unique_ptr<Sukat::SocketListener> listener;
+  Sukat::SocketConnection client;
+  std::optional<Sukat::SocketConnection> server;
+};
+
+static void BM_PingPong(benchmark::State &state, __socket_type type,
+                        int family)
+{
+  Pair pair(type, family);
+  const std::string msg(state.range(0), 'x');
+  Sukat::Buffer buf(65536);
+
+  for (auto _ : state)
+    {
+      pair.client.write(msg);
+      Pair::drain(*pair.server, buf);
+      pair.server->write(msg);
+      Pair::drain(pair.client, buf);
+    }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_PingPong, tcp, SOCK_STREAM, AF_INET)->Arg(1)->Arg(1024);
+BENCHMARK_CAPTURE(BM_PingPong, unix, SOCK_STREAM, AF_UNIX)->Arg(1)->Arg(1024);
+BENCHMARK_CAPTURE(BM_PingPong, udp, SOCK_DGRAM, AF_INET)->Arg(1)->Arg(1024);
+
+/** @brief Client streams chunks, server reads them into a reused Buffer */
+static void BM_BulkRead(benchmark::State &state, __socket_type type,
+                        int family)
+{
+  Pair pair(type, family);
+  const std::string chunk(state.range(0), 'x');
+  Sukat::Buffer buf(state.range(0));
+  size_t bytes = 0;
+
+  for (auto _ : state)
+    {
+      int sent = pair.client.write(chunk);
+
+      if (sent <= 0)
+        {
+          state.SkipWithError("Write failed");
+          break;
+        }
+      // Keep the socket buffers from filling up.
+      for (size_t got = 0; got < static_cast<size_t>(sent);)
+        {
+          got += Pair::drain(*pair.server, buf);
+        }
+      bytes += sent;
+    }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK_CAPTURE(BM_BulkRead, tcp, SOCK_STREAM, AF_INET)
+  ->Arg(4096)
+  ->Arg(65536);
+BENCHMARK_CAPTURE(BM_BulkRead, unix, SOCK_STREAM, AF_UNIX)
+  ->Arg(4096)
+  ->Arg(65536);
+
+/** @brief Same through the allocating readData() */
+static void BM_BulkReadData(benchmark::State &state)
+{
+  Pair pair(SOCK_STREAM, AF_INET);
+  const std::string chunk(state.range(0), 'x');
+  size_t bytes = 0;
+
+  for (auto _ : state)
+    {
+      int sent = pair.client.write(chunk);
+
+      if (sent <= 0)
+        {
+          state.SkipWithError("Write failed");
+          break;
+        }
+      for (size_t got = 0; got < static_cast<size_t>(sent);)
+        {
+          got += pair.server->readData().view().size();
+        }
+      bytes += sent;
+    }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_BulkReadData)->Arg(4096)->Arg(65536);
+
+static void BM_AcceptStream(benchmark::State &state)
+{
+  Sukat::SocketListenerStream listener(AF_INET);
+  auto dst = listener.getSource().value();
+  const struct linger reset = {.l_onoff = 1, .l_linger = 0};
+  const unsigned int batch = state.range(0);
+  size_t accepted = 0;
+
+  for (auto _ : state)
+    {
+      std::vector<Sukat::SocketConnection> clients;
+      unsigned int i;
+
+      for (i = 0; i < batch; i++)
+        {
+          auto &conn = clients.emplace_back(SOCK_STREAM, dst);
+
+          // Close with RST, TIME_WAIT would run out of ports.
+          ::setsockopt(conn.fd(), SOL_SOCKET, SO_LINGER, &reset,
+                       sizeof(reset));
+        }
+      accepted += listener.accept().size();
+    }
+  state.SetItemsProcessed(accepted);
+}
+BENCHMARK(BM_AcceptStream)->Arg(1)->Arg(16);
+
+static void BM_AcceptUdp(benchmark::State &state)
+{
+  Sukat::SocketListenerUdp listener(AF_INET);
+  auto dst = listener.getSource().value();
+  size_t accepted = 0;
+
+  for (auto _ : state)
+    {
+      Sukat::SocketConnection client(SOCK_DGRAM, dst);
+
+      client.write("hello");
+      accepted += listener.accept().size();
+    }
+  state.SetItemsProcessed(accepted);
+}
+BENCHMARK(BM_AcceptUdp);
+
+BENCHMARK_MAIN();
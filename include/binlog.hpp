@@ -0,0 +1,213 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace Sukat
+{
+/** @brief Encoding of the Logger binary sink
+ *
+ * A log starts with magic followed by records, each prefixed by its length
+ * as a host order uint32_t. A site record describes a log call site once:
+ * level, file, line and the text of its literal arguments. A line record
+ * names its site by id and carries a timestamp and the remaining arguments,
+ * numbers and void pointers as raw values. Anything else is formatted by
+ * the caller, as the object may be gone by the time the log is read.
+ *
+ * Arguments of const char array type are taken for literals and stored only
+ * in the site record, so a const array logged with varying contents from the
+ * same call site would show its first contents.
+ *
+ * Rendering back to text lines is done by decode(), typically offline with
+ * Cpplogdecode.
+ */
+class BinaryLog
+{
+ public:
+  static constexpr std::string_view magic{"SUKATLG1"};
+
+  enum class recordType : uint8_t
+  {
+    RECORD_SITE,   //!< Call site definition.
+    RECORD_LINE,   //!< One logged line.
+    RECORD_DROPPED //!< Lines dropped on full rings.
+  };
+
+  enum class argType : uint8_t
+  {
+    ARG_LITERAL, //!< In site records only, text follows.
+    ARG_DYNAMIC, //!< In site records only, value is in each line.
+    ARG_BOOL,
+    ARG_CHAR,
+    ARG_INT,
+    ARG_UINT,
+    ARG_DOUBLE,
+    ARG_STRING,
+    ARG_POINTER
+  };
+
+  /** @brief Is an argument of type \p T stored in the site record */
+  template <typename T> static constexpr bool isLiteral()
+  {
+    using ref = std::remove_reference_t<T>;
+
+    return std::is_array_v<ref> &&
+           std::is_same_v<std::remove_extent_t<ref>, const char>;
+  }
+
+  /** @brief Append the site record of call site \p id to \p out */
+  template <typename... Args>
+  static void encodeSite(std::string &out, uint32_t id, int lvl,
+                         std::string_view file, int line,
+                         const Args &... args)
+  {
+    const size_t start = begin(out, recordType::RECORD_SITE);
+
+    put<uint32_t>(out, id);
+    put<uint8_t>(out, lvl);
+    put<uint32_t>(out, line);
+    putString(out, file);
+    put<uint16_t>(out, sizeof...(args));
+    (siteArg<Args>(out, args), ...);
+    end(out, start);
+  }
+
+  /** @brief Append a line record of site \p id to \p out */
+  template <typename... Args>
+  static void encodeLine(std::string &out, uint32_t id, uint64_t ns,
+                         Args &&... args)
+  {
+    const size_t start = begin(out, recordType::RECORD_LINE);
+
+    put<uint32_t>(out, id);
+    put<uint64_t>(out, ns);
+    (lineArg<Args>(out, std::forward<Args>(args)), ...);
+    end(out, start);
+  }
+
+  /** @brief Append a record of \p count dropped lines to \p out */
+  static void encodeDropped(std::string &out, uint64_t count)
+  {
+    const size_t start = begin(out, recordType::RECORD_DROPPED);
+
+    put<uint64_t>(out, count);
+    end(out, start);
+  }
+
+  /**
+   * @brief Render the binary log in \p in as text lines to \p out.
+   *
+   * Each line is the text sink's line, prefixed with its timestamp as
+   * seconds.nanoseconds since the epoch. Lines whose site record was lost,
+   * e.g. dropped on a full ring, are skipped and counted in a final line.
+   *
+   * @return Number of lines rendered.
+   *
+   * @throw std::runtime_error On bad magic or a malformed record.
+   */
+  static size_t decode(std::istream &in, std::ostream &out);
+
+ private:
+  template <typename T> static void put(std::string &out, T value)
+  {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+
+  static void putString(std::string &out, std::string_view str)
+  {
+    put<uint32_t>(out, str.size());
+    out.append(str);
+  }
+
+  static size_t begin(std::string &out, recordType type)
+  {
+    const size_t start = out.size();
+
+    put<uint32_t>(out, 0);
+    put(out, type);
+    return start;
+  }
+
+  static void end(std::string &out, size_t start)
+  {
+    const uint32_t len = out.size() - start - sizeof(uint32_t);
+
+    std::memcpy(&out[start], &len, sizeof(len));
+  }
+
+  template <typename T> static void siteArg(std::string &out, const auto &arg)
+  {
+    if constexpr (isLiteral<T>())
+      {
+        put(out, argType::ARG_LITERAL);
+        putString(out, std::string_view(arg));
+      }
+    else
+      {
+        put(out, argType::ARG_DYNAMIC);
+      }
+  }
+
+  template <typename T> static void lineArg(std::string &out, auto &&arg)
+  {
+    using type = std::remove_cvref_t<T>;
+
+    if constexpr (isLiteral<T>())
+      {
+      }
+    else if constexpr (std::is_same_v<type, bool>)
+      {
+        put(out, argType::ARG_BOOL);
+        put<uint8_t>(out, arg);
+      }
+    else if constexpr (std::is_same_v<type, char> ||
+                       std::is_same_v<type, signed char> ||
+                       std::is_same_v<type, unsigned char>)
+      {
+        put(out, argType::ARG_CHAR);
+        put<char>(out, arg);
+      }
+    else if constexpr (std::is_integral_v<type> && std::is_signed_v<type>)
+      {
+        put(out, argType::ARG_INT);
+        put<int64_t>(out, arg);
+      }
+    else if constexpr (std::is_integral_v<type>)
+      {
+        put(out, argType::ARG_UINT);
+        put<uint64_t>(out, arg);
+      }
+    else if constexpr (std::is_floating_point_v<type>)
+      {
+        put(out, argType::ARG_DOUBLE);
+        put<double>(out, arg);
+      }
+    else if constexpr (std::is_convertible_v<const type &, std::string_view>)
+      {
+        put(out, argType::ARG_STRING);
+        putString(out, std::string_view(arg));
+      }
+    else if constexpr (std::is_pointer_v<type> &&
+                       std::is_void_v<std::remove_pointer_t<type>>)
+      {
+        put(out, argType::ARG_POINTER);
+        put<uint64_t>(out, reinterpret_cast<uintptr_t>(arg));
+      }
+    else
+      {
+        // Own operator<<, e.g. a Socket pointer, formatted now.
+        std::ostringstream formatted;
+
+        formatted << arg;
+        put(out, argType::ARG_STRING);
+        putString(out, formatted.view());
+      }
+  }
+};
+} // namespace Sukat
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "bufferpool.hpp"
+
+extern "C"
+{
+#include <stdio.h>
+}
+
+namespace Sukat
+{
+/** @brief Caller owned, reusable byte buffer for the receive path.
+ *
+ * Linear storage with a read and a write cursor. Data is received straight
+ * into writable() and consumed from readable(). Once all data is consumed the
+ * cursors rewind, and compact() moves a leftover tail to the front, so a
+ * buffer reused across reads never allocates after construction.
+ *
+ * The storage is either owned or a BufferPool slab, which goes back to the
+ * pool with the buffer.
+ */
+class Buffer
+{
+ public:
+  explicit Buffer(size_t capacity = BUFSIZ)
+    : mOwned(capacity), mData(mOwned){};
+
+  /** @brief Use a pooled slab as storage */
+  explicit Buffer(BufferPool::Handle slab)
+    : mSlab(std::move(slab)), mData(mSlab.data()){};
+
+  Buffer(Buffer &&other) = default;
+  Buffer &operator=(Buffer &&other) = default;
+  Buffer(const Buffer &) = delete;
+
+  /** @brief Free space after the written data. */
+  std::span<uint8_t> writable()
+  {
+    return {mData.data() + mWrite, mData.size() - mWrite};
+  }
+
+  /** @brief Data written but not yet consumed. */
+  std::span<const uint8_t> readable() const
+  {
+    return {mData.data() + mRead, mWrite - mRead};
+  }
+
+  /** @brief readable() as characters. */
+  std::string_view view() const
+  {
+    return {reinterpret_cast<const char *>(mData.data()) + mRead,
+            mWrite - mRead};
+  }
+
+  /** @brief Mark \p n bytes of writable() as filled. */
+  void commit(size_t n)
+  {
+    mWrite += std::min(n, mData.size() - mWrite);
+  }
+
+  /** @brief Drop \p n bytes from the start of readable(). */
+  void consume(size_t n)
+  {
+    mRead += std::min(n, mWrite - mRead);
+    if (mRead == mWrite)
+      {
+        clear();
+      }
+  }
+
+  /** @brief Move unconsumed data to the front to make room at the end. */
+  void compact()
+  {
+    if (mRead)
+      {
+        ::memmove(mData.data(), mData.data() + mRead, mWrite - mRead);
+        mWrite -= mRead;
+        mRead = 0;
+      }
+  }
+
+  void clear()
+  {
+    mRead = mWrite = 0;
+  }
+
+  size_t size() const
+  {
+    return mWrite - mRead;
+  }
+
+  bool empty() const
+  {
+    return mWrite == mRead;
+  }
+
+  size_t capacity() const
+  {
+    return mData.size();
+  }
+
+ private:
+  std::vector<uint8_t> mOwned;
+  BufferPool::Handle mSlab;
+  std::span<uint8_t> mData; //!< Whichever of the above is in use.
+  size_t mRead{0};  //!< Offset of first unconsumed byte.
+  size_t mWrite{0}; //!< Offset of first free byte.
+};
+} // namespace Sukat
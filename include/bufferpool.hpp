@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <utility>
+
+namespace Sukat
+{
+/** @brief Fixed size buffers recycled through per-thread free lists
+ *
+ * Slabs are carved from blocks allocated on demand and kept until the pool
+ * and all its handles are gone, so in steady state taking and returning a
+ * slab never allocates. A pool belongs to the thread that created it: get()
+ * is owner thread only and pops a plain free list. The last handle to a
+ * slab may be dropped on any thread, slabs released elsewhere are pushed
+ * on a lock-free stack the owner takes over on its next get().
+ *
+ * Receive paths should hold a slab only while data is pending, so idle
+ * connections cost no buffer memory. local() gives every thread its own
+ * pool, e.g. each ConnectionHub worker.
+ */
+class BufferPool
+{
+  struct state;
+
+  struct slab
+  {
+    state *owner;
+    std::atomic<uint32_t> refs;
+    uint32_t size;
+    slab *next; //!< Free list link.
+
+    uint8_t *data()
+    {
+      return reinterpret_cast<uint8_t *>(this) + headerSize;
+    }
+  };
+
+ public:
+  /** @brief Shared reference to one slab
+   *
+   * Copies share the slab, which goes back to its pool with the last one.
+   */
+  class Handle
+  {
+   public:
+    Handle() = default;
+
+    Handle(const Handle &other) : mSlab(other.mSlab)
+    {
+      if (mSlab)
+        {
+          mSlab->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    Handle(Handle &&other) noexcept
+      : mSlab(std::exchange(other.mSlab, nullptr))
+    {
+    }
+
+    Handle &operator=(Handle other) noexcept
+    {
+      std::swap(mSlab, other.mSlab);
+      return *this;
+    }
+
+    ~Handle()
+    {
+      reset();
+    }
+
+    /** @brief Drop this reference */
+    void reset()
+    {
+      if (mSlab && mSlab->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+          release(mSlab);
+        }
+      mSlab = nullptr;
+    }
+
+    /** @brief The whole slab, empty for a null handle */
+    std::span<uint8_t> data() const
+    {
+      return (mSlab) ? std::span<uint8_t>(mSlab->data(), mSlab->size)
+                     : std::span<uint8_t>();
+    }
+
+    /** @brief Handles sharing the slab */
+    uint32_t useCount() const
+    {
+      return (mSlab) ? mSlab->refs.load(std::memory_order_relaxed) : 0;
+    }
+
+    explicit operator bool() const
+    {
+      return mSlab;
+    }
+
+   private:
+    friend class BufferPool;
+
+    explicit Handle(slab *s) : mSlab(s){};
+
+    slab *mSlab{nullptr};
+  };
+
+  /**
+   * @param slab_size           Usable bytes per slab.
+   * @param slabs_per_block     Slabs carved from one heap allocation.
+   */
+  BufferPool(size_t slab_size = 16384, size_t slabs_per_block = 64);
+
+  /** @brief Slabs still referenced stay valid until their last handle. */
+  ~BufferPool();
+
+  BufferPool(const BufferPool &) = delete;
+
+  /** @brief Take a slab. Owner thread only.
+   *
+   * @throw std::bad_alloc If a new block is needed and can't be allocated.
+   */
+  Handle get();
+
+  size_t slabSize() const;
+
+  /** @brief Slabs carved so far. Owner thread only. */
+  size_t allocated() const;
+
+  /** @brief Slabs on the owner's free list. Owner thread only.
+   *
+   * Slabs released on other threads count once get() has collected them.
+   */
+  size_t available() const;
+
+  /** @brief The calling thread's own pool with default sizes */
+  static BufferPool &local();
+
+ private:
+  static constexpr size_t headerSize = 64; //!< Keeps slab data aligned.
+
+  static void release(slab *s) noexcept;
+
+  state *mState;
+};
+} // namespace Sukat
@@ -1,16 +1,108 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "epoll.hpp"
+#include "mpscqueue.hpp"
+#include "registry.hpp"
 #include "socket.hpp"
 
 namespace Sukat
 {
+/** @brief Connections sharded over a pool of reactor threads
+ *
+ * Each worker thread owns a Reactor and the connections assigned to it, so
+ * a connection is only ever touched from its owner thread. Other threads
+ * hand work to the owner through a lock-free queue signalled by an eventfd.
+ */
 class ConnectionHub
 {
 public:
-  int connect(int type, const std::string &dst, const std::string &port);
+  /** @brief How new connections are spread over the workers */
+  enum class assignPolicy
+  {
+    ASSIGN_LEAST_LOADED, //!< Worker with fewest connections.
+    ASSIGN_HASH          //!< Hash of the connection fd.
+  };
+
+  /** @brief Identifies a connection and its owner thread */
+  struct connectionId
+  {
+    unsigned int worker;
+    int fd;
+    uint64_t serial; //!< Unique per add(), so stale ids miss reused fds.
+  };
+
+  /**
+   * @brief Callback per connection event, run on the owner thread.
+   *
+   * EPOLLOUT is reported once when a pending connect finishes, after that
+   * the connection is polled for EPOLLIN.
+   *
+   * @return false to close the connection.
+   */
+  using eventCb =
+    std::function<bool(SocketConnection &conn, uint32_t events)>;
+
+  /** @brief Work posted to a connection's owner thread */
+  using workCb = std::function<void(SocketConnection &conn)>;
+
+  /**
+   * @param cb          Callback per connection event.
+   * @param n_threads   Number of reactor threads.
+   * @param policy      Assignment of new connections.
+   */
+  ConnectionHub(eventCb cb,
+                unsigned int n_threads = std::thread::hardware_concurrency(),
+                assignPolicy policy = assignPolicy::ASSIGN_LEAST_LOADED);
+
+  /** @brief Stops all workers and closes their connections. */
+  ~ConnectionHub();
+
+  ConnectionHub(const ConnectionHub &) = delete;
+
+  /**
+   * @brief Connect to \p dst and hand the connection to a worker.
+   *
+   * \p dst is resolved with a blocking lookup on the calling thread, use
+   * add() with a Resolver or Connector result where that matters.
+   *
+   * @throw std::system_error On resolve or connect failure.
+   */
+  connectionId connect(int type, const std::string &dst,
+                       const std::string &port);
+
+  /** @brief Hand an existing connection, e.g. an accepted one, to a worker */
+  connectionId add(SocketConnection &&conn);
+
+  /** @brief Run \p work on the owner thread of \p id
+   *
+   * Work for a connection closed in the meantime is dropped.
+   */
+  void post(connectionId id, workCb work);
+
+  /** @brief Close a connection on its owner thread */
+  void remove(connectionId id);
+
+  /** @brief Total number of connections across workers */
+  size_t size() const;
+
+  /** @brief Number of worker threads */
+  size_t workers() const
+  {
+    return mWorkers.size();
+  }
+
  private:
-  int efd;
-  std::map<int, std::unique_ptr<Sukat::Socket>> conns;
+  class Worker;
+
+  const eventCb mCb;
+  const assignPolicy mPolicy;
+  std::atomic<uint64_t> mSerial{0};
+  std::vector<std::unique_ptr<Worker>> mWorkers;
 };
 } // namespace Sukat
-
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "epoll.hpp"
+#include "socket.hpp"
+#include "timerwheel.hpp"
+
+namespace Sukat
+{
+/** @brief Parallel connect over a set of end-points (Happy Eyeballs)
+ *
+ * Candidates are interleaved by address family as in RFC 8305, so a broken
+ * IPv6 path costs one attempt delay instead of a connect timeout. A new
+ * attempt starts every attempt delay, or right away when one fails, while
+ * earlier ones keep running. The first to connect wins and the rest are
+ * closed.
+ *
+ * Attempts and the stagger and timeout timers live on the given Reactor.
+ */
+class Connector
+{
+ public:
+  /**
+   * @brief Result of the race.
+   *
+   * @param conn        Connected socket, none if every candidate failed.
+   * @param error       errno of the last failure when \p conn is none.
+   *
+   * The Connector may be destroyed from within the callback.
+   */
+  using connectCb =
+    std::function<void(std::optional<SocketConnection> &&conn, int error)>;
+
+  /**
+   * @param reactor     Loop to run the attempts on.
+   * @param endpoints   Candidates in preference order, e.g. a
+   *                    Resolver::result.
+   * @param delay       Head start of each attempt over the next, RFC 8305
+   *                    recommends 250ms.
+   */
+  Connector(Reactor &reactor, const std::vector<Socket::endpoint> &endpoints,
+            __socket_type type, connectCb cb,
+            std::chrono::milliseconds delay = std::chrono::milliseconds(250));
+
+  /** @brief Same from an AddrInfo result set */
+  Connector(Reactor &reactor, const AddrInfo &info, connectCb cb,
+            std::chrono::milliseconds delay = std::chrono::milliseconds(250));
+
+  /** @brief Closes attempts still running, the callback is not called. */
+  ~Connector();
+
+  Connector(const Connector &) = delete;
+
+  /** @brief Give up with ETIMEDOUT if not connected within \p timeout
+   *
+   * Covers the whole race from start(). Zero, the default, waits for the
+   * kernel's own connect timeout.
+   */
+  void setTimeout(std::chrono::milliseconds timeout)
+  {
+    mTimeout = timeout;
+  }
+
+  /** @brief Launch the first attempt. */
+  void start();
+
+  /** @brief Reorder \p endpoints to alternate address families
+   *
+   * The family of the first end-point goes first, as the resolver already
+   * sorted by preference (RFC 6724).
+   */
+  static std::vector<Socket::endpoint>
+  interleave(const std::vector<Socket::endpoint> &endpoints);
+
+  /** @brief Attempts currently running */
+  size_t running() const
+  {
+    return mAttempts.size();
+  }
+
+ private:
+  class Attempt;
+
+  /** @brief Start the next candidate, if any. False if none was left. */
+  bool next();
+  void stopTimers();
+  void finished(Attempt &attempt, uint32_t events);
+  void fail(int error);
+
+  Reactor &mReactor;
+  const __socket_type mType;
+  const connectCb mCb;
+  const std::chrono::milliseconds mDelay;
+  std::chrono::milliseconds mTimeout{0};
+  std::vector<Socket::endpoint> mCandidates;
+  size_t mNext{0};
+  int mError{0}; //!< Last failure.
+  std::vector<std::unique_ptr<Attempt>> mAttempts;
+  Timer mStagger;
+  Timer mDeadline;
+};
+} // namespace Sukat
@@ -4,6 +4,8 @@
 #include <map>
 #include <sstream>
 #include <optional>
+#include <system_error>
+#include <vector>
 
 extern "C"
 {
@@ -14,6 +16,7 @@ extern "C"
 
 #include "fd.hpp"
 #include "logging.hpp"
+#include "timerwheel.hpp"
 
 namespace Sukat
 {
@@ -62,15 +65,17 @@ class Epoll
     const unsigned int max_events = 128;
     struct epoll_event ev[max_events];
 
-    if (int ret = epoll_wait(mEfd.fd(), ev, max_events, timeout) >= 0)
+    if (int ret = epoll_wait(mEfd.fd(), ev, max_events, timeout); ret >= 0)
       {
         const unsigned int n_events = ret;
         unsigned int i;
 
         for (i = 0; i < n_events; i++)
           {
-            LOG_DBG("Events: ", ev[i].events, ", data: ptr:", ev[i].data.ptr,
-                    ", fd: ", ev[i].data.fd);
+            // Copies, packed fields can't bind to the forwarding refs.
+            LOG_DBG("Events: ", uint32_t{ev[i].events},
+                    ", data: ptr:", static_cast<void *>(ev[i].data.ptr),
+                    ", fd: ", int{ev[i].data.fd});
             auto func_ret = func(ev[i]);
 
             if (func_ret)
@@ -124,4 +129,170 @@ class Epoll
  private:
   const Fd mEfd{-1};
 };
+
+/** @brief Receiver of events for a fd registered to a Reactor */
+class EventHandler
+{
+ public:
+  virtual ~EventHandler() = default;
+
+  /** @brief Called with the epoll events that fired for the fd */
+  virtual void handleEvent(uint32_t events) = 0;
+};
+
+/** @brief EventHandler calling a stored callable, without type erasure */
+template <typename Func> class EventCallback : public EventHandler
+{
+ public:
+  EventCallback(Func func) : mFunc(std::move(func)){};
+
+  virtual void handleEvent(uint32_t events) override
+  {
+    mFunc(events);
+  }
+
+ private:
+  Func mFunc;
+};
+
+/** @brief Single threaded event loop on one epoll fd
+ *
+ * Handlers are registered once per fd and stored in epoll_data.ptr, so an
+ * event is dispatched straight to its handler without any lookup. Passing
+ * EPOLLET in the events makes the registration edge-triggered, in which case
+ * the handler must drain the fd on every call.
+ *
+ * Timers run on the same thread from a TimerWheel, whose next expiry bounds
+ * the epoll_wait timeout, so they cost no extra fds or syscalls.
+ */
+class Reactor
+{
+ public:
+  /** @param max_events Events fetched per epoll_wait. */
+  explicit Reactor(size_t max_events = 128) : mEvents(max_events){};
+
+  Reactor(const Reactor &) = delete;
+
+  /** @brief Register \p fd. \p handler must outlive the registration. */
+  [[nodiscard]] bool add(int fd, EventHandler &handler,
+                         uint32_t events = EPOLLIN) const
+  {
+    return mEpoll.ctl(fd, EPOLL_CTL_ADD, events, epoll_data_t{.ptr = &handler});
+  }
+
+  /** @brief Change the events or handler of a registered fd */
+  [[nodiscard]] bool modify(int fd, EventHandler &handler,
+                            uint32_t events) const
+  {
+    return mEpoll.ctl(fd, EPOLL_CTL_MOD, events, epoll_data_t{.ptr = &handler});
+  }
+
+  /** @brief Unregister \p fd.
+   *
+   * Safe to call from within a handler: events still pending for
+   * \p handler in the current batch are discarded, so it may be destroyed
+   * right after.
+   */
+  bool remove(int fd, const EventHandler &handler)
+  {
+    size_t i;
+
+    for (i = mDispatched; i < mPending; i++)
+      {
+        if (mEvents[i].data.ptr == &handler)
+          {
+            mEvents[i].data.ptr = nullptr;
+          }
+      }
+    return mEpoll.ctl(fd, EPOLL_CTL_DEL);
+  }
+
+  /** @brief Fire \p timer after \p delay, from within poll() */
+  void schedule(Timer &timer, std::chrono::milliseconds delay)
+  {
+    mTimers.schedule(timer, delay);
+  }
+
+  TimerWheel &timers()
+  {
+    return mTimers;
+  }
+
+  /**
+   * @brief Wait for and dispatch one batch of events, then due timers.
+   *
+   * \p timeout is cut short if a timer is due earlier.
+   *
+   * @return Number of events and timers dispatched.
+   *
+   * @throw std::system_error On epoll_wait failure other than EINTR.
+   */
+  size_t poll(int timeout = -1)
+  {
+    if (auto next = mTimers.timeout())
+      {
+        const int due = std::min<int64_t>(next->count(), INT32_MAX);
+
+        timeout = (timeout < 0) ? due : std::min(timeout, due);
+      }
+
+    int ret = epoll_wait(mEpoll.fd(), mEvents.data(), mEvents.size(), timeout);
+
+    if (ret < 0)
+      {
+        if (errno == EINTR)
+          {
+            return mTimers.advance();
+          }
+        throw std::system_error(errno, std::system_category(),
+                                "failed to wait for events");
+      }
+    mPending = ret;
+    for (mDispatched = 0; mDispatched < mPending;)
+      {
+        const struct epoll_event &ev = mEvents[mDispatched++];
+
+        if (ev.data.ptr)
+          {
+            static_cast<EventHandler *>(ev.data.ptr)->handleEvent(ev.events);
+          }
+      }
+    mPending = mDispatched = 0;
+    return ret + mTimers.advance();
+  }
+
+  /**
+   * @brief Dispatch events until stop() is called.
+   *
+   * @return Code given to stop().
+   */
+  int run(int timeout = -1)
+  {
+    mStopped.reset();
+    while (!mStopped)
+      {
+        poll(timeout);
+      }
+    return mStopped.value();
+  }
+
+  /** @brief Make run() return \p code after the current batch */
+  void stop(int code = 0)
+  {
+    mStopped = code;
+  }
+
+  int fd()
+  {
+    return mEpoll.fd();
+  }
+
+ private:
+  Epoll mEpoll;
+  std::vector<struct epoll_event> mEvents;
+  size_t mPending{0};    //!< Events in current batch.
+  size_t mDispatched{0}; //!< Events of current batch already handled.
+  std::optional<int> mStopped;
+  TimerWheel mTimers;
+};
 }; // namespace Sukat
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "buffer.hpp"
+#include "fd.hpp"
+
+namespace Sukat
+{
+/** @brief Moves bytes from one fd to another without a userspace copy
+ *
+ * Regular file sources go out with sendfile(), anything else is spliced
+ * through a pipe owned by the forwarder, so e.g. socket to socket or pipe
+ * to socket relays never touch userspace. Ends splice does not support get
+ * a plain read()/write() relay through a Buffer as a fallback.
+ *
+ * Both fds stay owned by the caller. They should be non-blocking, except
+ * regular files which are always ready and can not be polled.
+ */
+class Forwarder
+{
+ public:
+  /** @brief Why forward() returned */
+  enum class forwardStatus
+  {
+    FWD_IN_AGAIN,  //!< Source drained, wait for it to become readable.
+    FWD_OUT_AGAIN, //!< Destination full, wait for it to become writable.
+    FWD_EOF,       //!< Source closed and everything was delivered.
+    FWD_ERROR      //!< Either end failed, see forwardResult::error.
+  };
+
+  struct forwardResult
+  {
+    forwardStatus status;
+    size_t bytes; //!< Bytes delivered to the destination on this call.
+    int error;    //!< errno on FWD_ERROR.
+  };
+
+  /**
+   * @param in          Source fd.
+   * @param out         Destination fd.
+   * @param pipe_size   Capacity of the splice pipe, 0 for the system default.
+   *
+   * @throw std::system_error If the splice pipe can not be created.
+   */
+  Forwarder(int in, int out, size_t pipe_size = 0);
+
+  Forwarder(const Forwarder &) = delete;
+
+  /** @brief Move data until either end would block or the source ends
+   *
+   * @param max Stop reading after about this many bytes, so one busy
+   *            relay does not starve others on the same thread. Returns
+   *            FWD_IN_AGAIN then, with the source still readable.
+   */
+  forwardResult forward(size_t max = SIZE_MAX) noexcept;
+
+  /** @brief Bytes read from the source but not yet delivered */
+  size_t pending() const
+  {
+    return (mBuf) ? mBuf->size() : mPending;
+  }
+
+  int in() const
+  {
+    return mIn;
+  }
+
+  int out() const
+  {
+    return mOut;
+  }
+
+ private:
+  enum class mode
+  {
+    MODE_SENDFILE,
+    MODE_SPLICE,
+    MODE_COPY
+  };
+
+  /** @brief Fill the pipe or buffer from the source. */
+  ssize_t pull(size_t len);
+
+  /** @brief Drain the pipe or buffer to the destination. */
+  ssize_t push(size_t len);
+
+  /** @brief Switch to MODE_COPY, moving pending pipe data to the buffer. */
+  bool fallback();
+
+  const int mIn, mOut;
+  mode mMode;
+  std::optional<Fd> mPipeRd, mPipeWr;
+  size_t mPipeSize{0};
+  size_t mPending{0};         //!< Bytes sitting in the pipe.
+  std::optional<Buffer> mBuf; //!< Only after a fallback to MODE_COPY.
+  bool mEof{false};
+};
+} // namespace Sukat
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+namespace Sukat
+{
+/** @brief Log-linear histogram of unsigned values, HdrHistogram style
+ *
+ * Values below 2^(precision + 1) are counted exactly, larger ones in
+ * buckets 2^-precision of their magnitude wide, so any recorded value is
+ * reported within that relative error. Recording is an index computation
+ * and an increment, no allocation. The full 64 bit range is covered by
+ * (65 - precision) * 2^precision counters, about 58KB at the default
+ * precision of 7 bits (< 1% error).
+ */
+class Histogram
+{
+ public:
+  explicit Histogram(unsigned int precision = 7);
+
+  /** @brief Count \p count occurrences of \p value */
+  void record(uint64_t value, uint64_t count = 1)
+  {
+    mCounts[index(value)] += count;
+    mTotal += count;
+    mSum += value * count;
+    mMin = std::min(mMin, value);
+    mMax = std::max(mMax, value);
+  }
+
+  /** @brief Add the counts of \p other, which must have the same precision */
+  void merge(const Histogram &other);
+
+  void reset();
+
+  /** @brief Value at or below which \p percentile percent of values fall
+   *
+   * Reported as the highest value of its bucket, capped to max().
+   */
+  uint64_t percentile(double percentile) const;
+
+  uint64_t count() const
+  {
+    return mTotal;
+  }
+
+  /** @brief Smallest value recorded, 0 if none */
+  uint64_t min() const
+  {
+    return (mTotal) ? mMin : 0;
+  }
+
+  uint64_t max() const
+  {
+    return mMax;
+  }
+
+  double mean() const
+  {
+    return (mTotal) ? static_cast<double>(mSum) / mTotal : 0;
+  }
+
+ private:
+  size_t index(uint64_t value) const
+  {
+    if (value < (mHalf << 1))
+      {
+        return value;
+      }
+
+    const unsigned int shift = std::bit_width(value) - (mPrecision + 1);
+
+    return shift * mHalf + (value >> shift);
+  }
+
+  /** @brief Highest value counted in bucket \p i */
+  uint64_t highest(size_t i) const;
+
+  const unsigned int mPrecision;
+  const uint64_t mHalf; //!< Buckets per power of two.
+  std::vector<uint64_t> mCounts;
+  uint64_t mTotal{0};
+  uint64_t mSum{0};
+  uint64_t mMin{UINT64_MAX};
+  uint64_t mMax{0};
+};
+} // namespace Sukat
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "socket.hpp"
+
+namespace Sukat
+{
+/** @brief A SO_REUSEPORT group of listeners, one per worker thread
+ *
+ * All listeners are bound to the same end-point, so the kernel spreads new
+ * connections and datagrams over them. With CPU steering each worker is
+ * pinned to its own CPU and a classic BPF program steers traffic to the
+ * listener of the CPU that received it, keeping a flow on one core from the
+ * NIC queue to the worker.
+ */
+class ListenerGroup
+{
+ public:
+  /**
+   * @brief Worker body, run in its own thread.
+   *
+   * @param listener    Listener owned by this worker.
+   * @param index       Worker index, also the pinned CPU with cpu_affine.
+   * @param stop        Set when the group is stopped. The worker should
+   *                    return soon after.
+   */
+  using workerCb = std::function<void(SocketListener &listener,
+                                      unsigned int index,
+                                      std::stop_token stop)>;
+
+  /**
+   * @brief Create and bind all listeners of the group.
+   *
+   * @param ep          End-point to listen on. If the port is 0, the port
+   *                    chosen for the first listener is used for the rest.
+   * @param socktype    SOCK_STREAM, SOCK_SEQPACKET or SOCK_DGRAM.
+   * @param n_workers   Number of listeners and worker threads.
+   * @param cpu_affine  Pin workers to CPUs and steer traffic by CPU.
+   *
+   * @throw std::system_error On socket, bind or listen failure.
+   */
+  ListenerGroup(Socket::endpoint ep, __socket_type socktype = SOCK_STREAM,
+                unsigned int n_workers = std::thread::hardware_concurrency(),
+                bool cpu_affine = true);
+
+  /** @brief Stops and joins all workers. */
+  ~ListenerGroup();
+
+  /** @brief Start one thread per listener running \p cb */
+  void run(workerCb cb);
+
+  /** @brief Request all workers to stop and wait for them */
+  void stop();
+
+  /** @brief Replace the steering program with a SO_ATTACH_REUSEPORT_EBPF
+   * program returning the listener index. */
+  bool attachProgram(int prog_fd) const;
+
+  SocketListener &listener(unsigned int index)
+  {
+    return *mListeners.at(index);
+  }
+
+  size_t size() const
+  {
+    return mListeners.size();
+  }
+
+  /** @brief The end-point all listeners are bound to */
+  const Socket::endpoint &endpoint() const
+  {
+    return mEndpoint;
+  }
+
+ private:
+  /** @brief Attach a cBPF program mapping the receiving CPU to a listener */
+  bool attachCpuSteering() const;
+
+  Socket::endpoint mEndpoint;
+  const bool mCpuAffine;
+  std::vector<std::unique_ptr<SocketListener>> mListeners;
+  std::vector<std::jthread> mWorkers;
+};
+} // namespace Sukat
@@ -1,13 +1,46 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <string_view>
 #include <mutex>
+#include <stdexcept>
 
-#define LOG_ANY(_lvl, ...) Logger::Log(_lvl, __FILE__, __LINE__, __VA_ARGS__)
+#include "binlog.hpp"
+
+/**
+ * Most verbose level compiled in, as a LogLevel value. Calls above it expand
+ * to nothing and never evaluate their arguments. Debug logging is compiled
+ * out of NDEBUG builds unless this is defined on the command line.
+ */
+#ifndef SUKAT_LOG_COMPILED_LEVEL
+#ifdef NDEBUG
+#define SUKAT_LOG_COMPILED_LEVEL 1
+#else
+#define SUKAT_LOG_COMPILED_LEVEL 2
+#endif
+#endif
+
+// Arguments are only evaluated once the runtime level check passes.
+#define LOG_ANY(_lvl, ...)                                                    \
+  do                                                                          \
+    {                                                                         \
+      if constexpr (static_cast<int>(_lvl) <= SUKAT_LOG_COMPILED_LEVEL)      \
+        {                                                                     \
+          if (Logger::enabled(_lvl))                                          \
+            {                                                                 \
+              static Logger::logSite sukat_log_site{_lvl, __FILE__,           \
+                                                    __LINE__};                \
+              Logger::Log(sukat_log_site, __VA_ARGS__);                       \
+            }                                                                 \
+        }                                                                     \
+    }                                                                         \
+  while (0)
 #define LOG_DBG(...) LOG_ANY(Logger::LogLevel::DEBUG, __VA_ARGS__)
 #define LOG_INF(...) LOG_ANY(Logger::LogLevel::INFORMATIONAL, __VA_ARGS__)
 #define LOG_ERR(...) LOG_ANY(Logger::LogLevel::ERROR, __VA_ARGS__)
@@ -24,12 +57,31 @@ class Logger
     DEBUG
   };
 
+  /** @brief What an async caller does when its ring is full */
+  enum class overflowPolicy
+  {
+    OVERFLOW_DROP, //!< Discard the line and count it in dropped().
+    OVERFLOW_BLOCK //!< Wait for the writer thread to make room.
+  };
+
+  /** @brief A LOG_* call site, static per macro expansion */
+  struct logSite
+  {
+    const LogLevel lvl;
+    const char *const file;
+    const int line;
+    std::atomic<uint32_t> id{0}; //!< Binary sink site id once defined.
+  };
+
   Logger(const Logger&) = delete;
+  ~Logger();
 
   static void initialize(LogLevel lvl, std::string logfile = "")
   {
-    std::call_once(onceFlag,
-                   [&]() { log_instance.reset(new Logger(lvl, logfile)); });
+    std::call_once(onceFlag, [&]() {
+      log_instance.reset(new Logger(logfile));
+      setLevel(lvl);
+    });
   }
 
   static void initialize(int lvl, std::string logfile = "")
@@ -41,29 +93,98 @@ class Logger
     initialize(static_cast<LogLevel>(lvl), logfile);
   }
 
+  /**
+   * @brief Log through a background writer thread.
+   *
+   * Callers format a line and copy it into a lock-free ring of their own
+   * thread, the writer drains all rings and writes them in batches with one
+   * flush each. Lines of one thread keep their order. Arguments are still
+   * formatted by the caller, as they may point to objects gone by the time
+   * the writer runs.
+   *
+   * @param ring_size   Bytes per thread ring, rounded up to a power of 2.
+   */
+  static void initializeAsync(LogLevel lvl, std::string logfile = "",
+                              overflowPolicy policy =
+                                overflowPolicy::OVERFLOW_DROP,
+                              size_t ring_size = 1 << 16)
+  {
+    std::call_once(onceFlag, [&]() {
+      log_instance.reset(new Logger(logfile));
+      log_instance->startAsync(policy, ring_size);
+      setLevel(lvl);
+    });
+  }
+
+  /**
+   * @brief Log in BinaryLog format through a background writer thread.
+   *
+   * As initializeAsync(), but each call site is described once in the log
+   * and lines carry only a site id, a timestamp and raw argument values.
+   * Render with Cpplogdecode.
+   *
+   * @throw std::invalid_argument If \p logfile is empty.
+   */
+  static void initializeBinary(LogLevel lvl, std::string logfile,
+                               overflowPolicy policy =
+                                 overflowPolicy::OVERFLOW_DROP,
+                               size_t ring_size = 1 << 16)
+  {
+    if (logfile.empty())
+      {
+        throw std::invalid_argument("Binary log needs a file");
+      }
+    std::call_once(onceFlag, [&]() {
+      log_instance.reset(new Logger(logfile));
+      log_instance->binary = true;
+      log_instance->output_file.write(BinaryLog::magic.data(),
+                                      BinaryLog::magic.size());
+      log_instance->startAsync(policy, ring_size);
+      setLevel(lvl);
+    });
+  }
+
+  /** @brief Wait until the writer has written everything logged so far */
+  static void flush();
+
+  /** @brief Lines discarded on full rings */
+  static uint64_t dropped();
+
+  /** @brief Change the level at runtime. No-op before initialize(). */
+  static void setLevel(LogLevel lvl)
+  {
+    if (log_instance)
+      {
+        log_level.store(static_cast<int>(lvl), std::memory_order_release);
+      }
+  }
+
+  /** @brief Would a line at \p lvl be logged. A single atomic load. */
+  static bool enabled(LogLevel lvl)
+  {
+    return static_cast<int>(lvl) <=
+           log_level.load(std::memory_order_acquire);
+  }
+
   template<typename... Args>
-    static void Log(LogLevel lvl, std::string_view file, int line, Args... args)
+    static void Log(logSite &site, Args &&... args)
       {
-        if (log_instance.get())
+        if (!enabled(site.lvl))
           {
-            if (lvl <= log_instance->log_lvl)
-              {
-                log_instance->print_args(lvl, filePlain(file), "(", line,
-                                         "): ", args...);
-              }
+            return;
           }
+        if (log_instance->binary)
+          {
+            log_instance->print_binary(site, std::forward<Args>(args)...);
+            return;
+          }
+        log_instance->print_args(site.lvl, filePlain(site.file), "(",
+                                 site.line, "): ",
+                                 std::forward<Args>(args)...);
       }
 
  private:
-  Logger(Logger&&) = default;
-  Logger(){};
-  Logger(LogLevel lvl, std::string logfile) : log_lvl(lvl)
-  {
-    if (!logfile.empty())
-      {
-        output_file = std::ofstream(logfile);
-      }
-  };
+  explicit Logger(std::string logfile);
 
   /** @brief Converts a full file path to only the filename without .<ext> */
   static constexpr const std::string_view filePlain(std::string_view full_path)
@@ -76,19 +197,106 @@ class Logger
       return full_path.substr(last_slash, first_dot - last_slash);
     }
 
+  /** @brief Stream buffer appending to a reusable string */
+  class LineBuffer : public std::streambuf
+  {
+   public:
+    std::string line;
+
+   protected:
+    virtual int_type overflow(int_type c) override
+    {
+      if (c != traits_type::eof())
+        {
+          line.push_back(traits_type::to_char_type(c));
+        }
+      return c;
+    }
+
+    virtual std::streamsize xsputn(const char *data,
+                                   std::streamsize n) override
+    {
+      line.append(data, n);
+      return n;
+    }
+  };
+
   template <typename... Args>
   void print_args(LogLevel lvl, Args &&... args)
   {
+    if (async)
+      {
+        thread_local LineBuffer buf;
+        thread_local std::ostream stream(&buf);
+
+        buf.line.clear();
+        (stream << ... << args) << '\n';
+        submit(lvl, buf.line);
+        return;
+      }
+
     auto &out = (output_file.is_open()
                    ? output_file
                    : ((lvl == LogLevel::ERROR) ? std::cerr : std::cout));
     (out << ... << args) << std::endl;
   }
 
+  template <typename... Args>
+  void print_binary(logSite &site, Args &&... args)
+  {
+    thread_local std::string buf;
+    uint32_t id = site.id.load(std::memory_order_acquire);
+    bool defined = false;
+
+    buf.clear();
+    if (!id)
+      {
+        const uint32_t mine =
+          next_site.fetch_add(1, std::memory_order_relaxed);
+
+        // A racing thread may define it first, then its id is used.
+        if (site.id.compare_exchange_strong(id, mine,
+                                            std::memory_order_acq_rel))
+          {
+            id = mine;
+            defined = true;
+            BinaryLog::encodeSite<Args...>(buf, id,
+                                           static_cast<int>(site.lvl),
+                                           filePlain(site.file), site.line,
+                                           args...);
+          }
+      }
+    BinaryLog::encodeLine<Args...>(
+      buf, id,
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch())
+        .count(),
+      std::forward<Args>(args)...);
+    if (!submit(site.lvl, buf) && defined)
+      {
+        // The definition was dropped with the line, let the next call
+        // define the site again.
+        site.id.compare_exchange_strong(id, 0, std::memory_order_acq_rel);
+      }
+  }
+
+  class AsyncWriter;
+
+  void startAsync(overflowPolicy policy, size_t ring_size);
+
+  /** @brief Hand a formatted \p line to the writer thread
+   *
+   * @return False if the line was dropped.
+   */
+  bool submit(LogLevel lvl, std::string_view line);
+
   std::ofstream output_file;
+  std::unique_ptr<AsyncWriter> async;
+  bool binary{false};
+  std::atomic<uint32_t> next_site{1};
 
   static std::unique_ptr<Logger> log_instance;
   static std::once_flag onceFlag;
-  LogLevel log_lvl{LogLevel::INFORMATIONAL};
+  static std::atomic<int> log_level; //!< -1 until log_instance is set.
 };
 } // namespace Sukat
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "epoll.hpp"
+#include "registry.hpp"
+#include "socket.hpp"
+
+namespace Sukat
+{
+/** @brief Process wide socket counters, off until enable()
+ *
+ * Every thread counts into a shard of its own, registered on first use, so
+ * counting is a relaxed load and store on a cache line no other thread
+ * writes. collect() sums all shards on demand. Counts of exited threads are
+ * folded into a retired shard, so totals never go backwards.
+ *
+ * While disabled the instrumented paths cost one relaxed load and a branch.
+ */
+class Metrics
+{
+ public:
+  enum class counter : uint8_t
+  {
+    COUNTER_BYTES_IN,         //!< Bytes received.
+    COUNTER_BYTES_OUT,        //!< Bytes sent.
+    COUNTER_READS,            //!< Receive syscalls.
+    COUNTER_WRITES,           //!< Send syscalls.
+    COUNTER_WOULD_BLOCK,      //!< Syscalls ending in EAGAIN.
+    COUNTER_PARTIAL_WRITES,   //!< Sends that took only part of the data.
+    COUNTER_ACCEPTS,          //!< Clients accepted by listeners.
+    COUNTER_DENIED,           //!< Clients refused by an accessCb.
+    COUNTER_CONNECTS,         //!< Outgoing connects started.
+    COUNTER_CONNECT_FAILURES, //!< Connects reported failed by polloutReady.
+    COUNTER_COUNT
+  };
+
+  enum class histogram : uint8_t
+  {
+    HISTOGRAM_CONNECT_LATENCY, //!< Connect start to polloutReady, in ns.
+    HISTOGRAM_COUNT
+  };
+
+  static constexpr size_t nCounters =
+    static_cast<size_t>(counter::COUNTER_COUNT);
+  static constexpr size_t nHistograms =
+    static_cast<size_t>(histogram::HISTOGRAM_COUNT);
+
+  /** @brief Power of two buckets, value v counts in bucket bit_width(v) */
+  struct distribution
+  {
+    std::array<uint64_t, 65> buckets{};
+    uint64_t count{0};
+    uint64_t sum{0};
+  };
+
+  /** @brief Totals over all threads at one point in time */
+  struct snapshot
+  {
+    std::array<uint64_t, nCounters> counters{};
+    std::array<distribution, nHistograms> histograms{};
+
+    uint64_t operator[](counter c) const
+    {
+      return counters[static_cast<size_t>(c)];
+    }
+  };
+
+  static void enable(bool on = true)
+  {
+    mEnabled.store(on, std::memory_order_relaxed);
+  }
+
+  static bool enabled()
+  {
+    return mEnabled.load(std::memory_order_relaxed);
+  }
+
+  /** @brief Count \p n of \p c for the calling thread, if enabled */
+  static void add(counter c, uint64_t n = 1)
+  {
+    if (enabled())
+      {
+        bump(local().counters[static_cast<size_t>(c)], n);
+      }
+  }
+
+  /** @brief Record \p value in \p h for the calling thread, if enabled */
+  static void record(histogram h, uint64_t value)
+  {
+    if (enabled())
+      {
+        auto &dist = local().histograms[static_cast<size_t>(h)];
+
+        bump(dist.buckets[std::bit_width(value)], 1);
+        bump(dist.count, 1);
+        bump(dist.sum, value);
+      }
+  }
+
+  /** @brief Sum of all threads' counts */
+  static snapshot collect();
+
+  /** @brief collect() in the Prometheus text exposition format
+   *
+   * Counters are named sukat_<name>_total, latencies are histograms in
+   * seconds.
+   */
+  static std::string prometheus();
+
+ private:
+  struct shardDistribution
+  {
+    std::array<std::atomic<uint64_t>, 65> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+  };
+
+  struct alignas(64) shard
+  {
+    std::array<std::atomic<uint64_t>, nCounters> counters{};
+    std::array<shardDistribution, nHistograms> histograms{};
+  };
+
+  /** @brief Only the owner thread writes, so no read-modify-write needed */
+  static void bump(std::atomic<uint64_t> &value, uint64_t n)
+  {
+    value.store(value.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+  }
+
+  /** @brief Shard of the calling thread, registered on first use */
+  static shard &local()
+  {
+    struct slot
+    {
+      shard *mine{nullptr};
+
+      ~slot()
+      {
+        if (mine)
+          {
+            retire(mine);
+          }
+      }
+    };
+    thread_local slot s;
+
+    if (!s.mine)
+      {
+        s.mine = attach();
+      }
+    return *s.mine;
+  }
+
+  static shard *attach();
+  static void retire(shard *done);
+
+  static std::atomic<bool> mEnabled;
+  static std::mutex mShardsMutex;
+  static std::vector<std::unique_ptr<shard>> mShards; //!< Of live threads.
+  static shard mRetired; //!< Counts of exited threads.
+};
+
+/** @brief Serves Metrics::prometheus() over a Unix socket
+ *
+ * Speaks just enough HTTP/1.0 for a scraper or
+ * `curl --unix-socket <path> http://localhost/metrics`: each client gets
+ * the current metrics after its request and is closed. Runs on the given
+ * Reactor, so a scrape costs the loop one collect(). Scrapes are counted
+ * in the metrics like any other socket traffic. A client not served within
+ * the timeout is closed, so stalled ones can't pile up.
+ */
+class MetricsExporter
+{
+ public:
+  /**
+   * @param reactor     Loop to serve on.
+   * @param path        Socket path, a stale socket file is replaced.
+   * @param abstract    Use the abstract namespace instead of a file.
+   * @param timeout     Time a client gets to send its request and take the
+   *                    answer.
+   *
+   * @throw std::system_error If \p path is something other than a socket
+   *                          or listening fails.
+   */
+  MetricsExporter(Reactor &reactor, const std::filesystem::path &path,
+                  bool abstract = false,
+                  std::chrono::milliseconds timeout = std::chrono::seconds(5));
+
+  /** @brief Closes clients and removes the socket file */
+  ~MetricsExporter();
+
+  MetricsExporter(const MetricsExporter &) = delete;
+
+  /** @brief Scrapes answered so far */
+  uint64_t served() const
+  {
+    return mServed;
+  }
+
+ private:
+  class Client;
+
+  void accept();
+  void close(Client &client);
+
+  Reactor &mReactor;
+  const std::filesystem::path mPath; //!< Empty if abstract.
+  const std::chrono::milliseconds mTimeout;
+  SocketListenerStream mListener;
+  EventCallback<std::function<void(uint32_t)>> mListenerEvent;
+  Registry<Client> mClients;
+  uint64_t mServed{0};
+};
+} // namespace Sukat
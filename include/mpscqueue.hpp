@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace Sukat
+{
+/** @brief Lock-free multi producer, single consumer queue
+ *
+ * Intrusive linked list with a stub node (Vyukov). push() is wait-free and
+ * may be called from any thread, pop() only from the owning consumer.
+ */
+template <typename T> class MpscQueue
+{
+ public:
+  MpscQueue() : mHead(new Node), mTail(mHead.load()){};
+
+  ~MpscQueue()
+  {
+    while (pop())
+      {
+      }
+    delete mTail;
+  }
+
+  MpscQueue(const MpscQueue &) = delete;
+
+  /** @brief Append \p value. Safe from any thread. */
+  void push(T value)
+  {
+    Node *node = new Node;
+
+    node->value.emplace(std::move(value));
+    Node *prev = mHead.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  /** @brief Take the oldest value. Consumer thread only.
+   *
+   * May return empty while a concurrent push() is half way, the value
+   * becomes visible on a later call.
+   */
+  std::optional<T> pop()
+  {
+    Node *tail = mTail;
+    Node *next = tail->next.load(std::memory_order_acquire);
+
+    if (!next)
+      {
+        return {};
+      }
+    mTail = next;
+    delete tail;
+
+    std::optional<T> value = std::move(next->value);
+
+    next->value.reset();
+    return value;
+  }
+
+ private:
+  struct Node
+  {
+    std::atomic<Node *> next{nullptr};
+    std::optional<T> value;
+  };
+
+  std::atomic<Node *> mHead; //!< Last pushed, producers side.
+  Node *mTail;               //!< Stub before the oldest, consumer side.
+};
+} // namespace Sukat
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace Sukat
+{
+/** @brief Connection table indexed directly by fd
+ *
+ * Objects live inline in fixed size chunks of slots, so lookup is two array
+ * indexings, neighbouring fds share cache lines and an object never moves
+ * once constructed. That last part matters as objects are typically
+ * registered to a Reactor by address.
+ *
+ * Each slot carries a generation bumped on erase. A handle taken at
+ * emplace() stops resolving once its fd is closed, even if the kernel has
+ * already reused the number for a new connection.
+ */
+template <typename T> class Registry
+{
+ public:
+  /** @brief Names one occupant of a slot */
+  struct handle
+  {
+    int fd;
+    uint32_t generation;
+  };
+
+  Registry() = default;
+  Registry(const Registry &) = delete;
+
+  /**
+   * @brief Construct a T in the slot of \p fd.
+   *
+   * @return Handle to the new occupant, or none if \p fd is negative or
+   *         already occupied.
+   */
+  template <typename... Args>
+  std::optional<handle> emplace(int fd, Args &&... args)
+  {
+    if (fd < 0)
+      {
+        return {};
+      }
+
+    slot &s = at(fd);
+
+    if (s.value)
+      {
+        return {};
+      }
+    s.value.emplace(std::forward<Args>(args)...);
+    mSize++;
+    return handle{fd, s.generation};
+  }
+
+  /** @brief Current occupant of \p fd or nullptr */
+  T *find(int fd)
+  {
+    slot *s = lookup(fd);
+
+    return (s && s->value) ? &s->value.value() : nullptr;
+  }
+
+  /** @brief Occupant named by \p h, nullptr if it was erased since */
+  T *find(handle h)
+  {
+    slot *s = lookup(h.fd);
+
+    return (s && s->value && s->generation == h.generation)
+             ? &s->value.value()
+             : nullptr;
+  }
+
+  /** @brief Destroy the occupant of \p fd */
+  bool erase(int fd)
+  {
+    slot *s = lookup(fd);
+
+    if (s && s->value)
+      {
+        s->value.reset();
+        s->generation++;
+        mSize--;
+        return true;
+      }
+    return false;
+  }
+
+  /** @brief Destroy the occupant named by \p h, if still there */
+  bool erase(handle h)
+  {
+    return find(h) && erase(h.fd);
+  }
+
+  /** @brief Call \p func for every occupant in fd order
+   *
+   * \p func must not emplace or erase.
+   */
+  template <typename Func> void forEach(Func func)
+  {
+    for (auto &c : mChunks)
+      {
+        for (auto &s : *c)
+          {
+            if (s.value)
+              {
+                func(s.value.value());
+              }
+          }
+      }
+  }
+
+  /** @brief Call \p func for at most \p max occupants from fd \p from on
+   *
+   * Lets a walk over many occupants be spread over several calls. \p func
+   * must not emplace or erase.
+   *
+   * @return fd to continue from, -1 once all occupants were visited.
+   */
+  template <typename Func> int forEachFrom(int from, size_t max, Func func)
+  {
+    size_t fd;
+
+    for (fd = (from > 0) ? from : 0; fd < mChunks.size() * chunkSlots; fd++)
+      {
+        slot &s = (*mChunks[fd >> chunkBits])[fd & (chunkSlots - 1)];
+
+        if (s.value)
+          {
+            if (!max--)
+              {
+                return fd;
+              }
+            func(s.value.value());
+          }
+      }
+    return -1;
+  }
+
+  /** @brief Destroy all occupants */
+  void clear()
+  {
+    for (auto &c : mChunks)
+      {
+        for (auto &s : *c)
+          {
+            if (s.value)
+              {
+                s.value.reset();
+                s.generation++;
+              }
+          }
+      }
+    mSize = 0;
+  }
+
+  size_t size() const
+  {
+    return mSize;
+  }
+
+  bool empty() const
+  {
+    return !mSize;
+  }
+
+ private:
+  static constexpr size_t chunkBits = 8;
+  static constexpr size_t chunkSlots = 1 << chunkBits;
+
+  struct slot
+  {
+    std::optional<T> value;
+    uint32_t generation{0};
+  };
+  using chunk = std::array<slot, chunkSlots>;
+
+  slot *lookup(int fd)
+  {
+    const size_t index = fd >> chunkBits;
+
+    if (fd < 0 || index >= mChunks.size())
+      {
+        return nullptr;
+      }
+    return &(*mChunks[index])[fd & (chunkSlots - 1)];
+  }
+
+  slot &at(int fd)
+  {
+    const size_t index = fd >> chunkBits;
+
+    while (mChunks.size() <= index)
+      {
+        mChunks.emplace_back(std::make_unique<chunk>());
+      }
+    return (*mChunks[index])[fd & (chunkSlots - 1)];
+  }
+
+  std::vector<std::unique_ptr<chunk>> mChunks;
+  size_t mSize{0};
+};
+} // namespace Sukat
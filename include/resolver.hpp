@@ -0,0 +1,134 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "epoll.hpp"
+#include "fd.hpp"
+#include "mpscqueue.hpp"
+#include "socket.hpp"
+
+namespace Sukat
+{
+/** @brief Non-blocking name resolution with a result cache
+ *
+ * getaddrinfo() runs on a few worker threads and results are delivered on
+ * the owner thread when fd() turns readable, so the resolver plugs into a
+ * Reactor like any other handler. Lookups of a name already in flight
+ * share its result, and results are cached for a fixed time as
+ * getaddrinfo() does not expose record TTLs. Failures are cached for a
+ * shorter time so a bad name doesn't hammer the DNS server.
+ *
+ * Everything except the workers runs on the owner thread.
+ */
+class Resolver : public EventHandler
+{
+ public:
+  /** @brief Outcome of one lookup */
+  struct result
+  {
+    int error; //!< 0 or an EAI_* code, see gai_strerror().
+    std::vector<Socket::endpoint> endpoints;
+    bool cached; //!< Served from the cache without a lookup.
+  };
+
+  using resolveCb = std::function<void(const result &res)>;
+
+  /**
+   * @param n_threads   Lookups run in parallel.
+   * @param ttl         How long successful results are reused.
+   * @param error_ttl   How long failures are reused.
+   *
+   * @throw std::system_error If the completion eventfd can't be created.
+   */
+  Resolver(unsigned int n_threads = 4,
+           std::chrono::seconds ttl = std::chrono::seconds(60),
+           std::chrono::seconds error_ttl = std::chrono::seconds(5));
+  ~Resolver();
+
+  Resolver(const Resolver &) = delete;
+
+  /**
+   * @brief Look up \p node and \p service.
+   *
+   * \p cb is called right away for a cached result, otherwise from poll()
+   * once the lookup finishes.
+   *
+   * @param family      AF_UNSPEC for both address families.
+   */
+  void resolve(const std::string &node, const std::string &service,
+               resolveCb cb, int type = SOCK_STREAM,
+               int family = AF_UNSPEC);
+
+  /**
+   * @brief Deliver finished lookups.
+   *
+   * @return Number of lookups delivered.
+   */
+  size_t poll();
+
+  /** @brief Readable while finished lookups wait for poll() */
+  int fd() const
+  {
+    return mEventFd.fd();
+  }
+
+  virtual void handleEvent(__attribute__((unused)) uint32_t events) override
+  {
+    poll();
+  }
+
+  /** @brief Lookups queued or running */
+  size_t pending() const
+  {
+    return mPending;
+  }
+
+  /** @brief Drop all cached results */
+  void flush();
+
+ private:
+  using clock = std::chrono::steady_clock;
+
+  struct request
+  {
+    std::string key;
+    std::string node, service;
+    int type, family;
+  };
+
+  struct entry
+  {
+    int error{0};
+    std::vector<Socket::endpoint> endpoints;
+    clock::time_point expires;
+    std::vector<resolveCb> waiters; //!< Non-empty while in flight.
+  };
+
+  void work(std::stop_token stop);
+
+  /** @brief Drop expired entries */
+  void purge();
+
+  static constexpr size_t purgeMin = 1024;
+
+  const std::chrono::seconds mTtl, mErrorTtl;
+  const Fd mEventFd;
+  std::unordered_map<std::string, entry> mCache;
+  size_t mPurgeAt{purgeMin}; //!< Cache size triggering the next purge().
+  size_t mPending{0};
+
+  std::mutex mLock; //!< Guards mRequests.
+  std::condition_variable_any mCond;
+  std::deque<request> mRequests;
+  MpscQueue<std::pair<std::string, result>> mDone;
+  std::vector<std::jthread> mThreads;
+};
+} // namespace Sukat
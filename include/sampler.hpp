@@ -0,0 +1,134 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+
+#include "epoll.hpp"
+#include "registry.hpp"
+#include "socket.hpp"
+#include "timerwheel.hpp"
+
+namespace Sukat
+{
+/** @brief Samples every connection of a Registry on a schedule
+ *
+ * Runs on the Reactor owning the connections, so sampling needs no locking
+ * and a connection is never sampled mid-callback. A pass can be spread
+ * over several timer ticks with setBatch() to keep thousands of
+ * connections from stalling the loop at once.
+ *
+ * \p T is anything with the Socket interface, typically a SocketConnection
+ * subclass.
+ */
+template <typename T> class Sampler
+{
+ public:
+  /**
+   * @brief Callback per sampled connection.
+   *
+   * Must not add or remove Registry entries, defer closing e.g. to a
+   * zero delay Timer.
+   */
+  using sampleCb = std::function<void(T &conn, const SocketSample &sample)>;
+
+  /** @brief Callback at the end of each complete pass */
+  using passCb = std::function<void()>;
+
+  /**
+   * @param reactor     Loop owning \p registry.
+   * @param registry    Connections to sample.
+   * @param cb          Callback per connection.
+   * @param interval    From the start of one pass to the next.
+   * @param fields      SocketSample groups to sample.
+   */
+  Sampler(Reactor &reactor, Registry<T> &registry, sampleCb cb,
+          std::chrono::milliseconds interval,
+          unsigned int fields = SocketSample::SAMPLE_ALL)
+    : mReactor(reactor), mRegistry(registry), mCb(std::move(cb)),
+      mInterval(interval), mFields(fields), mTimer([this]() { tick(); })
+  {
+  }
+
+  Sampler(const Sampler &) = delete;
+
+  /** @brief Start sampling, the first pass begins on the next timer tick */
+  void start()
+  {
+    mNext = 0;
+    mReactor.schedule(mTimer, std::chrono::milliseconds(0));
+  }
+
+  void stop()
+  {
+    mTimer.cancel();
+  }
+
+  /** @brief Takes effect from the next pass */
+  void setInterval(std::chrono::milliseconds interval)
+  {
+    mInterval = interval;
+  }
+
+  /** @brief Sample at most \p n connections per timer tick, 0 for all */
+  void setBatch(size_t n)
+  {
+    mBatch = n;
+  }
+
+  void setPassCb(passCb cb)
+  {
+    mPassCb = std::move(cb);
+  }
+
+  /** @brief Sample every connection right away, outside the schedule */
+  void sampleAll()
+  {
+    mRegistry.forEach([this](T &conn) { mCb(conn, conn.sample(mFields)); });
+  }
+
+ private:
+  void tick()
+  {
+    if (!mNext)
+      {
+        mPassStart = std::chrono::steady_clock::now();
+      }
+    mNext = mRegistry.forEachFrom(mNext, (mBatch) ? mBatch : SIZE_MAX,
+                                  [this](T &conn) {
+                                    mCb(conn, conn.sample(mFields));
+                                  });
+    if (mNext < 0)
+      {
+        const auto elapsed = std::chrono::steady_clock::now() - mPassStart;
+
+        mNext = 0;
+        if (mPassCb)
+          {
+            mPassCb();
+          }
+        mReactor.schedule(
+          mTimer,
+          std::max(mInterval -
+                     std::chrono::duration_cast<std::chrono::milliseconds>(
+                       elapsed),
+                   std::chrono::milliseconds(0)));
+      }
+    else
+      {
+        // Rest of the pass after whatever else the loop has to do.
+        mReactor.schedule(mTimer, std::chrono::milliseconds(0));
+      }
+  }
+
+  Reactor &mReactor;
+  Registry<T> &mRegistry;
+  const sampleCb mCb;
+  passCb mPassCb;
+  std::chrono::milliseconds mInterval;
+  const unsigned int mFields;
+  size_t mBatch{0};
+  int mNext{0}; //!< fd the current pass continues from.
+  std::chrono::steady_clock::time_point mPassStart;
+  Timer mTimer;
+};
+} // namespace Sukat
@@ -1,12 +1,20 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
 #include <functional>
 #include <iostream>
+#include <deque>
 #include <map>
 #include <memory>
 #include <set>
+#include <unordered_map>
+#include <span>
 #include <sstream>
+#include <string_view>
 #include <variant>
+#include <optional>
+#include <vector>
 #include <filesystem>
 
 extern "C"
@@ -23,6 +31,7 @@ extern "C"
 #include <netdb.h>
 }
 
+#include "buffer.hpp"
 #include "logging.hpp"
 #include "fd.hpp"
 
@@ -56,6 +65,58 @@ private:
 /** @brief Utility: Stringifies a sockaddr */
 std::string saddr_to_string(const struct sockaddr_storage *addr, socklen_t len);
 
+/** @brief The kernel's view of a socket at one point in time
+ *
+ * Filled by Socket::sample(). Each group of fields costs one syscall, three
+ * for the queues, and is zero unless its bit is set in \p valid. TCP_INFO
+ * fields missing from an older kernel's tcp_info also stay zero.
+ */
+struct SocketSample
+{
+  enum field : unsigned int
+  {
+    SAMPLE_TCP_INFO = 1 << 0, //!< getsockopt(TCP_INFO), TCP only.
+    SAMPLE_QUEUES = 1 << 1,   //!< SIOCINQ, SIOCOUTQ and SIOCOUTQNSD.
+    SAMPLE_MEMINFO = 1 << 2,  //!< getsockopt(SO_MEMINFO).
+    SAMPLE_ALL = SAMPLE_TCP_INFO | SAMPLE_QUEUES | SAMPLE_MEMINFO
+  };
+
+  unsigned int valid{0}; //!< Groups filled, of those asked for.
+
+  // TCP_INFO. Times in microseconds, rates in bytes per second.
+  uint8_t state{0};         //!< TCP_ESTABLISHED etc.
+  uint32_t rtt{0};          //!< Smoothed round trip time.
+  uint32_t rttVar{0};
+  uint32_t minRtt{0};
+  uint32_t cwnd{0};         //!< Congestion window in segments.
+  uint32_t ssthresh{0};
+  uint32_t mss{0};          //!< Sending MSS.
+  uint32_t unacked{0};      //!< Segments in flight.
+  uint32_t lost{0};         //!< Segments presumed lost.
+  uint32_t retransmits{0};  //!< Timeouts on the current segment.
+  uint32_t totalRetrans{0}; //!< Segments retransmitted over the lifetime.
+  uint64_t deliveryRate{0}; //!< Of the most recent delivery sample.
+  uint64_t pacingRate{0};
+  uint64_t bytesAcked{0};
+  uint64_t bytesReceived{0};
+  uint64_t busyTime{0};      //!< Spent with data to send.
+  uint64_t rwndLimited{0};   //!< Of busyTime, stalled by the peer's window.
+  uint64_t sndbufLimited{0}; //!< Of busyTime, stalled by our send buffer.
+
+  // Queue depths in bytes.
+  uint32_t inq{0};     //!< Received, not yet read.
+  uint32_t outq{0};    //!< Written, not yet acknowledged.
+  uint32_t notSent{0}; //!< Of outq, not yet sent.
+
+  // SO_MEMINFO, in bytes except drops.
+  uint32_t rmemAlloc{0};  //!< Receive memory in use.
+  uint32_t rcvbuf{0};
+  uint32_t wmemQueued{0}; //!< Send memory queued.
+  uint32_t sndbuf{0};
+  uint32_t backlog{0};    //!< Socket backlog queue.
+  uint32_t drops{0};      //!< Packets dropped on a full receive buffer.
+};
+
 /** @brief Main socket class contaning the file descriptor */
 class Socket
 {
@@ -123,7 +184,8 @@ class Socket
     if (u8.length() < (sizeof(sun.sun_path) - is_abstract))
       {
         memcpy(&sun.sun_path[is_abstract], u8.c_str(), u8.length());
-        ep.second = u8.length() + is_abstract;
+        ep.second =
+          offsetof(struct sockaddr_un, sun_path) + u8.length() + is_abstract;
       }
     else
       {
@@ -148,6 +210,15 @@ class Socket
   /** @brief Fetches the source address and address len */
   std::optional<endpoint> getSource() const;
 
+  /** @brief Sample the kernel's state of the socket
+   *
+   * Cheap enough to run over every connection of a loop periodically, see
+   * Sampler. Groups the socket doesn't support, e.g. TCP_INFO on UDP, are
+   * left out of SocketSample::valid.
+   */
+  SocketSample sample(
+    unsigned int fields = SocketSample::SAMPLE_ALL) const;
+
   /** @brief Stringifies the socket */
   friend std::ostream &operator<<(std::ostream &os, Socket const &sock)
   {
@@ -189,6 +260,25 @@ class Socket
       return os;
     }
 
+  /** @brief Hashes the used part of an endpoint for unordered containers */
+  struct endpointHash
+  {
+    size_t operator()(const endpoint &ep) const
+    {
+      return std::hash<std::string_view>()(std::string_view(
+        reinterpret_cast<const char *>(&ep.first), ep.second));
+    }
+  };
+
+  /** @brief Compares the used part of two endpoints */
+  struct endpointEqual
+  {
+    bool operator()(const endpoint &a, const endpoint &b) const
+    {
+      return a.second == b.second && !::memcmp(&a.first, &b.first, a.second);
+    }
+  };
+
  protected:
   static const sockopts defaultSockopts; //!< Default options for socket.
 
@@ -199,13 +289,257 @@ class Socket
 /** Forward decl */
 class SocketListener;
 
+/** @brief Outbound datagrams queued for a single sendmmsg/GSO flush
+ *
+ * Payloads are copied into a slab allocated once in the constructor, so the
+ * caller may reuse its own buffers right after push().
+ */
+class DatagramQueue
+{
+ public:
+  /**
+   * @param n_msgs      Maximum queued datagrams.
+   * @param n_bytes     Maximum queued payload bytes in total.
+   */
+  DatagramQueue(size_t n_msgs = 64, size_t n_bytes = 64 * 1024);
+
+  DatagramQueue(const DatagramQueue &) = delete;
+
+  /**
+   * @brief Queue a datagram.
+   *
+   * @param dst Destination, or none to send to the connected peer.
+   *
+   * @return false if the queue has no room for the datagram.
+   */
+  bool push(const void *data, size_t len,
+            const std::optional<Socket::endpoint> &dst = {});
+
+  bool push(std::string_view data,
+            const std::optional<Socket::endpoint> &dst = {})
+  {
+    return push(data.data(), data.length(), dst);
+  }
+
+  /** @brief Flush same-destination bursts as one UDP_SEGMENT super-datagram
+   *
+   * Used when every queued datagram goes to the same destination and all but
+   * the last have equal length. Otherwise flushing falls back to sendmmsg.
+   */
+  void setSegmentation(bool enable)
+  {
+    mGso = enable;
+  }
+
+  /** @brief Number of datagrams still waiting to be sent */
+  size_t size() const
+  {
+    return mCount - mSent;
+  }
+
+  bool empty() const
+  {
+    return mCount == mSent;
+  }
+
+  void clear()
+  {
+    mCount = mSent = mUsed = 0;
+  }
+
+ private:
+  friend class SocketConnection;
+
+  /** @brief Checks the pending datagrams can be sent as one GSO burst */
+  bool segmentable() const;
+
+  bool mGso{false};
+  size_t mCount{0}; //!< Queued datagrams.
+  size_t mSent{0};  //!< Datagrams already flushed.
+  size_t mUsed{0};  //!< Slab bytes in use.
+  std::vector<uint8_t> mSlab;
+  std::vector<struct sockaddr_storage> mDsts;
+  std::vector<struct iovec> mIovs;
+  std::vector<struct mmsghdr> mHdrs;
+};
+
+/** @brief Outbound byte stream queued for a non-blocking connection
+ *
+ * Small writes are copied and coalesced into fixed size chunks, larger ones
+ * get a chunk of their own. SocketConnection::write(WriteQueue &) flushes
+ * as many chunks as the socket takes in one sendmsg and keeps the rest, so
+ * the owner only needs EPOLLOUT while !empty().
+ *
+ * Backpressure uses two watermarks: blocked() turns true once size()
+ * reaches the high watermark and false again once flushing brings it down
+ * to the low watermark. Producers should stop feeding a blocked queue.
+ *
+ * With setZerocopy() large flushes use MSG_ZEROCOPY. The kernel then keeps
+ * referencing sent chunks until it reports completion on the socket error
+ * queue (EPOLLERR), so sent chunks stay pinned() until
+ * SocketConnection::reap() collects the notifications. The queue must
+ * outlive its socket's pinned sends.
+ */
+class WriteQueue
+{
+ public:
+  /**
+   * @param low_watermark       Unblock at or below this many bytes.
+   * @param high_watermark      Block at or above this many bytes.
+   * @param chunk_size          Size of a coalescing chunk.
+   */
+  WriteQueue(size_t low_watermark = 64 * 1024,
+             size_t high_watermark = 1024 * 1024, size_t chunk_size = 16384)
+    : mLow(low_watermark), mHigh(std::max(high_watermark, low_watermark)),
+      mChunkSize(chunk_size){};
+
+  WriteQueue(const WriteQueue &) = delete;
+
+  /** @brief Receives chunks the kernel no longer needs, e.g. for reuse */
+  using releaseCb = std::function<void(std::vector<uint8_t> &&chunk)>;
+
+  /** @brief Queue a copy of \p data. Always succeeds, see blocked(). */
+  void push(const void *data, size_t len);
+
+  void push(std::string_view data)
+  {
+    push(data.data(), data.length());
+  }
+
+  /** @brief Queue \p data without copying it */
+  void push(std::vector<uint8_t> &&data);
+
+  /** @brief Bytes waiting to be sent */
+  size_t size() const
+  {
+    return mSize;
+  }
+
+  bool empty() const
+  {
+    return !mSize;
+  }
+
+  /** @brief Bytes sent with MSG_ZEROCOPY and awaiting completion */
+  size_t pinned() const
+  {
+    return mPinnedSize;
+  }
+
+  /** @brief Zerocopy sends the kernel reported as copied anyway
+   *
+   * Happens e.g. over loopback. If most are, zerocopy is just overhead.
+   */
+  size_t copied() const
+  {
+    return mCopied;
+  }
+
+  /** @brief Send flushes of at least \p min_bytes with MSG_ZEROCOPY
+   *
+   * The socket needs SO_ZEROCOPY, see SocketConnection::setZerocopy().
+   * Below roughly 10KB page pinning costs more than the copy it saves.
+   */
+  void setZerocopy(bool enable, size_t min_bytes = 16384)
+  {
+    mZerocopy = enable;
+    mZerocopyMin = min_bytes;
+  }
+
+  /** @brief Hand the emptied storage of each chunk to \p cb once the chunk
+   * is sent and, for zerocopy, completed */
+  void setRelease(releaseCb cb)
+  {
+    mRelease = std::move(cb);
+  }
+
+  /** @brief Above the high watermark and not yet drained to the low one */
+  bool blocked() const
+  {
+    return mBlocked;
+  }
+
+  /** @brief Drop unsent data. Pinned chunks stay until completed. */
+  void clear();
+
+ private:
+  friend class SocketConnection;
+
+  struct chunk
+  {
+    std::vector<uint8_t> data;
+    std::optional<uint32_t> zerocopyId; //!< Last zerocopy send using it.
+  };
+
+  /** @brief Drop \p n sent bytes from the front */
+  void consume(size_t n);
+
+  /** @brief Mark the chunks holding the next \p n bytes as used by the
+   * zerocopy send \p id */
+  void pin(size_t n, uint32_t id);
+
+  /** @brief Zerocopy sends [\p lo, \p hi] completed */
+  void complete(uint32_t lo, uint32_t hi);
+
+  bool completed(const chunk &c) const
+  {
+    return !c.zerocopyId ||
+           static_cast<int32_t>(c.zerocopyId.value() - mCompleted) < 0;
+  }
+
+  void release(chunk &&c);
+
+  const size_t mLow, mHigh, mChunkSize;
+  std::deque<chunk> mChunks;
+  size_t mOffset{0}; //!< Bytes of the front chunk already sent.
+  size_t mSize{0};
+  bool mBlocked{false};
+
+  bool mZerocopy{false};
+  size_t mZerocopyMin{0};
+  std::deque<chunk> mPinned; //!< Sent chunks awaiting completion.
+  size_t mPinnedSize{0};
+  uint32_t mNextId{0};    //!< Kernel's id for the next zerocopy send.
+  uint32_t mCompleted{0}; //!< All ids before this one completed.
+  std::vector<std::pair<uint32_t, uint32_t>> mEarly; //!< Out of order ranges.
+  size_t mCopied{0};
+  releaseCb mRelease;
+};
+
 /** @brief Socket connection describing a connected socket */
 class SocketConnection : public Socket
 {
  public:
-  /** @brief Read data from connection */
+  /** @brief Outcome of a read() into a caller owned buffer */
+  enum class readStatus
+  {
+    READ_AGAIN, //!< Socket drained, wait for next EPOLLIN.
+    READ_FULL,  //!< Buffer full, consume some and call again.
+    READ_EOF,   //!< Peer closed the connection.
+    READ_ERROR  //!< Socket error, see readResult::error.
+  };
+
+  struct readResult
+  {
+    readStatus status;
+    size_t bytes; //!< Bytes appended to the buffer on this call.
+    int error;    //!< errno on READ_ERROR.
+  };
+
+  /** @brief Read data from connection
+   *
+   * Convenience version that allocates a new stream per call. Prefer
+   * read(Buffer &) on hot paths.
+   */
   virtual std::stringstream readData() const;
 
+  /** @brief Receive pending data straight into \p buf
+   *
+   * Reads until the socket would block, the peer closes or \p buf runs out
+   * of space. Does not allocate or throw.
+   */
+  readResult read(Buffer &buf) const noexcept;
+
   /** @brief Write data to connection
    *
    * A range of write functions for different data to be sent. All will return
@@ -223,6 +557,39 @@ class SocketConnection : public Socket
 
   virtual int write(struct iovec &iov, size_t n_iov, int flags = 0) const;
 
+  /** @brief Flush queued datagrams with as few syscalls as possible
+   *
+   * Sent datagrams are dropped from \p queue, unsent ones stay queued for
+   * the next call, e.g. after EAGAIN.
+   *
+   * @return >= 0       Number of datagrams sent.
+   * @return -1         Nothing sent, errno set.
+   */
+  int write(DatagramQueue &queue, int flags = 0) const;
+
+  /** @brief Flush as much of \p queue as the socket takes
+   *
+   * Sent bytes are dropped from \p queue, the rest stays queued for the
+   * next EPOLLOUT. MSG_NOSIGNAL is always added to \p flags.
+   *
+   * @return >= 0       Number of bytes sent, 0 if the socket is full.
+   * @return -1         Socket error, errno set.
+   */
+  ssize_t write(WriteQueue &queue, int flags = 0) const;
+
+  /** @brief Enable SO_ZEROCOPY, needed before MSG_ZEROCOPY sends */
+  bool setZerocopy() const;
+
+  /** @brief Collect zerocopy completions from the socket error queue
+   *
+   * Call on EPOLLERR for a socket with zerocopy sends from \p queue.
+   * Completed chunks are released from \p queue.
+   *
+   * @return >= 0       Number of notifications read.
+   * @return -1         Error queue read failed, errno set.
+   */
+  int reap(WriteQueue &queue) const;
+
   /** @brief on POLLOUT checks SOL_ERROR
    *
    * Used to determine if a non-blocking socket has connected properly.
@@ -232,7 +599,10 @@ class SocketConnection : public Socket
    */
   int polloutReady() const;
 
-  /** @brief Checker to determine if socket is writable/readable yet. */
+  /** @brief Wait up to \p timeout ms for the socket to become writable
+   *
+   * A single poll(2). In an event loop prefer EPOLLOUT with a Reactor timer.
+   */
   bool ready(int timeout = 0) const;
 
   virtual bool canAccept() const override
@@ -246,9 +616,31 @@ class SocketConnection : public Socket
       return complete;
     }
 
+  /** @brief Traffic of this connection, counted while Metrics are enabled
+   *
+   * Lets the owner of many connections find the hot ones, e.g. with
+   * Registry::forEach(), without exporting a series per connection.
+   */
+  struct connectionStats
+  {
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    uint64_t reads;         //!< Receive syscalls.
+    uint64_t writes;        //!< Send syscalls.
+    uint64_t wouldBlock;    //!< Syscalls ending in EAGAIN.
+    uint64_t partialWrites; //!< Sends that took only part of the data.
+  };
+
+  const connectionStats &stats() const
+  {
+    return mStats;
+  }
+
   SocketConnection(SocketConnection &&other) : Socket(std::move(other))
   {
     complete = other.complete;
+    mStats = other.mStats;
+    mConnectStart = other.mConnectStart;
   }
 
   /** @brief Create a new connection from an accepted fd. */
@@ -290,7 +682,16 @@ class SocketConnection : public Socket
   int operator<<(const std::ostringstream &data);
 
  private:
+  /** @brief Count a receive that returned \p ret */
+  void countRead(ssize_t ret) const;
+
+  /** @brief Count a send that returned \p ret */
+  void countWrite(ssize_t ret, bool partial) const;
+
   bool complete;                        //!< Connect complete.
+  mutable connectionStats mStats{};
+  //! Start of a connect timed for Metrics, cleared once it completes.
+  mutable std::optional<std::chrono::steady_clock::time_point> mConnectStart;
 };
 
 /** @brief A listening socket .*/
@@ -315,16 +716,40 @@ class SocketListener : public Socket
 
   using accessCb = std::function<accessReturn(
     const Socket::endpoint &peer, std::vector<uint8_t> &data)>;
+
+  /** @brief Running totals of accept() outcomes
+   *
+   * Plain counters updated by accept(), so a listener accepted from several
+   * threads at once gets no reliable totals.
+   */
+  struct acceptStats
+  {
+    uint64_t accepted;   //!< Clients handed to the caller.
+    uint64_t denied;     //!< Clients refused by accessCb.
+    uint64_t overflowed; //!< Budgets used up with clients left waiting.
+  };
+
   /**
    * @brief Accept any new pending connections
    *
    * @param cb         Callback per connection.
+   * @param budget     Maximum connections accepted per call, 0 for no limit.
+   *                   Bounds the time spent here under a connection storm so
+   *                   other fds on the same event loop are served. Remaining
+   *                   clients are picked up on the next call.
    *
    * @return Number of accepted connections.
    */
-  unsigned int accept(newClientCb cbj, accessCb cb_access = nullptr) const;
+  unsigned int accept(newClientCb cbj, accessCb cb_access = nullptr,
+                      unsigned int budget = 0) const;
 
-  std::vector<SocketConnection> accept(accessCb cb_access = nullptr) const;
+  std::vector<SocketConnection> accept(accessCb cb_access = nullptr,
+                                       unsigned int budget = 0) const;
+
+  const acceptStats &stats() const
+  {
+    return mStats;
+  }
 
   virtual bool canAccept() const override
   {
@@ -354,6 +779,9 @@ class SocketListener : public Socket
                  Socket::bindopt opt = AF_INET6)
     : Socket(socktype, opts,
              opt.index() ? Socket::make_endpoint(std::get<int>(opt)) : opt){};
+
+  mutable acceptStats mStats{};
+  mutable std::vector<uint8_t> mAcceptData; //!< Handshake data, reused.
 };
 
 /** @brief A stream oriented listening socket */
@@ -363,10 +791,16 @@ class SocketListenerStream : public SocketListener
    /** @brief Create a new stream oriented listening socket
     *
     * @param socktype Can also be SOCK_SEQPACKET.
+    * @param backlog  Pending connection queue length, by default the
+    *                 system maximum net.core.somaxconn.
     */
   SocketListenerStream(Socket::bindopt opt = AF_INET6,
                     Socket::sockopts opts = defaultSockopts,
-                    __socket_type socktype = SOCK_STREAM);
+                    __socket_type socktype = SOCK_STREAM,
+                    int backlog = somaxconn());
+
+  /** @brief The system maximum listen backlog */
+  static int somaxconn();
 
  protected:
   /** @brief accept a new connection */
@@ -375,17 +809,200 @@ class SocketListenerStream : public SocketListener
     accessCb cb_access) const override;
 };
 
+/** @brief Preallocated datagram buffers and senders for recvmmsg
+ *
+ * Datagram buffers are carved from BufferPool slabs, as many per slab as
+ * fit, taken once in the constructor and reused by every
+ * SocketListenerUdp::receive() call the batch is given to. The slabs go back
+ * to the pool with the batch.
+ */
+class DatagramBatch
+{
+ public:
+  /**
+   * @param n_msgs      Maximum datagrams per recvmmsg call.
+   * @param msg_size    Size of a single datagram buffer. Longer datagrams are
+   *                    truncated.
+   * @param pool        Pool to take the buffers from. Its slabs must hold at
+   *                    least \p msg_size bytes.
+   *
+   * @throws std::invalid_argument if \p msg_size doesn't fit a slab.
+   */
+  DatagramBatch(size_t n_msgs = 32, size_t msg_size = 2048,
+                BufferPool &pool = BufferPool::local());
+
+  DatagramBatch(const DatagramBatch &) = delete;
+
+  /** @brief Number of datagrams received in the last call */
+  size_t size() const
+  {
+    return mCount;
+  }
+
+  /** @brief Payload of datagram \p i */
+  std::span<uint8_t> data(size_t i)
+  {
+    return {static_cast<uint8_t *>(mHdrs[i].msg_hdr.msg_iov->iov_base),
+            mHdrs[i].msg_len};
+  }
+
+  /** @brief True if datagram \p i didn't fit into its buffer */
+  bool truncated(size_t i) const
+  {
+    return mHdrs[i].msg_hdr.msg_flags & MSG_TRUNC;
+  }
+
+  /** @brief Sender of datagram \p i */
+  Socket::endpoint sender(size_t i) const
+  {
+    return {mSenders[i], mHdrs[i].msg_hdr.msg_namelen};
+  }
+
+ private:
+  friend class SocketListenerUdp;
+
+  /** @brief Restore lengths clobbered by the previous recvmmsg */
+  void reset();
+
+  const size_t mMsgSize;
+  size_t mCount{0};
+  std::vector<BufferPool::Handle> mSlabs; //!< Backing all datagram buffers.
+  std::vector<struct sockaddr_storage> mSenders;
+  std::vector<struct iovec> mIovs;
+  std::vector<struct mmsghdr> mHdrs;
+};
+
 class SocketListenerUdp : public SocketListener
 {
 public:
    /** @brief Create a new UDP socket that only listens */
   SocketListenerUdp(Socket::bindopt src = AF_INET6);
 
+  /** @brief Callback per received batch of datagrams */
+  using batchCb = std::function<void(DatagramBatch &batch)>;
+
+  /**
+   * @brief Receive pending datagrams in batches without creating connections
+   *
+   * Calls recvmmsg until the socket is drained, handing each filled \p batch
+   * to \p cb.
+   *
+   * @return Number of datagrams received.
+   */
+  unsigned int receive(DatagramBatch &batch, batchCb cb) const;
+
  protected:
   /** @brief Accept a new UDP connection */
   virtual std::optional<SocketConnection> getNewClient(
     Socket::endpoint &sender, std::vector<uint8_t> &data,
     accessCb cb_access) const override;
+
+ private:
+  const Socket::endpoint mSource; //!< Bound address, shared with new peers.
+};
+
+/** @brief Virtual connection to a single peer of a SocketListenerUdpDemux */
+class UdpPeer
+{
+ public:
+  UdpPeer(const Socket &listener, const Socket::endpoint &peer)
+    : mListener(listener), mPeer(peer){};
+
+  UdpPeer(const UdpPeer &) = delete;
+
+  /** @brief Send a datagram to the peer through the shared socket */
+  int write(const void *data, size_t len, int flags = 0) const;
+
+  int write(std::string_view data, int flags = 0) const
+  {
+    return write(data.data(), data.length(), flags);
+  }
+
+  const Socket::endpoint &peer() const
+  {
+    return mPeer;
+  }
+
+  friend std::ostream &operator<<(std::ostream &os, const UdpPeer &peer)
+  {
+    os << "peer " << Socket::endpoint_to_string(peer.mPeer) << " on fd "
+       << peer.mListener.fd();
+    return os;
+  }
+
+  friend std::ostream &operator<<(std::ostream &os, const UdpPeer *peer)
+  {
+    os << *peer;
+    return os;
+  }
+
+ private:
+  const Socket &mListener; //!< Socket owning the peer.
+  const Socket::endpoint mPeer;
+};
+
+/** @brief UDP listener demultiplexing peers without a socket per peer
+ *
+ * Unlike SocketListenerUdp::accept(), which creates a connected socket per
+ * new peer, every datagram is received on the single listening socket and
+ * routed to a UdpPeer looked up by sender end-point. fd count and kernel
+ * socket lookups stay flat however many peers there are.
+ */
+class SocketListenerUdpDemux : public SocketListenerUdp
+{
+ public:
+  /**
+   * @brief Callback per new peer.
+   *
+   * @param peer        New virtual connection, owned by the demuxer.
+   * @param data        First datagram received from the peer.
+   */
+  using newPeerCb = std::function<void(UdpPeer &peer, std::span<uint8_t> data)>;
+
+  /** @brief Callback per datagram from an already known peer */
+  using peerDataCb =
+    std::function<void(UdpPeer &peer, std::span<uint8_t> data)>;
+
+  /**
+   * @param src         Bind end-point or family.
+   * @param n_msgs      Datagrams received per syscall.
+   * @param msg_size    Maximum datagram size.
+   * @param pool        Pool for the receive buffers, see DatagramBatch.
+   */
+  SocketListenerUdpDemux(Socket::bindopt src = AF_INET6, size_t n_msgs = 32,
+                         size_t msg_size = 2048,
+                         BufferPool &pool = BufferPool::local())
+    : SocketListenerUdp(src), mBatch(n_msgs, msg_size, pool){};
+
+  /**
+   * @brief Receive and dispatch all pending datagrams.
+   *
+   * Datagrams from unknown peers are passed to \p cb_access, if given, and a
+   * new peer is created only on ACCESS_NEW.
+   *
+   * @return Number of datagrams received.
+   */
+  unsigned int process(newPeerCb cb_new, peerDataCb cb_data,
+                       accessCb cb_access = nullptr);
+
+  /** @brief Look up a known peer */
+  const UdpPeer *find(const Socket::endpoint &peer) const;
+
+  /** @brief Forget a peer. Later datagrams from it count as a new peer. */
+  bool remove(const Socket::endpoint &peer);
+
+  /** @brief Number of known peers */
+  size_t size() const
+  {
+    return mPeers.size();
+  }
+
+ private:
+  DatagramBatch mBatch;
+  std::vector<uint8_t> mHandshake; //!< Reused copy of data for accessCb.
+  std::unordered_map<Socket::endpoint, UdpPeer, Socket::endpointHash,
+                     Socket::endpointEqual>
+    mPeers; //!< Nodes keep peers in place across rehashes.
 };
 
 } // namespace Sukat
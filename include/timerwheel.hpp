@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+namespace Sukat
+{
+class TimerWheel;
+
+/** @brief A callback scheduled on a TimerWheel
+ *
+ * Owned by the user, so arming never allocates. The timer links itself into
+ * the wheel and is unlinked when it fires, is cancelled or destroyed. Its
+ * callback may re-arm or destroy it, the wheel doesn't touch a timer once its
+ * callback is running.
+ */
+class Timer
+{
+ public:
+  using callback = std::function<void()>;
+
+  explicit Timer(callback cb) : mCb(std::move(cb)){};
+  ~Timer()
+  {
+    cancel();
+  }
+
+  Timer(const Timer &) = delete;
+
+  bool armed() const
+  {
+    return mWheel;
+  }
+
+  /** @brief Disarm. No-op if not armed. */
+  void cancel();
+
+ private:
+  friend class TimerWheel;
+
+  /** @brief Unlink from whatever list we're on */
+  void unlink()
+  {
+    mPrev->mNext = mNext;
+    mNext->mPrev = mPrev;
+    mPrev = mNext = this;
+  }
+
+  callback mCb;
+  Timer *mPrev{this}, *mNext{this};
+  uint64_t mExpires{0}; //!< In ticks.
+  unsigned int mLevel{0};
+  TimerWheel *mWheel{nullptr};
+};
+
+/** @brief Hierarchical timer wheel
+ *
+ * Four levels of slots, each level covering 64 times the span of the one
+ * below, with the first level 256 ticks wide. Arming and cancelling are
+ * O(1) list operations. Timers in upper levels are cascaded down as time
+ * reaches their slot, so expiring many timers never needs a scan, and
+ * advancing skips empty stretches of the first level. Delays beyond the
+ * top level's range (about 18.6 hours at 1ms ticks) are clamped and
+ * re-cascaded on expiry.
+ *
+ * Not thread safe, meant to be owned by an event loop.
+ */
+class TimerWheel
+{
+ public:
+  using clock = std::chrono::steady_clock;
+
+  /** @param tick Resolution, timers fire at most this late. */
+  explicit TimerWheel(
+    std::chrono::milliseconds tick = std::chrono::milliseconds(1));
+  ~TimerWheel();
+
+  TimerWheel(const TimerWheel &) = delete;
+
+  /** @brief Fire \p timer after \p delay. Re-arms an armed timer.
+   *
+   * The delay counts from the clock, or from the tick being processed if
+   * advance() is ahead of it, e.g. within a callback.
+   */
+  void schedule(Timer &timer, std::chrono::milliseconds delay);
+
+  /**
+   * @brief Fire every timer due by \p now.
+   *
+   * @return Number of timers fired.
+   */
+  size_t advance(clock::time_point now = clock::now());
+
+  /** @brief Time until advance() may have work, none if nothing is armed
+   *
+   * Exact for timers in the first level, and never past the next cascade
+   * while upper levels hold timers.
+   */
+  std::optional<std::chrono::milliseconds> timeout(
+    clock::time_point now = clock::now()) const;
+
+  /** @brief Number of armed timers */
+  size_t size() const
+  {
+    return mSize;
+  }
+
+ private:
+  friend class Timer;
+
+  static constexpr unsigned int rootBits = 8, levelBits = 6, levels = 4;
+  static constexpr uint64_t rootSlots = 1 << rootBits;
+  static constexpr uint64_t levelSlots = 1 << levelBits;
+
+  /** @brief Link \p timer into the slot for its expiry */
+  void place(Timer &timer);
+
+  /** @brief Move timers of the current upper level slots one level down */
+  void cascade();
+
+  void remove(Timer &timer)
+  {
+    timer.unlink();
+    timer.mWheel = nullptr;
+    mCounts[timer.mLevel]--;
+    mSize--;
+  }
+
+  uint64_t ticks(clock::time_point tp) const
+  {
+    return (tp - mStart) / mTick;
+  }
+
+  /** @brief Timer used as the sentinel of a circular slot list */
+  struct head : Timer
+  {
+    head() : Timer(nullptr){};
+  };
+
+  const std::chrono::milliseconds mTick;
+  const clock::time_point mStart;
+  uint64_t mNow{0}; //!< Next tick to process.
+  size_t mSize{0};
+  std::array<size_t, levels> mCounts{}; //!< Timers per level.
+  std::array<head, rootSlots> mRoot;
+  std::array<std::array<head, levelSlots>, levels - 1> mLevels;
+};
+
+inline void Timer::cancel()
+{
+  if (mWheel)
+    {
+      mWheel->remove(*this);
+    }
+}
+} // namespace Sukat
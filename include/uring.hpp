@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+extern "C"
+{
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+}
+
+#include "epoll.hpp"
+#include "fd.hpp"
+#include "socket.hpp"
+
+namespace Sukat
+{
+/** @brief Completion based socket engine on io_uring
+ *
+ * Offers the SocketListener/SocketConnection operations as completions:
+ * multishot accept, multishot receive into a provided buffer ring shared by
+ * all connections, and linked sends. Operations are queued and submitted in
+ * one io_uring_enter by poll() or submit().
+ *
+ * Needs a 6.0+ kernel. Check supported() at runtime and fall back to a
+ * Reactor when it returns false. The engine is itself an EventHandler, so
+ * its completions can also be driven from a Reactor by registering fd().
+ */
+class UringEngine : public EventHandler
+{
+ public:
+  /** @brief Receiver of completions for one socket
+   *
+   * A handler must outlive its operations. After cancel() keep polling until
+   * idle() before destroying it.
+   */
+  class Handler
+  {
+   public:
+    virtual ~Handler() = default;
+
+    /** @brief New connection from a multishot accept */
+    virtual void accepted(__attribute__((unused)) SocketConnection &&conn){};
+
+    /** @brief Data from a multishot receive. Empty on EOF.
+     *
+     * \p data is only valid during the call, its buffer is returned to the
+     * ring right after.
+     */
+    virtual void received(
+      __attribute__((unused)) std::span<const uint8_t> data){};
+
+    /** @brief Result of one send of a linked chain. */
+    virtual void sent(__attribute__((unused)) int res){};
+
+    /** @brief An operation failed with -errno \p res. */
+    virtual void error(__attribute__((unused)) int res){};
+
+    /** @brief No operations in flight for this handler */
+    bool idle() const
+    {
+      return !mInflight;
+    }
+
+   private:
+    friend class UringEngine;
+
+    int mFd{-1};
+    unsigned int mInflight{0};
+  };
+
+  /** @brief Checks io_uring with provided buffer rings is usable here */
+  static bool supported();
+
+  /**
+   * @param entries     Submission queue size.
+   * @param n_bufs      Receive buffers in the provided ring, power of 2.
+   * @param buf_size    Size of one receive buffer.
+   *
+   * @throw std::system_error If io_uring setup fails.
+   */
+  UringEngine(unsigned int entries = 256, unsigned int n_bufs = 256,
+              size_t buf_size = 4096);
+  ~UringEngine();
+
+  UringEngine(const UringEngine &) = delete;
+
+  /** @brief Arm a multishot accept on \p listener */
+  void accept(const SocketListenerStream &listener, Handler &handler);
+
+  /** @brief Arm a multishot receive on \p conn */
+  void recv(const SocketConnection &conn, Handler &handler);
+
+  /** @brief Send \p iovs in order as a linked chain of sends.
+   *
+   * The buffers must stay valid until their sent() completion.
+   */
+  void send(const SocketConnection &conn, std::span<const struct iovec> iovs,
+            Handler &handler);
+
+  /** @brief Cancel all operations on \p sock */
+  void cancel(const Socket &sock);
+
+  /** @brief Submit queued operations without waiting */
+  int submit();
+
+  /**
+   * @brief Submit queued operations, wait up to \p timeout ms for at least
+   * one completion and dispatch all available ones.
+   *
+   * @return Number of completions dispatched.
+   */
+  size_t poll(int timeout = -1);
+
+  /** @brief Pollable ring fd, readable when completions are pending */
+  int fd() const
+  {
+    return mRing.fd();
+  }
+
+  virtual void handleEvent(__attribute__((unused)) uint32_t events) override
+  {
+    poll(0);
+  }
+
+ private:
+  /** @brief Operation kinds, kept in the low bits of user_data */
+  enum class op : uint64_t
+  {
+    OP_ACCEPT = 1,
+    OP_RECV = 2,
+    OP_SEND = 3,
+    OP_CANCEL = 4,
+  };
+  static constexpr uint64_t opMask = 7;
+
+  struct io_uring_sqe *getSqe();
+  void prepare(struct io_uring_sqe *sqe, uint8_t opcode, Handler *handler,
+               op kind);
+  void complete(const struct io_uring_cqe &cqe);
+  void recycle(uint16_t bid);
+  void armRecv(Handler &handler);
+  void unmap();
+
+  struct io_uring_params mParams{}; //!< Filled by setup, before mRing.
+  const Fd mRing;
+  void *mSqMap{nullptr}, *mCqMap{nullptr};
+  size_t mSqMapLen{0}, mCqMapLen{0};
+  struct io_uring_sqe *mSqes{nullptr};
+  uint32_t *mSqHead{nullptr}, *mSqTail{nullptr}, *mSqArray{nullptr};
+  uint32_t *mCqHead{nullptr}, *mCqTail{nullptr};
+  struct io_uring_cqe *mCqes{nullptr};
+  uint32_t mSqLocalTail{0}; //!< Tail including not yet published entries.
+  uint32_t mToSubmit{0};
+
+  const unsigned int mNumBufs;
+  const size_t mBufSize;
+  struct io_uring_buf_ring *mBufRing{nullptr};
+  std::vector<uint8_t> mBufs;
+  static constexpr uint16_t bufGroup = 0;
+};
+} // namespace Sukat
@@ -1,3 +1,5 @@
+#include "registry.hpp"
+
 
 template <typename T>
 class Connections
@@ -75,7 +77,13 @@ class Connections
 
             for (i = 0; i < n_recv; i++)
               {
-                auto &conn = connections.at(ev[i].data.fd);
+                const int fd = ev[i].data.fd;
+                auto *conn = connections.find(fd);
+
+                if (conn && (ev[i].events & EPOLLIN))
+                  {
+                    rcb(ctx, fd, conn->readData());
+                  }
               }
           }
       }
@@ -107,7 +115,7 @@ class Connections
   }
 
 
-  std::map<int, std::unique_ptr<Socket>> connections;
+  Sukat::Registry<Sukat::SocketConnection> connections;
 
   int efd;
   connected_cb ccb;
@@ -0,0 +1,194 @@
+#include "binlog.hpp"
+
+#include <iomanip>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+using namespace Sukat;
+
+namespace
+{
+/** @brief Bounds checked reader over one record */
+class Cursor
+{
+ public:
+  explicit Cursor(std::string_view data) : mData(data){};
+
+  template <typename T> T get()
+  {
+    T value;
+
+    std::memcpy(&value, take(sizeof(value)).data(), sizeof(value));
+    return value;
+  }
+
+  std::string_view getString()
+  {
+    return take(get<uint32_t>());
+  }
+
+ private:
+  std::string_view take(size_t len)
+  {
+    if (len > mData.size())
+      {
+        throw std::runtime_error("Truncated binary log record");
+      }
+
+    auto part = mData.substr(0, len);
+
+    mData.remove_prefix(len);
+    return part;
+  }
+
+  std::string_view mData;
+};
+
+struct site
+{
+  std::string file;
+  uint32_t line;
+  std::vector<std::optional<std::string>> args; //!< Literal text or none.
+};
+
+void renderArg(Cursor &cur, std::ostream &out)
+{
+  switch (cur.get<BinaryLog::argType>())
+    {
+      case BinaryLog::argType::ARG_BOOL:
+        out << static_cast<bool>(cur.get<uint8_t>());
+        break;
+      case BinaryLog::argType::ARG_CHAR:
+        out << cur.get<char>();
+        break;
+      case BinaryLog::argType::ARG_INT:
+        out << cur.get<int64_t>();
+        break;
+      case BinaryLog::argType::ARG_UINT:
+        out << cur.get<uint64_t>();
+        break;
+      case BinaryLog::argType::ARG_DOUBLE:
+        out << cur.get<double>();
+        break;
+      case BinaryLog::argType::ARG_STRING:
+        out << cur.getString();
+        break;
+      case BinaryLog::argType::ARG_POINTER:
+        out << reinterpret_cast<void *>(cur.get<uint64_t>());
+        break;
+      default:
+        throw std::runtime_error("Unknown argument type in binary log");
+    }
+}
+} // namespace
+
+size_t BinaryLog::decode(std::istream &in, std::ostream &out)
+{
+  std::string header(magic.size(), '\0');
+  std::vector<std::string> records;
+  std::unordered_map<uint32_t, site> sites;
+  size_t lines = 0, unknown = 0;
+
+  if (!in.read(header.data(), header.size()) || header != magic)
+    {
+      throw std::runtime_error("Not a binary log");
+    }
+  while (true)
+    {
+      uint32_t len;
+
+      if (!in.read(reinterpret_cast<char *>(&len), sizeof(len)))
+        {
+          break;
+        }
+
+      std::string &record = records.emplace_back(len, '\0');
+
+      if (!in.read(record.data(), len))
+        {
+          throw std::runtime_error("Truncated binary log");
+        }
+    }
+
+  // Writer threads drain rings in turn, so a site may be defined after its
+  // first use from another thread. Collect the definitions first.
+  for (const auto &record : records)
+    {
+      Cursor cur(record);
+
+      if (cur.get<recordType>() == recordType::RECORD_SITE)
+        {
+          const uint32_t id = cur.get<uint32_t>();
+          site &s = sites[id];
+          uint16_t argc;
+
+          cur.get<uint8_t>();
+          s.line = cur.get<uint32_t>();
+          s.file = cur.getString();
+          for (argc = cur.get<uint16_t>(); argc > 0; argc--)
+            {
+              if (cur.get<argType>() == argType::ARG_LITERAL)
+                {
+                  s.args.emplace_back(cur.getString());
+                }
+              else
+                {
+                  s.args.emplace_back();
+                }
+            }
+        }
+    }
+
+  for (const auto &record : records)
+    {
+      Cursor cur(record);
+
+      switch (cur.get<recordType>())
+        {
+          case recordType::RECORD_LINE:
+            {
+              const uint32_t id = cur.get<uint32_t>();
+              const uint64_t ns = cur.get<uint64_t>();
+              auto it = sites.find(id);
+
+              if (it == sites.end())
+                {
+                  // Its definition was dropped, arguments can't be placed.
+                  unknown++;
+                  break;
+                }
+              out << "[" << ns / 1000000000 << "." << std::setfill('0')
+                  << std::setw(9) << ns % 1000000000 << "] "
+                  << it->second.file << "(" << it->second.line << "): ";
+              for (const auto &arg : it->second.args)
+                {
+                  if (arg)
+                    {
+                      out << arg.value();
+                    }
+                  else
+                    {
+                      renderArg(cur, out);
+                    }
+                }
+              out << "\n";
+              lines++;
+            }
+            break;
+          case recordType::RECORD_DROPPED:
+            out << "Logger: " << cur.get<uint64_t>() << " lines dropped\n";
+            break;
+          case recordType::RECORD_SITE:
+            break;
+          default:
+            throw std::runtime_error("Unknown binary log record");
+        }
+    }
+  if (unknown)
+    {
+      out << "Logger: " << unknown << " lines of undefined sites skipped\n";
+    }
+  return lines;
+}
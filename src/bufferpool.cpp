@@ -0,0 +1,147 @@
+#include "bufferpool.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace Sukat;
+
+static_assert(sizeof(BufferPool::Handle) == sizeof(void *));
+
+/** @brief Shared by the pool and its slabs, freed by whichever goes last */
+struct BufferPool::state
+{
+  state(size_t slab_size, size_t slabs_per_block)
+    : owner(std::this_thread::get_id()), slabSize(slab_size),
+      stride((headerSize + slab_size + headerSize - 1) & ~(headerSize - 1)),
+      perBlock(std::max<size_t>(slabs_per_block, 1))
+  {
+  }
+
+  const std::thread::id owner;
+  const size_t slabSize, stride, perBlock;
+  std::atomic<size_t> refs{1};        //!< The pool plus one per slab out.
+  slab *freeList{nullptr};            //!< Owner thread only.
+  std::atomic<slab *> remote{nullptr}; //!< Released on other threads.
+  std::vector<std::unique_ptr<uint8_t[]>> blocks;
+  size_t allocated{0}, available{0};
+
+  void unref() noexcept
+  {
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        delete this;
+      }
+  }
+
+  void carve()
+  {
+    auto block = std::make_unique_for_overwrite<uint8_t[]>(
+      stride * perBlock + headerSize);
+    // new[] only guarantees fundamental alignment.
+    uint8_t *base = reinterpret_cast<uint8_t *>(
+      (reinterpret_cast<uintptr_t>(block.get()) + headerSize - 1) &
+      ~(headerSize - 1));
+    size_t i;
+
+    for (i = 0; i < perBlock; i++)
+      {
+        slab *s = new (base + i * stride) slab{this, {0},
+                                               static_cast<uint32_t>(slabSize),
+                                               freeList};
+        freeList = s;
+      }
+    blocks.emplace_back(std::move(block));
+    allocated += perBlock;
+    available += perBlock;
+  }
+};
+
+BufferPool::BufferPool(size_t slab_size, size_t slabs_per_block)
+  : mState(new state(slab_size, slabs_per_block))
+{
+}
+
+BufferPool::~BufferPool()
+{
+  mState->unref();
+}
+
+BufferPool::Handle BufferPool::get()
+{
+  state &st = *mState;
+
+  if (!st.freeList)
+    {
+      // Take over everything other threads gave back in one go.
+      slab *s = st.remote.exchange(nullptr, std::memory_order_acquire);
+
+      while (s)
+        {
+          slab *next = s->next;
+
+          s->next = st.freeList;
+          st.freeList = s;
+          st.available++;
+          s = next;
+        }
+    }
+  if (!st.freeList)
+    {
+      st.carve();
+    }
+
+  slab *s = st.freeList;
+
+  st.freeList = s->next;
+  st.available--;
+  s->refs.store(1, std::memory_order_relaxed);
+  st.refs.fetch_add(1, std::memory_order_relaxed);
+  return Handle(s);
+}
+
+void BufferPool::release(slab *s) noexcept
+{
+  state &st = *s->owner;
+
+  if (std::this_thread::get_id() == st.owner)
+    {
+      s->next = st.freeList;
+      st.freeList = s;
+      st.available++;
+    }
+  else
+    {
+      s->next = st.remote.load(std::memory_order_relaxed);
+      while (!st.remote.compare_exchange_weak(s->next, s,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed))
+        {
+        }
+    }
+  st.unref();
+}
+
+size_t BufferPool::slabSize() const
+{
+  return mState->slabSize;
+}
+
+size_t BufferPool::allocated() const
+{
+  return mState->allocated;
+}
+
+size_t BufferPool::available() const
+{
+  return mState->available;
+}
+
+BufferPool &BufferPool::local()
+{
+  thread_local BufferPool pool;
+
+  return pool;
+}
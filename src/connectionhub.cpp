@@ -0,0 +1,275 @@
+#include "connectionhub.hpp"
+
+extern "C"
+{
+#include <sys/eventfd.h>
+}
+
+using namespace Sukat;
+
+/** @brief A reactor thread and the connections it owns */
+class ConnectionHub::Worker
+{
+ public:
+  using task = std::function<void(Worker &)>;
+
+  Worker(ConnectionHub &hub, unsigned int index)
+    : mHub(hub), mIndex(index), mEventFd(::eventfd(0, EFD_NONBLOCK |
+                                                      EFD_CLOEXEC))
+  {
+    if (mEventFd.fd() == -1)
+      {
+        throw std::system_error(errno, std::system_category(), "eventfd");
+      }
+    if (!mReactor.add(mEventFd.fd(), mWakeup))
+      {
+        throw std::system_error(errno, std::system_category(),
+                                "Failed to register eventfd");
+      }
+    mThread = std::jthread([this]() {
+      LOG_DBG("Hub worker ", mIndex, " running");
+      mReactor.run();
+      mConns.clear();
+    });
+  }
+
+  ~Worker()
+  {
+    post([](Worker &worker) { worker.mReactor.stop(); });
+    mThread.join();
+  }
+
+  /** @brief Queue \p work for this thread. Any thread. */
+  void post(task work)
+  {
+    mTasks.push(std::move(work));
+    // Pairs with the one in drain(): either it sees the push or we see the
+    // flag cleared and signal again.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!mSignalled.exchange(true, std::memory_order_acq_rel))
+      {
+        uint64_t one = 1;
+
+        if (::write(mEventFd.fd(), &one, sizeof(one)) != sizeof(one))
+          {
+            LOG_ERR("Failed to wake hub worker ", mIndex, ": ",
+                    ::strerror(errno));
+          }
+      }
+  }
+
+  /** @brief Take ownership of \p conn. Owner thread only. */
+  void adopt(SocketConnection &&conn, uint64_t serial)
+  {
+    const int fd = conn.fd();
+    const uint32_t events = (conn.connComplete()) ? EPOLLIN : EPOLLOUT;
+
+    if (mConns.emplace(fd, *this, std::move(conn), serial))
+      {
+        if (mReactor.add(fd, *mConns.find(fd), events))
+          {
+            return;
+          }
+        mConns.erase(fd);
+      }
+    mLoad.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  /** @brief Run \p work on connection \p id. Owner thread only. */
+  void run(const connectionId &id, const workCb &work)
+  {
+    if (Connection *conn = find(id))
+      {
+        work(*conn);
+      }
+    else
+      {
+        LOG_DBG("Work for closed connection ", id.fd, " dropped");
+      }
+  }
+
+  /** @brief Close connection \p id. Owner thread only. */
+  void close(const connectionId &id)
+  {
+    if (Connection *conn = find(id))
+      {
+        close(*conn);
+      }
+  }
+
+  unsigned int index() const
+  {
+    return mIndex;
+  }
+
+  std::atomic<size_t> mLoad{0}; //!< Connections owned or being handed over.
+
+ private:
+  class Connection : public SocketConnection, public EventHandler
+  {
+   public:
+    Connection(Worker &owner, SocketConnection &&conn, uint64_t serial)
+      : SocketConnection(std::move(conn)), mSerial(serial), mOwner(owner),
+        mConnected(connComplete())
+    {
+    }
+
+    const uint64_t mSerial; //!< Tells apart connections reusing an fd.
+
+    virtual void handleEvent(uint32_t events) override
+    {
+      bool keep = true;
+
+      if (!mConnected && (events & EPOLLOUT))
+        {
+          int err = polloutReady();
+
+          mConnected = !err;
+          if (!mConnected)
+            {
+              LOG_ERR("Failed to connect ", this, ": ", ::strerror(err));
+              events |= EPOLLERR;
+            }
+          else if (!mOwner.mReactor.modify(fd(), *this, EPOLLIN))
+            {
+              events |= EPOLLERR;
+            }
+        }
+      keep = mOwner.mHub.mCb(*this, events) &&
+             !(events & (EPOLLERR | EPOLLHUP));
+      if (!keep)
+        {
+          mOwner.close(*this);
+        }
+    }
+
+   private:
+    Worker &mOwner;
+    bool mConnected;
+  };
+
+  Connection *find(const connectionId &id)
+  {
+    Connection *conn = mConns.find(id.fd);
+
+    return (conn && conn->mSerial == id.serial) ? conn : nullptr;
+  }
+
+  void close(Connection &conn)
+  {
+    const int fd = conn.fd();
+
+    mReactor.remove(fd, conn);
+    mConns.erase(fd);
+    mLoad.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void drain()
+  {
+    uint64_t count;
+
+    if (::read(mEventFd.fd(), &count, sizeof(count)) < 0 && errno != EAGAIN)
+      {
+        LOG_ERR("Failed to read hub eventfd: ", ::strerror(errno));
+      }
+    // Clear before draining so a push racing with us signals again. The
+    // store must not pass the first pop, hence seq_cst.
+    mSignalled.exchange(false, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (auto work = mTasks.pop())
+      {
+        work.value()(*this);
+      }
+  }
+
+  ConnectionHub &mHub;
+  const unsigned int mIndex;
+  const Fd mEventFd;
+  Reactor mReactor;
+  EventCallback<std::function<void(uint32_t)>> mWakeup{
+    [this](uint32_t) { drain(); }};
+  MpscQueue<task> mTasks;
+  std::atomic<bool> mSignalled{false};
+  Registry<Connection> mConns;
+  std::jthread mThread;
+};
+
+ConnectionHub::ConnectionHub(eventCb cb, unsigned int n_threads,
+                             assignPolicy policy)
+  : mCb(cb), mPolicy(policy)
+{
+  unsigned int i;
+
+  for (i = 0; i < std::max(n_threads, 1U); i++)
+    {
+      mWorkers.emplace_back(std::make_unique<Worker>(*this, i));
+    }
+}
+
+ConnectionHub::~ConnectionHub() = default;
+
+ConnectionHub::connectionId ConnectionHub::connect(int type,
+                                                   const std::string &dst,
+                                                   const std::string &port)
+{
+  AddrInfo endpoint(dst, port, {}, type);
+
+  return add(SocketConnection(endpoint.mResults.front()));
+}
+
+ConnectionHub::connectionId ConnectionHub::add(SocketConnection &&conn)
+{
+  Worker *owner = mWorkers.front().get();
+  const int fd = conn.fd();
+
+  if (mPolicy == assignPolicy::ASSIGN_HASH)
+    {
+      owner = mWorkers[std::hash<int>()(fd) % mWorkers.size()].get();
+    }
+  else
+    {
+      for (const auto &worker : mWorkers)
+        {
+          if (worker->mLoad.load(std::memory_order_relaxed) <
+              owner->mLoad.load(std::memory_order_relaxed))
+            {
+              owner = worker.get();
+            }
+        }
+    }
+  owner->mLoad.fetch_add(1, std::memory_order_relaxed);
+
+  const connectionId id = {owner->index(), fd,
+                           mSerial.fetch_add(1, std::memory_order_relaxed)};
+  // Tasks are copyable std::functions, so the move-only connection rides
+  // along in a shared_ptr.
+  auto shared = std::make_shared<SocketConnection>(std::move(conn));
+
+  owner->post([shared, serial = id.serial](Worker &worker) {
+    worker.adopt(std::move(*shared), serial);
+  });
+  LOG_DBG("Connection ", fd, " assigned to worker ", owner->index());
+  return id;
+}
+
+void ConnectionHub::post(connectionId id, workCb work)
+{
+  mWorkers.at(id.worker)->post(
+    [id, work](Worker &worker) { worker.run(id, work); });
+}
+
+void ConnectionHub::remove(connectionId id)
+{
+  mWorkers.at(id.worker)->post([id](Worker &worker) { worker.close(id); });
+}
+
+size_t ConnectionHub::size() const
+{
+  size_t total = 0;
+
+  for (const auto &worker : mWorkers)
+    {
+      total += worker->mLoad.load(std::memory_order_relaxed);
+    }
+  return total;
+}
@@ -0,0 +1,203 @@
+#include "connector.hpp"
+
+using namespace Sukat;
+
+/** @brief One connect in flight */
+class Connector::Attempt : public EventHandler
+{
+ public:
+  Attempt(Connector &owner, SocketConnection &&conn)
+    : mConn(std::move(conn)), mOwner(owner)
+  {
+  }
+
+  virtual void handleEvent(uint32_t events) override
+  {
+    mOwner.finished(*this, events);
+  }
+
+  SocketConnection mConn;
+
+ private:
+  Connector &mOwner;
+};
+
+Connector::Connector(Reactor &reactor,
+                     const std::vector<Socket::endpoint> &endpoints,
+                     __socket_type type, connectCb cb,
+                     std::chrono::milliseconds delay)
+  : mReactor(reactor), mType(type), mCb(std::move(cb)), mDelay(delay),
+    mCandidates(interleave(endpoints)), mStagger([this]() {
+      LOG_DBG("Attempt delay passed, starting next");
+      if (next())
+        {
+          mReactor.schedule(mStagger, mDelay);
+        }
+    }),
+    mDeadline([this]() {
+      LOG_DBG("Connect timed out with ", mAttempts.size(),
+              " attempts running");
+      for (auto &attempt : mAttempts)
+        {
+          mReactor.remove(attempt->mConn.fd(), *attempt);
+        }
+      mAttempts.clear();
+      mCandidates.clear();
+      fail(ETIMEDOUT);
+    })
+{
+}
+
+static std::vector<Socket::endpoint> toEndpoints(const AddrInfo &info)
+{
+  std::vector<Socket::endpoint> endpoints;
+
+  for (auto *res : info.mResults)
+    {
+      endpoints.emplace_back(Socket::make_endpoint(res));
+    }
+  return endpoints;
+}
+
+Connector::Connector(Reactor &reactor, const AddrInfo &info, connectCb cb,
+                     std::chrono::milliseconds delay)
+  : Connector(reactor, toEndpoints(info),
+              static_cast<__socket_type>(
+                (info.mResults.empty()) ? SOCK_STREAM
+                                        : info.mResults.front()->ai_socktype),
+              std::move(cb), delay)
+{
+}
+
+Connector::~Connector()
+{
+  for (auto &attempt : mAttempts)
+    {
+      mReactor.remove(attempt->mConn.fd(), *attempt);
+    }
+}
+
+std::vector<Socket::endpoint>
+Connector::interleave(const std::vector<Socket::endpoint> &endpoints)
+{
+  std::vector<Socket::endpoint> first, second, result;
+
+  for (const auto &ep : endpoints)
+    {
+      if (ep.first.ss_family == endpoints.front().first.ss_family)
+        {
+          first.push_back(ep);
+        }
+      else
+        {
+          second.push_back(ep);
+        }
+    }
+  for (size_t i = 0; i < std::max(first.size(), second.size()); i++)
+    {
+      if (i < first.size())
+        {
+          result.push_back(first[i]);
+        }
+      if (i < second.size())
+        {
+          result.push_back(second[i]);
+        }
+    }
+  return result;
+}
+
+void Connector::start()
+{
+  if (mTimeout.count() > 0)
+    {
+      mReactor.schedule(mDeadline, mTimeout);
+    }
+  if (!next())
+    {
+      fail(mError ? mError : EDESTADDRREQ);
+      return;
+    }
+  mReactor.schedule(mStagger, mDelay);
+}
+
+bool Connector::next()
+{
+  while (mNext < mCandidates.size())
+    {
+      const Socket::endpoint &dst = mCandidates[mNext++];
+
+      try
+        {
+          auto attempt = std::make_unique<Attempt>(
+            *this, SocketConnection(mType, dst));
+
+          // Even a connect that finished right away reports EPOLLOUT.
+          if (mReactor.add(attempt->mConn.fd(), *attempt, EPOLLOUT))
+            {
+              LOG_DBG("Connecting to ", Socket::endpoint_to_string(dst));
+              mAttempts.emplace_back(std::move(attempt));
+              return true;
+            }
+          mError = errno;
+        }
+      catch (std::system_error &e)
+        {
+          LOG_DBG("Connect to ", Socket::endpoint_to_string(dst),
+                  " failed: ", e.what());
+          mError = e.code().value();
+        }
+    }
+  return false;
+}
+
+void Connector::finished(Attempt &attempt, uint32_t events)
+{
+  const int err = attempt.mConn.polloutReady();
+  auto it = std::find_if(mAttempts.begin(), mAttempts.end(),
+                         [&](const auto &a) { return a.get() == &attempt; });
+  std::unique_ptr<Attempt> done = std::move(*it);
+
+  mAttempts.erase(it);
+  mReactor.remove(done->mConn.fd(), *done);
+  if (!err && !(events & (EPOLLERR | EPOLLHUP)))
+    {
+      std::optional<SocketConnection> conn(std::move(done->mConn));
+
+      LOG_DBG("Connected ", &conn.value(), ", closing ", mAttempts.size(),
+              " other attempts");
+      for (auto &other : mAttempts)
+        {
+          mReactor.remove(other->mConn.fd(), *other);
+        }
+      mAttempts.clear();
+      stopTimers();
+      mCandidates.clear();
+      // Last, the callback may destroy us.
+      mCb(std::move(conn), 0);
+      return;
+    }
+  mError = (err > 0) ? err : ECONNREFUSED;
+  LOG_DBG("Connect attempt failed: ", ::strerror(mError));
+  // Don't wait out the delay for a path known to be dead.
+  if (next())
+    {
+      mReactor.schedule(mStagger, mDelay);
+    }
+  else if (mAttempts.empty())
+    {
+      fail(mError);
+    }
+}
+
+void Connector::fail(int error)
+{
+  stopTimers();
+  mCb(std::nullopt, error);
+}
+
+void Connector::stopTimers()
+{
+  mStagger.cancel();
+  mDeadline.cancel();
+}
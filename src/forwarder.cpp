@@ -0,0 +1,213 @@
+#include "forwarder.hpp"
+
+#include <system_error>
+
+extern "C"
+{
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+}
+
+using namespace Sukat;
+
+Forwarder::Forwarder(int in, int out, size_t pipe_size)
+  : mIn(in), mOut(out), mMode(mode::MODE_SPLICE)
+{
+  struct stat st;
+  int pipefd[2];
+
+  if (!::fstat(in, &st) && S_ISREG(st.st_mode))
+    {
+      mMode = mode::MODE_SENDFILE;
+      return;
+    }
+  if (::pipe2(pipefd, O_NONBLOCK | O_CLOEXEC))
+    {
+      throw std::system_error(errno, std::system_category(), "pipe2");
+    }
+  mPipeRd.emplace(pipefd[0]);
+  mPipeWr.emplace(pipefd[1]);
+  if (pipe_size && ::fcntl(pipefd[1], F_SETPIPE_SZ, pipe_size) == -1)
+    {
+      LOG_DBG("Failed to resize splice pipe to ", pipe_size, ": ",
+              ::strerror(errno));
+    }
+  const int size = ::fcntl(pipefd[1], F_GETPIPE_SZ);
+
+  mPipeSize = (size > 0) ? size : 65536;
+}
+
+bool Forwarder::fallback()
+{
+  LOG_DBG("Splicing ", mIn, " to ", mOut, " unsupported, copying instead");
+  BufferPool &pool = BufferPool::local();
+
+  // Whatever is already in the pipe has to fit.
+  if (mPending <= pool.slabSize())
+    {
+      mBuf.emplace(pool.get());
+    }
+  else
+    {
+      mBuf.emplace(mPipeSize);
+    }
+  while (mPending)
+    {
+      auto space = mBuf->writable();
+      ssize_t ret = ::read(mPipeRd->fd(), space.data(), space.size());
+
+      if (ret <= 0)
+        {
+          return false;
+        }
+      mBuf->commit(ret);
+      mPending -= std::min<size_t>(ret, mPending);
+    }
+  mMode = mode::MODE_COPY;
+  return true;
+}
+
+ssize_t Forwarder::pull(size_t len)
+{
+  if (mMode == mode::MODE_COPY)
+    {
+      mBuf->compact();
+      auto space = mBuf->writable();
+      ssize_t ret = ::read(mIn, space.data(), std::min(len, space.size()));
+
+      if (ret > 0)
+        {
+          mBuf->commit(ret);
+        }
+      return ret;
+    }
+
+  ssize_t ret = ::splice(mIn, nullptr, mPipeWr->fd(), nullptr, len,
+                         SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+  if (ret > 0)
+    {
+      mPending += ret;
+    }
+  return ret;
+}
+
+ssize_t Forwarder::push(size_t len)
+{
+  ssize_t ret;
+
+  switch (mMode)
+    {
+      case mode::MODE_SENDFILE:
+        return ::sendfile(mOut, mIn, nullptr, len);
+      case mode::MODE_COPY:
+        ret = ::write(mOut, mBuf->readable().data(), mBuf->size());
+        if (ret > 0)
+          {
+            mBuf->consume(ret);
+          }
+        return ret;
+      case mode::MODE_SPLICE:
+        break;
+    }
+  ret = ::splice(mPipeRd->fd(), nullptr, mOut, nullptr, mPending,
+                 SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  if (ret > 0)
+    {
+      mPending -= ret;
+    }
+  return ret;
+}
+
+Forwarder::forwardResult Forwarder::forward(size_t max) noexcept
+{
+  forwardResult result = {forwardStatus::FWD_IN_AGAIN, 0, 0};
+  bool in_again = false;
+
+  while (true)
+    {
+      const size_t capacity = (mBuf) ? mBuf->capacity() : mPipeSize;
+      ssize_t ret;
+
+      // Sendfile has no intermediate stage, push() reads the file.
+      if (mMode != mode::MODE_SENDFILE && !mEof && !in_again &&
+          result.bytes < max && pending() < capacity)
+        {
+          ret = pull(std::min(capacity - pending(), max - result.bytes));
+          if (ret == 0)
+            {
+              mEof = true;
+            }
+          else if (ret == -1)
+            {
+              if (errno == EINTR)
+                {
+                  continue;
+                }
+              else if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                  in_again = true;
+                }
+              else if (errno == EINVAL && mMode == mode::MODE_SPLICE &&
+                       fallback())
+                {
+                  continue;
+                }
+              else
+                {
+                  result = {forwardStatus::FWD_ERROR, result.bytes, errno};
+                  break;
+                }
+            }
+        }
+      if (pending() || (mMode == mode::MODE_SENDFILE && !mEof &&
+                        result.bytes < max))
+        {
+          ret = push((mMode == mode::MODE_SENDFILE) ? max - result.bytes
+                                                    : pending());
+          if (ret > 0)
+            {
+              result.bytes += ret;
+            }
+          else if (ret == 0 && mMode == mode::MODE_SENDFILE)
+            {
+              mEof = true;
+            }
+          else if (ret == -1 && errno == EINTR)
+            {
+              continue;
+            }
+          else if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+              result.status = forwardStatus::FWD_OUT_AGAIN;
+              break;
+            }
+          else if (ret == -1 && errno == EINVAL &&
+                   mMode != mode::MODE_COPY && fallback())
+            {
+              continue;
+            }
+          else
+            {
+              result = {forwardStatus::FWD_ERROR, result.bytes,
+                        (ret == -1) ? errno : EIO};
+              break;
+            }
+        }
+      if (!pending())
+        {
+          if (mEof)
+            {
+              result.status = forwardStatus::FWD_EOF;
+              break;
+            }
+          if (in_again || result.bytes >= max)
+            {
+              break;
+            }
+        }
+    }
+  LOG_DBG("Forwarded ", result.bytes, " bytes from ", mIn, " to ", mOut);
+  return result;
+}
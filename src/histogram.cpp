@@ -0,0 +1,75 @@
+#include "histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace Sukat;
+
+Histogram::Histogram(unsigned int precision)
+  : mPrecision(std::clamp(precision, 1U, 16U)),
+    mHalf(uint64_t{1} << mPrecision),
+    mCounts((65 - mPrecision) * mHalf)
+{
+}
+
+void Histogram::merge(const Histogram &other)
+{
+  size_t i;
+
+  if (other.mPrecision != mPrecision)
+    {
+      throw std::invalid_argument("Merging histograms of other precision");
+    }
+  for (i = 0; i < mCounts.size(); i++)
+    {
+      mCounts[i] += other.mCounts[i];
+    }
+  mTotal += other.mTotal;
+  mSum += other.mSum;
+  mMin = std::min(mMin, other.mMin);
+  mMax = std::max(mMax, other.mMax);
+}
+
+void Histogram::reset()
+{
+  std::fill(mCounts.begin(), mCounts.end(), 0);
+  mTotal = mSum = mMax = 0;
+  mMin = UINT64_MAX;
+}
+
+uint64_t Histogram::highest(size_t i) const
+{
+  if (i < (mHalf << 1))
+    {
+      return i;
+    }
+
+  // Inverse of index(): bucket i holds [top << shift, (top + 1) << shift).
+  const uint64_t shift = i / mHalf - 1;
+  const uint64_t top = i - shift * mHalf;
+
+  return (top << shift) + ((uint64_t{1} << shift) - 1);
+}
+
+uint64_t Histogram::percentile(double percentile) const
+{
+  const uint64_t rank = std::max<uint64_t>(
+    1, std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * mTotal));
+  uint64_t seen = 0;
+  size_t i;
+
+  if (!mTotal)
+    {
+      return 0;
+    }
+  for (i = 0; i < mCounts.size(); i++)
+    {
+      seen += mCounts[i];
+      if (seen >= rank)
+        {
+          return std::min(highest(i), mMax);
+        }
+    }
+  return mMax;
+}
@@ -0,0 +1,121 @@
+#include "listenergroup.hpp"
+
+extern "C"
+{
+#include <linux/filter.h>
+#include <pthread.h>
+#include <sched.h>
+}
+
+using namespace Sukat;
+
+ListenerGroup::ListenerGroup(Socket::endpoint ep, __socket_type socktype,
+                             unsigned int n_workers, bool cpu_affine)
+  : mEndpoint(ep), mCpuAffine(cpu_affine)
+{
+  unsigned int i;
+
+  for (i = 0; i < std::max(n_workers, 1U); i++)
+    {
+      if (socktype == SOCK_DGRAM)
+        {
+          mListeners.emplace_back(
+            std::make_unique<SocketListenerUdp>(mEndpoint));
+        }
+      else
+        {
+          mListeners.emplace_back(std::make_unique<SocketListenerStream>(
+            mEndpoint,
+            std::set{std::make_pair<int, int>(SO_REUSEADDR, 1),
+                     std::make_pair<int, int>(SO_REUSEPORT, 1)},
+            socktype));
+        }
+      if (!i)
+        {
+          // Resolve a possible ephemeral port for the rest of the group.
+          mEndpoint = mListeners.front()->getSource().value();
+        }
+    }
+  LOG_DBG("Created group of ", mListeners.size(), " listeners on ",
+          Socket::endpoint_to_string(mEndpoint));
+  if (mCpuAffine && !attachCpuSteering())
+    {
+      LOG_ERR("CPU steering unavailable, using kernel hash");
+    }
+}
+
+ListenerGroup::~ListenerGroup()
+{
+  stop();
+}
+
+void ListenerGroup::run(workerCb cb)
+{
+  unsigned int i;
+
+  for (i = 0; i < mListeners.size(); i++)
+    {
+      mWorkers.emplace_back([this, cb, i](std::stop_token stop) {
+        if (mCpuAffine)
+          {
+            cpu_set_t cpus;
+
+            CPU_ZERO(&cpus);
+            CPU_SET(i % std::thread::hardware_concurrency(), &cpus);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus))
+              {
+                LOG_ERR("Failed to pin worker ", i);
+              }
+          }
+        LOG_DBG("Worker ", i, " running on ", mListeners[i].get());
+        cb(*mListeners[i], i, stop);
+      });
+    }
+}
+
+void ListenerGroup::stop()
+{
+  for (auto &worker : mWorkers)
+    {
+      worker.request_stop();
+    }
+  mWorkers.clear();
+}
+
+bool ListenerGroup::attachCpuSteering() const
+{
+  struct sock_filter code[] = {
+    // A = raw_smp_processor_id()
+    {BPF_LD | BPF_W | BPF_ABS, 0, 0,
+     static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)},
+    // A = A % n_listeners
+    {BPF_ALU | BPF_MOD | BPF_K, 0, 0,
+     static_cast<uint32_t>(mListeners.size())},
+    // Return A as the listener index.
+    {BPF_RET | BPF_A, 0, 0, 0},
+  };
+  struct sock_fprog prog = {
+    .len = sizeof(code) / sizeof(code[0]),
+    .filter = code,
+  };
+
+  if (!::setsockopt(mListeners.front()->fd(), SOL_SOCKET,
+                    SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)))
+    {
+      return true;
+    }
+  LOG_ERR("Failed to attach reuseport cBPF: ", ::strerror(errno));
+  return false;
+}
+
+bool ListenerGroup::attachProgram(int prog_fd) const
+{
+  if (!::setsockopt(mListeners.front()->fd(), SOL_SOCKET,
+                    SO_ATTACH_REUSEPORT_EBPF, &prog_fd, sizeof(prog_fd)))
+    {
+      return true;
+    }
+  LOG_ERR("Failed to attach reuseport eBPF ", prog_fd, ": ",
+          ::strerror(errno));
+  return false;
+}
@@ -1,6 +1,346 @@
 #include "logging.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <thread>
+#include <vector>
+
 using namespace Sukat;
 
 std::unique_ptr<Logger> Logger::log_instance = nullptr;
 std::once_flag Logger::onceFlag;
+std::atomic<int> Logger::log_level{-1};
+
+/** @brief Background thread draining per-thread rings of formatted lines */
+class Logger::AsyncWriter
+{
+ public:
+  AsyncWriter(Logger &logger, overflowPolicy policy, size_t ring_size)
+    : mLogger(logger), mPolicy(policy),
+      mRingSize(std::bit_ceil(std::max<size_t>(ring_size, 256)))
+  {
+    mThread = std::jthread([this](std::stop_token stop) { run(stop); });
+  }
+
+  ~AsyncWriter()
+  {
+    mThread.request_stop();
+    wake(true);
+    mThread.join();
+  }
+
+  /** @brief Copy \p line into the calling thread's ring, false if dropped */
+  bool push(LogLevel lvl, std::string_view line)
+  {
+    Ring &ring = local();
+
+    if (mLogger.binary && line.size() > mRingSize - sizeof(record))
+      {
+        // Cutting would corrupt the records.
+        mDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+
+    // Lines longer than a ring are cut rather than never fitting.
+    const record rec = {
+      static_cast<uint32_t>(std::min(line.size(),
+                                     mRingSize - sizeof(record))),
+      static_cast<uint32_t>(lvl)};
+    const size_t need = sizeof(rec) + rec.len;
+    const size_t head = ring.head.load(std::memory_order_relaxed);
+
+    while (head + need - ring.tail.load(std::memory_order_acquire) >
+           mRingSize)
+      {
+        if (mPolicy == overflowPolicy::OVERFLOW_DROP)
+          {
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+          }
+        wake(true);
+        std::this_thread::yield();
+      }
+    ring.copyIn(head, &rec, sizeof(rec));
+    ring.copyIn(head + sizeof(rec), line.data(), rec.len);
+    ring.head.store(head + need, std::memory_order_release);
+    wake(false);
+    return true;
+  }
+
+  void flush()
+  {
+    while (pending())
+      {
+        wake(true);
+        std::this_thread::yield();
+      }
+
+    // The pass that emptied the rings may still be writing, wait for one
+    // started after it.
+    const uint64_t start = mPasses.load(std::memory_order_acquire);
+
+    while (mPasses.load(std::memory_order_acquire) < start + 2)
+      {
+        wake(true);
+        std::this_thread::yield();
+      }
+  }
+
+  uint64_t dropped() const
+  {
+    return mDropped.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct record
+  {
+    uint32_t len;
+    uint32_t lvl;
+  };
+
+  /** @brief Single producer, single consumer byte ring of records */
+  struct Ring
+  {
+    explicit Ring(size_t size) : data(size){};
+
+    void copyIn(size_t pos, const void *src, size_t len)
+    {
+      const size_t off = pos & (data.size() - 1);
+      const size_t first = std::min(len, data.size() - off);
+
+      std::memcpy(&data[off], src, first);
+      std::memcpy(data.data(), static_cast<const char *>(src) + first,
+                  len - first);
+    }
+
+    void copyOut(size_t pos, void *dst, size_t len) const
+    {
+      const size_t off = pos & (data.size() - 1);
+      const size_t first = std::min(len, data.size() - off);
+
+      std::memcpy(dst, &data[off], first);
+      std::memcpy(static_cast<char *>(dst) + first, data.data(),
+                  len - first);
+    }
+
+    std::vector<char> data;
+    alignas(64) std::atomic<size_t> head{0}; //!< Written by the owner.
+    alignas(64) std::atomic<size_t> tail{0}; //!< Written by the writer.
+    std::atomic<bool> orphaned{false};       //!< Owner thread has exited.
+  };
+
+  /** @brief Ring of the calling thread, registered on first use */
+  Ring &local()
+  {
+    struct slot
+    {
+      std::shared_ptr<Ring> ring;
+      AsyncWriter *owner{nullptr};
+
+      ~slot()
+      {
+        if (ring)
+          {
+            ring->orphaned.store(true, std::memory_order_release);
+          }
+      }
+    };
+    thread_local slot mine;
+
+    if (mine.owner != this)
+      {
+        std::lock_guard lock(mRingsMutex);
+
+        mine.ring = std::make_shared<Ring>(mRingSize);
+        mine.owner = this;
+        mRings.push_back(mine.ring);
+      }
+    return *mine.ring;
+  }
+
+  /** @brief Signal the writer, a syscall only if it's asleep or \p force */
+  void wake(bool force)
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (force || (mSleeping.load(std::memory_order_relaxed) &&
+                  mSleeping.exchange(false, std::memory_order_relaxed)))
+      {
+        mSeq.fetch_add(1, std::memory_order_release);
+        mSeq.notify_one();
+      }
+  }
+
+  bool pending()
+  {
+    std::lock_guard lock(mRingsMutex);
+
+    for (const auto &ring : mRings)
+      {
+        if (ring->tail.load(std::memory_order_relaxed) !=
+            ring->head.load(std::memory_order_acquire))
+          {
+            return true;
+          }
+      }
+    return false;
+  }
+
+  /** @brief Move all queued lines to the batches. Returns lines taken. */
+  size_t drain()
+  {
+    std::lock_guard lock(mRingsMutex);
+    size_t lines = 0;
+
+    for (auto it = mRings.begin(); it != mRings.end();)
+      {
+        Ring &ring = **it;
+        // Checked before draining so nothing pushed before exit is lost.
+        const bool orphaned = ring.orphaned.load(std::memory_order_acquire);
+        const size_t head = ring.head.load(std::memory_order_acquire);
+        size_t tail = ring.tail.load(std::memory_order_relaxed);
+
+        while (tail != head)
+          {
+            record rec;
+
+            ring.copyOut(tail, &rec, sizeof(rec));
+
+            // A file gets everything in order.
+            std::string &dst =
+              (static_cast<LogLevel>(rec.lvl) == LogLevel::ERROR &&
+               !mLogger.output_file.is_open())
+                ? mErr
+                : mOut;
+            const size_t at = dst.size();
+
+            dst.resize(at + rec.len);
+            ring.copyOut(tail + sizeof(rec), &dst[at], rec.len);
+            tail += sizeof(rec) + rec.len;
+            lines++;
+          }
+        ring.tail.store(tail, std::memory_order_release);
+        it = (orphaned) ? mRings.erase(it) : it + 1;
+      }
+    return lines;
+  }
+
+  void write()
+  {
+    const uint64_t dropped = mDropped.load(std::memory_order_relaxed);
+
+    if (dropped != mReportedDrops && mLogger.binary)
+      {
+        BinaryLog::encodeDropped(mOut, dropped - mReportedDrops);
+        mReportedDrops = dropped;
+      }
+    else if (dropped != mReportedDrops)
+      {
+        mErr += "Logger: " + std::to_string(dropped - mReportedDrops) +
+                " lines dropped\n";
+        mReportedDrops = dropped;
+      }
+    if (mLogger.output_file.is_open())
+      {
+        mLogger.output_file << mErr << mOut;
+        mLogger.output_file.flush();
+      }
+    else
+      {
+        if (!mOut.empty())
+          {
+            std::cout.write(mOut.data(), mOut.size());
+            std::cout.flush();
+          }
+        if (!mErr.empty())
+          {
+            std::cerr.write(mErr.data(), mErr.size());
+            std::cerr.flush();
+          }
+      }
+    mOut.clear();
+    mErr.clear();
+  }
+
+  void run(std::stop_token stop)
+  {
+    while (true)
+      {
+        const bool stopping = stop.stop_requested();
+        const uint32_t seq = mSeq.load(std::memory_order_acquire);
+
+        if (drain() || mDropped.load(std::memory_order_relaxed) !=
+                         mReportedDrops)
+          {
+            write();
+          }
+        else if (stopping)
+          {
+            mPasses.fetch_add(1, std::memory_order_release);
+            break;
+          }
+        else
+          {
+            mSleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!pending())
+              {
+                mPasses.fetch_add(1, std::memory_order_release);
+                mSeq.wait(seq, std::memory_order_acquire);
+              }
+            mSleeping.store(false, std::memory_order_relaxed);
+            continue;
+          }
+        mPasses.fetch_add(1, std::memory_order_release);
+      }
+  }
+
+  Logger &mLogger;
+  const overflowPolicy mPolicy;
+  const size_t mRingSize;
+  std::mutex mRingsMutex; //!< Guards mRings, producers only on first use.
+  std::vector<std::shared_ptr<Ring>> mRings;
+  std::string mOut, mErr; //!< Current batches, writer thread only.
+  std::atomic<uint64_t> mDropped{0};
+  uint64_t mReportedDrops{0};
+  std::atomic<uint32_t> mSeq{0};
+  std::atomic<bool> mSleeping{false};
+  std::atomic<uint64_t> mPasses{0}; //!< Completed writer loop iterations.
+  std::jthread mThread;
+};
+
+Logger::Logger(std::string logfile)
+{
+  if (!logfile.empty())
+    {
+      output_file = std::ofstream(logfile);
+    }
+}
+
+Logger::~Logger() = default;
+
+void Logger::startAsync(overflowPolicy policy, size_t ring_size)
+{
+  async = std::make_unique<AsyncWriter>(*this, policy, ring_size);
+}
+
+bool Logger::submit(LogLevel lvl, std::string_view line)
+{
+  return async->push(lvl, line);
+}
+
+void Logger::flush()
+{
+  if (log_instance && log_instance->async)
+    {
+      log_instance->async->flush();
+    }
+}
+
+uint64_t Logger::dropped()
+{
+  return (log_instance && log_instance->async)
+           ? log_instance->async->dropped()
+           : 0;
+}
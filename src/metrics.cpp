@@ -0,0 +1,315 @@
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+#include "buffer.hpp"
+
+extern "C"
+{
+#include <sys/stat.h>
+}
+
+using namespace Sukat;
+
+std::atomic<bool> Metrics::mEnabled{false};
+std::mutex Metrics::mShardsMutex;
+std::vector<std::unique_ptr<Metrics::shard>> Metrics::mShards;
+Metrics::shard Metrics::mRetired;
+
+namespace
+{
+struct metricInfo
+{
+  const char *name;
+  const char *help;
+};
+
+constexpr std::array<metricInfo, Metrics::nCounters> counterInfos = {{
+  {"bytes_received", "Bytes received on sockets."},
+  {"bytes_sent", "Bytes sent on sockets."},
+  {"receive_calls", "Receive syscalls."},
+  {"send_calls", "Send syscalls."},
+  {"would_block", "Socket syscalls that returned EAGAIN."},
+  {"partial_writes", "Sends that took only part of the data."},
+  {"accepts", "Clients accepted by listeners."},
+  {"access_denied", "Clients refused by an access callback."},
+  {"connects", "Outgoing connects started."},
+  {"connect_failures", "Outgoing connects that failed."},
+}};
+
+constexpr std::array<metricInfo, Metrics::nHistograms> histogramInfos = {{
+  {"connect_duration_seconds", "Time from connect to its completion."},
+}};
+
+// Exported bucket bounds, 2^10ns (~1us) to 2^36ns (~69s).
+constexpr size_t firstBucket = 10, lastBucket = 36;
+
+uint64_t load(const std::atomic<uint64_t> &value)
+{
+  return value.load(std::memory_order_relaxed);
+}
+} // namespace
+
+Metrics::shard *Metrics::attach()
+{
+  std::lock_guard lock(mShardsMutex);
+
+  mShards.push_back(std::make_unique<shard>());
+  return mShards.back().get();
+}
+
+void Metrics::retire(shard *done)
+{
+  std::lock_guard lock(mShardsMutex);
+  size_t i, h;
+
+  for (i = 0; i < nCounters; i++)
+    {
+      mRetired.counters[i].fetch_add(load(done->counters[i]),
+                                     std::memory_order_relaxed);
+    }
+  for (h = 0; h < nHistograms; h++)
+    {
+      const auto &from = done->histograms[h];
+      auto &to = mRetired.histograms[h];
+
+      for (i = 0; i < from.buckets.size(); i++)
+        {
+          to.buckets[i].fetch_add(load(from.buckets[i]),
+                                  std::memory_order_relaxed);
+        }
+      to.count.fetch_add(load(from.count), std::memory_order_relaxed);
+      to.sum.fetch_add(load(from.sum), std::memory_order_relaxed);
+    }
+  std::erase_if(mShards, [done](const auto &s) { return s.get() == done; });
+}
+
+Metrics::snapshot Metrics::collect()
+{
+  std::lock_guard lock(mShardsMutex);
+  snapshot snap;
+  auto sum = [&snap](const shard &s) {
+    size_t i, h;
+
+    for (i = 0; i < nCounters; i++)
+      {
+        snap.counters[i] += load(s.counters[i]);
+      }
+    for (h = 0; h < nHistograms; h++)
+      {
+        const auto &from = s.histograms[h];
+        auto &to = snap.histograms[h];
+
+        for (i = 0; i < from.buckets.size(); i++)
+          {
+            to.buckets[i] += load(from.buckets[i]);
+          }
+        to.count += load(from.count);
+        to.sum += load(from.sum);
+      }
+  };
+
+  sum(mRetired);
+  for (const auto &s : mShards)
+    {
+      sum(*s);
+    }
+  return snap;
+}
+
+std::string Metrics::prometheus()
+{
+  const snapshot snap = collect();
+  std::ostringstream out;
+  size_t i, h;
+
+  for (i = 0; i < nCounters; i++)
+    {
+      const std::string name =
+        std::string("sukat_") + counterInfos[i].name + "_total";
+
+      out << "# HELP " << name << " " << counterInfos[i].help << "\n"
+          << "# TYPE " << name << " counter\n"
+          << name << " " << snap.counters[i] << "\n";
+    }
+  for (h = 0; h < nHistograms; h++)
+    {
+      const std::string name = std::string("sukat_") + histogramInfos[h].name;
+      const distribution &dist = snap.histograms[h];
+      uint64_t cumulative = 0;
+
+      out << "# HELP " << name << " " << histogramInfos[h].help << "\n"
+          << "# TYPE " << name << " histogram\n";
+      for (i = 0; i < dist.buckets.size(); i++)
+        {
+          cumulative += dist.buckets[i];
+          // Bucket i holds values below 2^i ns.
+          if (i >= firstBucket && i <= lastBucket)
+            {
+              out << name << "_bucket{le=\""
+                  << static_cast<double>(uint64_t(1) << i) / 1e9 << "\"} "
+                  << cumulative << "\n";
+            }
+        }
+      out << name << "_bucket{le=\"+Inf\"} " << dist.count << "\n"
+          << name << "_sum " << static_cast<double>(dist.sum) / 1e9 << "\n"
+          << name << "_count " << dist.count << "\n";
+    }
+  return out.str();
+}
+
+/** @brief One scraper, answered once its request is in */
+class MetricsExporter::Client : public SocketConnection, public EventHandler
+{
+ public:
+  Client(MetricsExporter &owner, SocketConnection &&conn)
+    : SocketConnection(std::move(conn)), mOwner(owner),
+      mExpiry([this]() {
+        LOG_DBG("Metrics client ", fd(), " timed out");
+        // Destroys this.
+        mOwner.close(*this);
+      })
+  {
+    mOwner.mReactor.schedule(mExpiry, mOwner.mTimeout);
+  }
+
+  virtual void handleEvent(uint32_t events) override
+  {
+    bool done = events & EPOLLERR;
+
+    if (!done && !mAnswered && (events & EPOLLIN))
+      {
+        auto res = read(mIn);
+
+        if (res.status == readStatus::READ_ERROR)
+          {
+            done = true;
+          }
+        else if (res.status != readStatus::READ_AGAIN ||
+                 mIn.view().find("\r\n\r\n") != std::string_view::npos)
+          {
+            // Request complete, too long to care or half closed.
+            answer();
+          }
+      }
+    else if (!done && (events & EPOLLOUT))
+      {
+        done = write(mOut) < 0;
+      }
+    if (done || (mAnswered && mOut.empty()))
+      {
+        // Destroys this.
+        mOwner.close(*this);
+      }
+  }
+
+ private:
+  void answer()
+  {
+    const std::string body = Metrics::prometheus();
+
+    mOut.push("HTTP/1.0 200 OK\r\n"
+              "Content-Type: text/plain; version=0.0.4\r\n"
+              "Content-Length: " +
+              std::to_string(body.size()) + "\r\n\r\n");
+    mOut.push(body);
+    mAnswered = true;
+    mOwner.mServed++;
+    // After a failed send there's nothing left worth waiting for.
+    if (write(mOut) < 0 ||
+        (!mOut.empty() && !mOwner.mReactor.modify(fd(), *this, EPOLLOUT)))
+      {
+        mOut.clear();
+      }
+  }
+
+  MetricsExporter &mOwner;
+  Buffer mIn{4096};
+  WriteQueue mOut;
+  Timer mExpiry; //!< Closes the client if it isn't done by then.
+  bool mAnswered{false};
+};
+
+namespace
+{
+/** @brief Listening end-point of \p path, with any stale socket removed
+ *
+ * @throw std::system_error If something other than a socket is at \p path.
+ */
+Socket::endpoint exporterEndpoint(const std::filesystem::path &path,
+                                  bool abstract)
+{
+  struct stat st;
+
+  if (!abstract && !::lstat(path.c_str(), &st))
+    {
+      std::error_code ec;
+
+      if (!S_ISSOCK(st.st_mode))
+        {
+          throw std::system_error(EEXIST, std::system_category(),
+                                  "Metrics path " + path.string() +
+                                    " is not a socket");
+        }
+      std::filesystem::remove(path, ec);
+    }
+  return Socket::make_endpoint(path, abstract);
+}
+} // namespace
+
+MetricsExporter::MetricsExporter(Reactor &reactor,
+                                 const std::filesystem::path &path,
+                                 bool abstract,
+                                 std::chrono::milliseconds timeout)
+  : mReactor(reactor), mPath((abstract) ? std::filesystem::path() : path),
+    mTimeout(timeout),
+    mListener(exporterEndpoint(path, abstract)),
+    mListenerEvent([this](uint32_t) { accept(); })
+{
+  if (!mReactor.add(mListener.fd(), mListenerEvent))
+    {
+      throw std::system_error(errno, std::system_category(),
+                              "Failed to register metrics listener");
+    }
+  LOG_DBG("Serving metrics on ", &mListener);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+  mClients.forEach([this](Client &client) {
+    mReactor.remove(client.fd(), client);
+  });
+  mClients.clear();
+  mReactor.remove(mListener.fd(), mListenerEvent);
+  if (!mPath.empty())
+    {
+      std::error_code ec;
+
+      std::filesystem::remove(mPath, ec);
+    }
+}
+
+void MetricsExporter::accept()
+{
+  mListener.accept(
+    [this](SocketConnection &&conn, std::vector<uint8_t> &) {
+      const int fd = conn.fd();
+
+      if (mClients.emplace(fd, *this, std::move(conn)) &&
+          !mReactor.add(fd, *mClients.find(fd), EPOLLIN))
+        {
+          LOG_ERR("Failed to register metrics client: ", ::strerror(errno));
+          mClients.erase(fd);
+        }
+    },
+    nullptr, 16);
+}
+
+void MetricsExporter::close(Client &client)
+{
+  const int fd = client.fd();
+
+  mReactor.remove(fd, client);
+  mClients.erase(fd);
+}
@@ -0,0 +1,174 @@
+#include "resolver.hpp"
+
+extern "C"
+{
+#include <netdb.h>
+#include <sys/eventfd.h>
+}
+
+using namespace Sukat;
+
+Resolver::Resolver(unsigned int n_threads, std::chrono::seconds ttl,
+                   std::chrono::seconds error_ttl)
+  : mTtl(ttl), mErrorTtl(error_ttl),
+    mEventFd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+  unsigned int i;
+
+  if (mEventFd.fd() == -1)
+    {
+      throw std::system_error(errno, std::system_category(), "eventfd");
+    }
+  for (i = 0; i < std::max(n_threads, 1U); i++)
+    {
+      mThreads.emplace_back([this](std::stop_token stop) { work(stop); });
+    }
+}
+
+Resolver::~Resolver()
+{
+  for (auto &thread : mThreads)
+    {
+      thread.request_stop();
+    }
+  mCond.notify_all();
+  mThreads.clear();
+}
+
+void Resolver::resolve(const std::string &node, const std::string &service,
+                       resolveCb cb, int type, int family)
+{
+  std::string key = node + '\0' + service + '\0' + std::to_string(type) +
+                    '\0' + std::to_string(family);
+  if (mCache.size() >= mPurgeAt)
+    {
+      purge();
+    }
+
+  auto [it, inserted] = mCache.try_emplace(key);
+  entry &ent = it->second;
+
+  if (!inserted)
+    {
+      if (!ent.waiters.empty())
+        {
+          LOG_DBG("Joining lookup of ", node, " in flight");
+          ent.waiters.emplace_back(std::move(cb));
+          return;
+        }
+      if (clock::now() < ent.expires)
+        {
+          cb(result{ent.error, ent.endpoints, true});
+          return;
+        }
+    }
+  ent.waiters.emplace_back(std::move(cb));
+  mPending++;
+  {
+    std::lock_guard guard(mLock);
+
+    mRequests.push_back({std::move(key), node, service, type, family});
+  }
+  mCond.notify_one();
+}
+
+void Resolver::work(std::stop_token stop)
+{
+  while (true)
+    {
+      request req;
+
+      {
+        std::unique_lock guard(mLock);
+
+        if (!mCond.wait(guard, stop, [this] { return !mRequests.empty(); }))
+          {
+            return;
+          }
+        req = std::move(mRequests.front());
+        mRequests.pop_front();
+      }
+
+      struct ::addrinfo hints = {}, *res = nullptr;
+      result done = {0, {}, false};
+
+      hints.ai_flags = AI_ADDRCONFIG;
+      hints.ai_family = req.family;
+      hints.ai_socktype = req.type;
+      done.error = ::getaddrinfo(req.node.c_str(),
+                                 (req.service.empty()) ? nullptr
+                                                       : req.service.c_str(),
+                                 &hints, &res);
+      if (!done.error)
+        {
+          for (struct ::addrinfo *iter = res; iter; iter = iter->ai_next)
+            {
+              done.endpoints.emplace_back(Socket::make_endpoint(iter));
+            }
+          ::freeaddrinfo(res);
+        }
+      LOG_DBG("Resolved ", req.node, ": ", done.endpoints.size(),
+              " end-points, error ", done.error);
+      mDone.push({std::move(req.key), std::move(done)});
+
+      uint64_t one = 1;
+
+      if (::write(mEventFd.fd(), &one, sizeof(one)) != sizeof(one))
+        {
+          LOG_ERR("Failed to signal resolver: ", ::strerror(errno));
+        }
+    }
+}
+
+size_t Resolver::poll()
+{
+  uint64_t count;
+  size_t n = 0;
+
+  if (::read(mEventFd.fd(), &count, sizeof(count)) < 0 && errno != EAGAIN)
+    {
+      LOG_ERR("Failed to read resolver eventfd: ", ::strerror(errno));
+    }
+  while (auto done = mDone.pop())
+    {
+      auto &[key, res] = done.value();
+      auto it = mCache.find(key);
+
+      mPending--;
+      n++;
+      if (it == mCache.end())
+        {
+          continue;
+        }
+
+      entry &ent = it->second;
+      std::vector<resolveCb> waiters = std::move(ent.waiters);
+
+      ent.waiters.clear();
+      ent.error = res.error;
+      ent.endpoints = res.endpoints;
+      ent.expires = clock::now() + ((res.error) ? mErrorTtl : mTtl);
+      for (auto &cb : waiters)
+        {
+          cb(res);
+        }
+    }
+  return n;
+}
+
+void Resolver::flush()
+{
+  std::erase_if(mCache, [](const auto &item) {
+    return item.second.waiters.empty();
+  });
+}
+
+void Resolver::purge()
+{
+  const auto now = clock::now();
+
+  std::erase_if(mCache, [now](const auto &item) {
+    return item.second.waiters.empty() && item.second.expires <= now;
+  });
+  mPurgeAt = std::max<size_t>(purgeMin, mCache.size() * 2);
+}
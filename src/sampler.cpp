@@ -0,0 +1,79 @@
+#include "sampler.hpp"
+
+extern "C"
+{
+#include <linux/sock_diag.h>
+#include <linux/sockios.h>
+#include <linux/tcp.h>
+#include <sys/ioctl.h>
+}
+
+using namespace Sukat;
+
+SocketSample Socket::sample(unsigned int fields) const
+{
+  SocketSample out;
+
+  if (fields & SocketSample::SAMPLE_TCP_INFO)
+    {
+      struct tcp_info info = {};
+      socklen_t len = sizeof(info);
+
+      // Older kernels fill less, the rest stays zero.
+      if (!::getsockopt(fd(), IPPROTO_TCP, TCP_INFO, &info, &len))
+        {
+          out.valid |= SocketSample::SAMPLE_TCP_INFO;
+          out.state = info.tcpi_state;
+          out.rtt = info.tcpi_rtt;
+          out.rttVar = info.tcpi_rttvar;
+          out.minRtt = info.tcpi_min_rtt;
+          out.cwnd = info.tcpi_snd_cwnd;
+          out.ssthresh = info.tcpi_snd_ssthresh;
+          out.mss = info.tcpi_snd_mss;
+          out.unacked = info.tcpi_unacked;
+          out.lost = info.tcpi_lost;
+          out.retransmits = info.tcpi_retransmits;
+          out.totalRetrans = info.tcpi_total_retrans;
+          out.deliveryRate = info.tcpi_delivery_rate;
+          out.pacingRate = info.tcpi_pacing_rate;
+          out.bytesAcked = info.tcpi_bytes_acked;
+          out.bytesReceived = info.tcpi_bytes_received;
+          out.busyTime = info.tcpi_busy_time;
+          out.rwndLimited = info.tcpi_rwnd_limited;
+          out.sndbufLimited = info.tcpi_sndbuf_limited;
+        }
+    }
+  if (fields & SocketSample::SAMPLE_QUEUES)
+    {
+      int inq = 0, outq = 0, notsent = 0;
+
+      if (!::ioctl(fd(), SIOCINQ, &inq) && !::ioctl(fd(), SIOCOUTQ, &outq))
+        {
+          out.valid |= SocketSample::SAMPLE_QUEUES;
+          out.inq = inq;
+          out.outq = outq;
+          // TCP only.
+          if (!::ioctl(fd(), SIOCOUTQNSD, &notsent))
+            {
+              out.notSent = notsent;
+            }
+        }
+    }
+  if (fields & SocketSample::SAMPLE_MEMINFO)
+    {
+      uint32_t mem[SK_MEMINFO_VARS] = {};
+      socklen_t len = sizeof(mem);
+
+      if (!::getsockopt(fd(), SOL_SOCKET, SO_MEMINFO, mem, &len))
+        {
+          out.valid |= SocketSample::SAMPLE_MEMINFO;
+          out.rmemAlloc = mem[SK_MEMINFO_RMEM_ALLOC];
+          out.rcvbuf = mem[SK_MEMINFO_RCVBUF];
+          out.wmemQueued = mem[SK_MEMINFO_WMEM_QUEUED];
+          out.sndbuf = mem[SK_MEMINFO_SNDBUF];
+          out.backlog = mem[SK_MEMINFO_BACKLOG];
+          out.drops = mem[SK_MEMINFO_DROPS];
+        }
+    }
+  return out;
+}
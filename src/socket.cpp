@@ -1,8 +1,12 @@
 #include "socket.hpp"
+#include "metrics.hpp"
 
 extern "C"
 {
+#include <linux/errqueue.h>
 #include <netdb.h>
+#include <netinet/udp.h>
+#include <poll.h>
 #include <sys/un.h>
 }
 
@@ -24,10 +28,17 @@ std::string Sukat::saddr_to_string(const struct sockaddr_storage *addr,
 
           if (string_len > 0)
             {
-              std::string socket_path(sun->sun_path[is_abstract], string_len);
+              std::string_view socket_path(&sun->sun_path[is_abstract],
+                                           string_len);
 
+              if (!is_abstract)
+                {
+                  // Path names may or may not count their terminator.
+                  socket_path = socket_path.substr(0, socket_path.find('\0'));
+                }
               desc << "(" << (is_abstract ? "@" : "") << socket_path << ")";
             }
+          else
           {
             desc << "Not enough data for unix path";
           }
@@ -127,14 +138,18 @@ void Socket::addToEfd(int efd, uint32_t events) const
 std::stringstream SocketConnection::readData() const
 {
   std::stringstream data;
-  char buf[BUFSIZ];
+  // Only the returned stream is the caller's, read(Buffer &) avoids it.
+  BufferPool::Handle slab = BufferPool::local().get();
+  auto buf = slab.data();
   int ret;
 
-  while ((ret = ::recv(fd(), buf, sizeof(buf), 0)) > 0)
+  while ((ret = ::recv(fd(), buf.data(), buf.size(), 0)) > 0)
     {
+      countRead(ret);
       LOG_DBG("Read ", ret, " bytes from ", this);
-      data.write(buf, ret);
+      data.write(reinterpret_cast<const char *>(buf.data()), ret);
     }
+  countRead(ret);
   if (!(ret == -1 &&
         (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)))
     {
@@ -143,9 +158,121 @@ std::stringstream SocketConnection::readData() const
   return data;
 };
 
+SocketConnection::readResult SocketConnection::read(Buffer &buf) const noexcept
+{
+  readResult result = {readStatus::READ_AGAIN, 0, 0};
+
+  while (true)
+    {
+      auto space = buf.writable();
+
+      if (space.empty())
+        {
+          buf.compact();
+          space = buf.writable();
+          if (space.empty())
+            {
+              result.status = readStatus::READ_FULL;
+              break;
+            }
+        }
+      ssize_t ret = ::recv(fd(), space.data(), space.size(), 0);
+
+      countRead(ret);
+      if (ret > 0)
+        {
+          buf.commit(ret);
+          result.bytes += ret;
+        }
+      else if (ret == 0)
+        {
+          result.status = readStatus::READ_EOF;
+          break;
+        }
+      else if (errno == EINTR)
+        {
+          continue;
+        }
+      else
+        {
+          if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+              result.status = readStatus::READ_ERROR;
+              result.error = errno;
+            }
+          break;
+        }
+    }
+  LOG_DBG("Read ", result.bytes, " bytes from ", this);
+  return result;
+}
+
 int SocketConnection::write(const struct msghdr &hdr, int flags) const
 {
-  return ::sendmsg(fd(), &hdr, flags);
+  const int ret = ::sendmsg(fd(), &hdr, flags);
+
+  if (Metrics::enabled())
+    {
+      size_t len = 0, i;
+
+      for (i = 0; i < hdr.msg_iovlen; i++)
+        {
+          len += hdr.msg_iov[i].iov_len;
+        }
+      countWrite(ret, ret >= 0 && static_cast<size_t>(ret) < len);
+    }
+  return ret;
+}
+
+void SocketConnection::countRead(ssize_t ret) const
+{
+  const int err = errno;
+
+  if (!Metrics::enabled())
+    {
+      return;
+    }
+  mStats.reads++;
+  Metrics::add(Metrics::counter::COUNTER_READS);
+  if (ret > 0)
+    {
+      mStats.bytesIn += ret;
+      Metrics::add(Metrics::counter::COUNTER_BYTES_IN, ret);
+    }
+  else if (ret < 0 && (err == EAGAIN || err == EWOULDBLOCK))
+    {
+      mStats.wouldBlock++;
+      Metrics::add(Metrics::counter::COUNTER_WOULD_BLOCK);
+    }
+  errno = err;
+}
+
+void SocketConnection::countWrite(ssize_t ret, bool partial) const
+{
+  const int err = errno;
+
+  if (!Metrics::enabled())
+    {
+      return;
+    }
+  mStats.writes++;
+  Metrics::add(Metrics::counter::COUNTER_WRITES);
+  if (ret >= 0)
+    {
+      mStats.bytesOut += ret;
+      Metrics::add(Metrics::counter::COUNTER_BYTES_OUT, ret);
+    }
+  else if (err == EAGAIN || err == EWOULDBLOCK)
+    {
+      mStats.wouldBlock++;
+      Metrics::add(Metrics::counter::COUNTER_WOULD_BLOCK);
+    }
+  if (partial)
+    {
+      mStats.partialWrites++;
+      Metrics::add(Metrics::counter::COUNTER_PARTIAL_WRITES);
+    }
+  errno = err;
 }
 
 int SocketConnection::write(void *data, size_t len, int flags) const
@@ -193,6 +320,439 @@ int SocketConnection::write(struct iovec &iov, size_t n_iov, int flags) const
   return write(hdr, flags);
 }
 
+DatagramQueue::DatagramQueue(size_t n_msgs, size_t n_bytes)
+  : mSlab(n_bytes), mDsts(n_msgs), mIovs(n_msgs), mHdrs(n_msgs)
+{
+}
+
+bool DatagramQueue::push(const void *data, size_t len,
+                         const std::optional<Socket::endpoint> &dst)
+{
+  if (mCount < mHdrs.size() && mSlab.size() - mUsed >= len)
+    {
+      struct mmsghdr &hdr = mHdrs[mCount];
+
+      ::memcpy(mSlab.data() + mUsed, data, len);
+      mIovs[mCount] = {.iov_base = mSlab.data() + mUsed, .iov_len = len};
+      hdr = {};
+      hdr.msg_hdr.msg_iov = &mIovs[mCount];
+      hdr.msg_hdr.msg_iovlen = 1;
+      if (dst)
+        {
+          ::memcpy(&mDsts[mCount], &dst->first, dst->second);
+          hdr.msg_hdr.msg_name = &mDsts[mCount];
+          hdr.msg_hdr.msg_namelen = dst->second;
+        }
+      mUsed += len;
+      mCount++;
+      return true;
+    }
+  return false;
+}
+
+bool DatagramQueue::segmentable() const
+{
+  const struct msghdr &first = mHdrs[mSent].msg_hdr;
+  size_t i;
+
+  for (i = mSent + 1; i < mCount; i++)
+    {
+      const struct msghdr &hdr = mHdrs[i].msg_hdr;
+
+      if (hdr.msg_namelen != first.msg_namelen ||
+          (hdr.msg_namelen &&
+           ::memcmp(hdr.msg_name, first.msg_name, hdr.msg_namelen)) ||
+          mIovs[i - 1].iov_len != mIovs[mSent].iov_len ||
+          mIovs[i].iov_len > mIovs[mSent].iov_len)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+int SocketConnection::write(DatagramQueue &queue, int flags) const
+{
+  // Kernel limits on a single UDP GSO send: UDP_MAX_SEGMENTS and the
+  // largest IPv4 UDP payload.
+  constexpr size_t max_segments = 64, max_bytes = 65507;
+  const size_t pending = queue.size();
+  int ret = 0;
+  // Segment length of the next GSO burst, 0 if it must go by sendmmsg.
+  // Empty datagrams can't be segmented and a segment must fit a burst.
+  auto segment = [&queue]() -> size_t {
+    if (!queue.mGso || queue.size() < 2 || !queue.segmentable())
+      {
+        return 0;
+      }
+
+    const size_t len = queue.mIovs[queue.mSent].iov_len;
+
+    return (len <= max_bytes) ? len : 0;
+  };
+  size_t seg_len;
+
+  while ((seg_len = segment()))
+    {
+      const size_t n_segs =
+        std::min({queue.size(), max_segments, max_bytes / seg_len});
+      const uint16_t gso_size = seg_len;
+      struct msghdr hdr = queue.mHdrs[queue.mSent].msg_hdr;
+      char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+      struct cmsghdr *cmsg;
+
+      hdr.msg_iovlen = n_segs;
+      hdr.msg_control = control;
+      hdr.msg_controllen = sizeof(control);
+      cmsg = CMSG_FIRSTHDR(&hdr);
+      cmsg->cmsg_level = SOL_UDP;
+      cmsg->cmsg_type = UDP_SEGMENT;
+      cmsg->cmsg_len = CMSG_LEN(sizeof(gso_size));
+      ::memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+
+      const ssize_t sent = ::sendmsg(fd(), &hdr, flags);
+
+      // The kernel takes a GSO burst whole or not at all.
+      countWrite(sent, false);
+      if (sent >= 0)
+        {
+          LOG_DBG("Sent ", n_segs, " segments of ", gso_size, " to ", this);
+          queue.mSent += n_segs;
+        }
+      else if (errno == EINTR)
+        {
+          continue;
+        }
+      else
+        {
+          if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+              LOG_ERR("UDP GSO send failed on ", this, ": ",
+                      ::strerror(errno), ", disabling segmentation");
+              queue.mGso = false;
+            }
+          ret = -1;
+          break;
+        }
+    }
+  while (!queue.empty() && !segment())
+    {
+      ret = ::sendmmsg(fd(), &queue.mHdrs[queue.mSent], queue.size(), flags);
+      if (Metrics::enabled())
+        {
+          ssize_t bytes = 0;
+          int i;
+
+          for (i = 0; i < ret; i++)
+            {
+              bytes += queue.mHdrs[queue.mSent + i].msg_len;
+            }
+          // One send, partial if it left datagrams queued.
+          countWrite((ret < 0) ? -1 : bytes,
+                     ret >= 0 && static_cast<size_t>(ret) < queue.size());
+        }
+      if (ret > 0)
+        {
+          LOG_DBG("Sent ", ret, " datagrams to ", this);
+          queue.mSent += ret;
+        }
+      else if (ret == -1 && errno != EINTR)
+        {
+          break;
+        }
+    }
+  if (queue.empty())
+    {
+      queue.clear();
+    }
+  if (pending == queue.size() && pending && ret == -1)
+    {
+      return -1;
+    }
+  return pending - queue.size();
+}
+
+void WriteQueue::push(const void *data, size_t len)
+{
+  const uint8_t *src = static_cast<const uint8_t *>(data);
+
+  if (!len)
+    {
+      return;
+    }
+  // Top up the last chunk first. Appending within capacity never
+  // reallocates, so small writes share one chunk and bytes already handed
+  // to a zerocopy send stay put.
+  if (!mChunks.empty())
+    {
+      std::vector<uint8_t> &last = mChunks.back().data;
+      const size_t n = std::min(len, last.capacity() - last.size());
+
+      last.insert(last.end(), src, src + n);
+      src += n;
+      len -= n;
+      mSize += n;
+    }
+  if (len)
+    {
+      std::vector<uint8_t> chunk;
+
+      chunk.reserve(std::max(len, mChunkSize));
+      chunk.assign(src, src + len);
+      mChunks.push_back({std::move(chunk), {}});
+      mSize += len;
+    }
+  if (mSize >= mHigh)
+    {
+      mBlocked = true;
+    }
+}
+
+void WriteQueue::push(std::vector<uint8_t> &&data)
+{
+  if (!data.empty())
+    {
+      mSize += data.size();
+      mChunks.push_back({std::move(data), {}});
+      if (mSize >= mHigh)
+        {
+          mBlocked = true;
+        }
+    }
+}
+
+void WriteQueue::clear()
+{
+  if (!mChunks.empty() && !completed(mChunks.front()))
+    {
+      mPinnedSize += mChunks.front().data.size();
+      mPinned.push_back(std::move(mChunks.front()));
+    }
+  mChunks.clear();
+  mOffset = mSize = 0;
+  mBlocked = false;
+}
+
+void WriteQueue::release(chunk &&c)
+{
+  if (mRelease)
+    {
+      c.data.clear();
+      mRelease(std::move(c.data));
+    }
+}
+
+void WriteQueue::consume(size_t n)
+{
+  mSize -= n;
+  while (n)
+    {
+      const size_t left = mChunks.front().data.size() - mOffset;
+
+      if (n < left)
+        {
+          mOffset += n;
+          break;
+        }
+      n -= left;
+      mOffset = 0;
+      if (completed(mChunks.front()))
+        {
+          release(std::move(mChunks.front()));
+        }
+      else
+        {
+          mPinnedSize += mChunks.front().data.size();
+          mPinned.push_back(std::move(mChunks.front()));
+        }
+      mChunks.pop_front();
+    }
+  if (mSize <= mLow)
+    {
+      mBlocked = false;
+    }
+}
+
+void WriteQueue::pin(size_t n, uint32_t id)
+{
+  size_t offset = mOffset;
+
+  for (auto &c : mChunks)
+    {
+      if (!n)
+        {
+          break;
+        }
+      c.zerocopyId = id;
+      n -= std::min(n, c.data.size() - offset);
+      offset = 0;
+    }
+}
+
+void WriteQueue::complete(uint32_t lo, uint32_t hi)
+{
+  if (lo != mCompleted)
+    {
+      mEarly.emplace_back(lo, hi);
+      return;
+    }
+  mCompleted = hi + 1;
+  // Absorb ranges that arrived ahead of this one.
+  for (auto it = mEarly.begin(); it != mEarly.end();)
+    {
+      if (it->first == mCompleted)
+        {
+          mCompleted = it->second + 1;
+          mEarly.erase(it);
+          it = mEarly.begin();
+        }
+      else
+        {
+          ++it;
+        }
+    }
+  while (!mPinned.empty() && completed(mPinned.front()))
+    {
+      mPinnedSize -= mPinned.front().data.size();
+      release(std::move(mPinned.front()));
+      mPinned.pop_front();
+    }
+}
+
+ssize_t SocketConnection::write(WriteQueue &queue, int flags) const
+{
+  // Enough iovecs to cover the socket send buffer in default sized chunks
+  // without touching the heap.
+  const size_t max_iov = 64;
+  ssize_t total = 0;
+  bool zerocopy = queue.mZerocopy;
+
+  while (!queue.empty())
+    {
+      struct iovec iov[max_iov];
+      struct msghdr hdr = {};
+      size_t n_iov = 0, offset = queue.mOffset, len = 0;
+      int send_flags = flags | MSG_NOSIGNAL;
+      ssize_t ret;
+
+      for (auto &c : queue.mChunks)
+        {
+          if (n_iov == max_iov)
+            {
+              break;
+            }
+          iov[n_iov++] = {.iov_base = c.data.data() + offset,
+                          .iov_len = c.data.size() - offset};
+          len += c.data.size() - offset;
+          offset = 0;
+        }
+      if (zerocopy && len >= queue.mZerocopyMin)
+        {
+          send_flags |= MSG_ZEROCOPY;
+        }
+      hdr.msg_iov = iov;
+      hdr.msg_iovlen = n_iov;
+      ret = ::sendmsg(fd(), &hdr, send_flags);
+      countWrite(ret, ret >= 0 && static_cast<size_t>(ret) < len);
+      if (ret > 0)
+        {
+          if (send_flags & MSG_ZEROCOPY)
+            {
+              queue.pin(ret, queue.mNextId++);
+            }
+          queue.consume(ret);
+          total += ret;
+        }
+      else if (ret == -1 && errno == EINTR)
+        {
+          continue;
+        }
+      else if (ret == -1 && errno == ENOBUFS && (send_flags & MSG_ZEROCOPY))
+        {
+          // Out of optmem for notifications, copy until some complete.
+          zerocopy = false;
+          continue;
+        }
+      else if (ret == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+          LOG_ERR("Failed to send queued data to ", this, ": ",
+                  ::strerror(errno));
+          return -1;
+        }
+      else
+        {
+          break;
+        }
+    }
+  LOG_DBG("Sent ", total, " queued bytes to ", this, ", ", queue.size(),
+          " pending");
+  return total;
+}
+
+bool SocketConnection::setZerocopy() const
+{
+  const int one = 1;
+
+  if (::setsockopt(fd(), SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)))
+    {
+      LOG_ERR("Failed to enable zerocopy on ", this, ": ", ::strerror(errno));
+      return false;
+    }
+  return true;
+}
+
+int SocketConnection::reap(WriteQueue &queue) const
+{
+  int n = 0;
+
+  while (true)
+    {
+      char control[CMSG_SPACE(sizeof(struct sock_extended_err)) * 8];
+      struct msghdr hdr = {};
+      struct cmsghdr *cmsg;
+
+      hdr.msg_control = control;
+      hdr.msg_controllen = sizeof(control);
+      if (::recvmsg(fd(), &hdr, MSG_ERRQUEUE) == -1)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+              return n;
+            }
+          LOG_ERR("Failed to read error queue of ", this, ": ",
+                  ::strerror(errno));
+          return -1;
+        }
+      for (cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg))
+        {
+          const bool recverr =
+            (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+            (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR);
+          struct sock_extended_err ee;
+
+          if (!recverr)
+            {
+              continue;
+            }
+          ::memcpy(&ee, CMSG_DATA(cmsg), sizeof(ee));
+          if (ee.ee_errno || ee.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+              continue;
+            }
+          if (ee.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+              queue.mCopied += ee.ee_data - ee.ee_info + 1;
+            }
+          queue.complete(ee.ee_info, ee.ee_data);
+          n++;
+        }
+    }
+}
+
 int SocketConnection::operator<<(const std::ostringstream &data)
 {
   return write(data.str(), 1);
@@ -204,6 +764,7 @@ SocketConnection::SocketConnection(__socket_type socktype, sockopts opts,
   : Socket(socktype, opts, src), complete(false)
 {
   LOG_DBG("Connecting fd ", fd(), " to ", endpoint_to_string(dst));
+  Metrics::add(Metrics::counter::COUNTER_CONNECTS);
   if (!::connect(fd(), reinterpret_cast<const struct sockaddr *>(&dst.first),
                  dst.second))
     {
@@ -212,12 +773,17 @@ SocketConnection::SocketConnection(__socket_type socktype, sockopts opts,
     }
   else if (errno != EINPROGRESS)
     {
+      Metrics::add(Metrics::counter::COUNTER_CONNECT_FAILURES);
       throw std::system_error(errno, std::system_category(), "Connect");
     }
   else
     {
       LOG_DBG("Connection socket ", this, ": ", ::strerror(errno));
-      // TCP handshake in progress.
+      // TCP handshake in progress, timed until polloutReady().
+      if (Metrics::enabled())
+        {
+          mConnectStart = std::chrono::steady_clock::now();
+        }
     }
 }
 
@@ -228,6 +794,24 @@ int SocketConnection::polloutReady() const
 
   if (!::getsockopt(fd(), SOL_SOCKET, SO_ERROR, &errcode, &err_len))
     {
+      if (mConnectStart)
+        {
+          const auto elapsed = std::chrono::steady_clock::now() -
+                               mConnectStart.value();
+
+          if (errcode)
+            {
+              Metrics::add(Metrics::counter::COUNTER_CONNECT_FAILURES);
+            }
+          else
+            {
+              Metrics::record(
+                Metrics::histogram::HISTOGRAM_CONNECT_LATENCY,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                  .count());
+            }
+          mConnectStart.reset();
+        }
       return errcode;
     }
   else
@@ -239,73 +823,83 @@ int SocketConnection::polloutReady() const
 
 bool SocketConnection::ready(int timeout) const
 {
-  bool bret = false;
-  int efd = epoll_create1(EPOLL_CLOEXEC);
+  struct pollfd pfd = {.fd = fd(), .events = POLLOUT, .revents = 0};
+  int ret;
 
-  if (efd != -1)
+  while ((ret = ::poll(&pfd, 1, timeout)) == -1 && errno == EINTR)
     {
-      struct epoll_event ev = {
-        .events = EPOLLOUT,
-        .data = {.fd = fd()},
-      };
-
-      if (!epoll_ctl(efd, EPOLL_CTL_ADD, fd(), &ev))
-        {
-          if (epoll_wait(efd, &ev, 1, timeout) > 0)
-            {
-              if (ev.events & EPOLLOUT)
-                {
-                  LOG_DBG("Connection ", this, " finished");
-                  bret = true;
-                }
-            }
-        }
-      else
-        {
-          LOG_ERR("Failed to add ", fd(), " to ", efd, ": ", ::strerror(errno));
-        }
-      close(efd);
     }
-  return bret;
+  if (ret > 0 && (pfd.revents & POLLOUT))
+    {
+      LOG_DBG("Connection ", this, " finished");
+      return true;
+    }
+  else if (ret == -1)
+    {
+      LOG_ERR("Failed to poll ", this, ": ", ::strerror(errno));
+    }
+  return false;
 }
 
-unsigned int SocketListener::accept(newClientCb cb, accessCb cb_access) const
+unsigned int SocketListener::accept(newClientCb cb, accessCb cb_access,
+                                    unsigned int budget) const
 {
   unsigned int count = 0;
   Socket::endpoint endpoint({}, sizeof(endpoint.first));
-  std::vector<uint8_t> data(BUFSIZ);
+  std::vector<uint8_t> &data = mAcceptData;
 
-  while (newClientType ret{getNewClient(endpoint, data, cb_access)})
+  while (!budget || count < budget)
     {
+      // Within the capacity kept from earlier calls, so no allocation.
+      data.resize(BUFSIZ);
+      newClientType ret{getNewClient(endpoint, data, cb_access)};
+
+      if (!ret)
+        {
+          break;
+        }
       LOG_DBG("New client: ", &ret.value());
       cb(std::move(ret.value()), data);
       endpoint.second = sizeof(endpoint.first);
       count++;
     }
+  if (budget && count == budget)
+    {
+      struct pollfd pfd = {.fd = fd(), .events = POLLIN, .revents = 0};
+
+      // Only count calls that left clients waiting.
+      if (::poll(&pfd, 1, 0) > 0)
+        {
+          mStats.overflowed++;
+        }
+    }
+  mStats.accepted += count;
+  Metrics::add(Metrics::counter::COUNTER_ACCEPTS, count);
   return count;
 }
 
-std::vector<SocketConnection> SocketListener::accept(accessCb cb_access) const
+std::vector<SocketConnection> SocketListener::accept(accessCb cb_access,
+                                                     unsigned int budget) const
 {
-  Socket::endpoint endpoint({}, sizeof(endpoint.first));
-  std::vector<uint8_t> data(BUFSIZ);
   std::vector<SocketConnection> newClients;
 
-  while (newClientType ret{getNewClient(endpoint, data, cb_access)})
-    {
-      LOG_DBG("New client: ", &ret.value());
-      newClients.emplace_back(std::move(ret.value()));
-    }
+  accept(
+    [&](SocketConnection &&conn, __attribute__((unused))
+                                 std::vector<uint8_t> &data) {
+      newClients.emplace_back(std::move(conn));
+    },
+    cb_access, budget);
   return newClients;
 }
 
 SocketListenerStream::SocketListenerStream(Socket::bindopt opt,
-                    Socket::sockopts opts, __socket_type socktype)
+                    Socket::sockopts opts, __socket_type socktype,
+                    int backlog)
   : SocketListener::SocketListener(socktype, opts, opt)
 {
-  if (!listen(fd(), 16))
+  if (!listen(fd(), backlog))
     {
-      LOG_DBG("Listening on: ", this);
+      LOG_DBG("Listening on: ", this, " backlog ", backlog);
       // Success.
     }
   else
@@ -314,6 +908,22 @@ SocketListenerStream::SocketListenerStream(Socket::bindopt opt,
     }
 }
 
+int SocketListenerStream::somaxconn()
+{
+  static const int max_backlog = []() {
+    std::ifstream proc("/proc/sys/net/core/somaxconn");
+    int value = SOMAXCONN;
+
+    if (!(proc >> value))
+      {
+        value = SOMAXCONN;
+      }
+    return value;
+  }();
+
+  return max_backlog;
+}
+
 std::optional<SocketConnection> SocketListenerStream::getNewClient(
   Socket::endpoint &sender, __attribute__((unused)) std::vector<uint8_t> &data,
   accessCb cb_access) const
@@ -332,6 +942,8 @@ std::optional<SocketConnection> SocketListenerStream::getNewClient(
       else
         {
           LOG_DBG("New client ", endpoint_to_string(sender), " denied");
+          mStats.denied++;
+          Metrics::add(Metrics::counter::COUNTER_DENIED);
           close(new_fd);
         }
     }
@@ -350,11 +962,100 @@ SocketListenerUdp::SocketListenerUdp(Socket::bindopt src)
       SOCK_DGRAM,
       std::set{std::make_pair<int, int>(SO_REUSEADDR, 1),
                std::make_pair<int, int>(SO_REUSEPORT, 1)},
-      src)
+      src),
+    mSource(getSource().value())
 {
   LOG_DBG("Listening UDP on: ", this);
 }
 
+DatagramBatch::DatagramBatch(size_t n_msgs, size_t msg_size, BufferPool &pool)
+  : mMsgSize(msg_size), mSenders(n_msgs), mIovs(n_msgs), mHdrs(n_msgs)
+{
+  if (!msg_size || msg_size > pool.slabSize())
+    {
+      throw std::invalid_argument("Datagram size " + std::to_string(msg_size) +
+                                  " doesn't fit slabs of " +
+                                  std::to_string(pool.slabSize()));
+    }
+
+  const size_t per_slab = pool.slabSize() / msg_size;
+  size_t i;
+
+  mSlabs.reserve((n_msgs + per_slab - 1) / per_slab);
+  for (i = 0; i < n_msgs; i++)
+    {
+      if (!(i % per_slab))
+        {
+          mSlabs.emplace_back(pool.get());
+        }
+      mIovs[i].iov_base =
+        mSlabs.back().data().data() + (i % per_slab) * mMsgSize;
+      mHdrs[i].msg_hdr.msg_name = &mSenders[i];
+      mHdrs[i].msg_hdr.msg_iov = &mIovs[i];
+      mHdrs[i].msg_hdr.msg_iovlen = 1;
+    }
+  reset();
+}
+
+void DatagramBatch::reset()
+{
+  size_t i;
+
+  for (i = 0; i < mHdrs.size(); i++)
+    {
+      mIovs[i].iov_len = mMsgSize;
+      mHdrs[i].msg_hdr.msg_namelen = sizeof(mSenders[i]);
+      mHdrs[i].msg_hdr.msg_flags = 0;
+      mHdrs[i].msg_len = 0;
+    }
+  mCount = 0;
+}
+
+unsigned int SocketListenerUdp::receive(DatagramBatch &batch, batchCb cb) const
+{
+  unsigned int count = 0;
+  int ret;
+
+  do
+    {
+      batch.reset();
+      ret = ::recvmmsg(fd(), batch.mHdrs.data(), batch.mHdrs.size(), 0,
+                       nullptr);
+      if (Metrics::enabled())
+        {
+          const int err = errno;
+          int i;
+
+          Metrics::add(Metrics::counter::COUNTER_READS);
+          for (i = 0; i < ret; i++)
+            {
+              Metrics::add(Metrics::counter::COUNTER_BYTES_IN,
+                           batch.mHdrs[i].msg_len);
+            }
+          if (ret < 0 && (err == EAGAIN || err == EWOULDBLOCK))
+            {
+              Metrics::add(Metrics::counter::COUNTER_WOULD_BLOCK);
+            }
+          errno = err;
+        }
+      if (ret > 0)
+        {
+          LOG_DBG("Received ", ret, " datagrams on ", this);
+          batch.mCount = ret;
+          count += ret;
+          cb(batch);
+        }
+      else if (ret == -1 && errno != EAGAIN && errno != EWOULDBLOCK &&
+               errno != EINTR)
+        {
+          LOG_ERR("Failed to read ", this, ": ", ::strerror(errno));
+        }
+    }
+  while (ret == static_cast<int>(batch.mHdrs.size()) ||
+         (ret == -1 && errno == EINTR));
+  return count;
+}
+
 std::optional<Socket::endpoint> Socket::getSource() const
 {
   endpoint ret({}, sizeof(struct sockaddr_storage));
@@ -378,7 +1079,7 @@ std::optional<SocketConnection> SocketListenerUdp::getNewClient(
   struct iovec iov =
     {
       .iov_base = data.data(),
-      .iov_len = data.capacity()
+      .iov_len = data.size()
     };
   struct msghdr hdr =
     {
@@ -390,52 +1091,129 @@ std::optional<SocketConnection> SocketListenerUdp::getNewClient(
       .msg_controllen = 0,
       .msg_flags = 0
     };
-  Socket::endpoint src = this->getSource().value();
-
-  if (!::getsockname(fd(), reinterpret_cast<struct sockaddr *>(&src.first),
-                   &src.second))
+  if (int ret = ::recvmsg(fd(), &hdr, 0); ret >= 0)
     {
-      if (int ret = ::recvmsg(fd(), &hdr, 0); ret >= 0)
-        {
-          SocketListener::accessReturn access_ret =
-            SocketListener::accessReturn::ACCESS_NEW;
+      SocketListener::accessReturn access_ret =
+        SocketListener::accessReturn::ACCESS_NEW;
 
-          data.resize(ret);
-          sender.second = hdr.msg_namelen;
-          if (cb_access)
-            {
-              access_ret = cb_access(sender, data);
-            }
-          if (access_ret == SocketListener::accessReturn::ACCESS_NEW)
-            {
-              return std::make_optional<SocketConnection>(
-                SOCK_DGRAM, std::set{std::make_pair<int, int>(SO_REUSEADDR, 1)},
-                src, sender);
-            }
-          else
-            {
-              LOG_DBG("Peer ", endpoint_to_string(sender), " ",
-                      (access_ret == SocketListener::accessReturn::ACCESS_DENY)
-                        ? "denied"
-                        : "existed");
-            }
+      data.resize(ret);
+      sender.second = hdr.msg_namelen;
+      if (cb_access)
+        {
+          access_ret = cb_access(sender, data);
         }
-      else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+      if (access_ret == SocketListener::accessReturn::ACCESS_NEW)
         {
-          LOG_ERR("Failed to read ", this, ": ", ::strerror(errno));
+          return std::make_optional<SocketConnection>(
+            SOCK_DGRAM, std::set{std::make_pair<int, int>(SO_REUSEADDR, 1)},
+            mSource, sender);
         }
       else
         {
-          ret = 0;
+          LOG_DBG("Peer ", endpoint_to_string(sender), " ",
+                  (access_ret == SocketListener::accessReturn::ACCESS_DENY)
+                    ? "denied"
+                    : "existed");
+          mStats.denied +=
+            (access_ret == SocketListener::accessReturn::ACCESS_DENY);
+          Metrics::add(Metrics::counter::COUNTER_DENIED,
+                       access_ret == SocketListener::accessReturn::ACCESS_DENY);
         }
     }
-  else
+  else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
     {
-      LOG_ERR("Failed to solve ", fd(), " name: ", ::strerror(errno));
+      LOG_ERR("Failed to read ", this, ": ", ::strerror(errno));
     }
   return {};
 }
 
+int UdpPeer::write(const void *data, size_t len, int flags) const
+{
+  LOG_DBG("Sending ", len, " bytes to ", this);
+  const int ret =
+    ::sendto(mListener.fd(), data, len, flags,
+             reinterpret_cast<const struct sockaddr *>(&mPeer.first),
+             mPeer.second);
+
+  if (Metrics::enabled())
+    {
+      const int err = errno;
+
+      Metrics::add(Metrics::counter::COUNTER_WRITES);
+      if (ret >= 0)
+        {
+          Metrics::add(Metrics::counter::COUNTER_BYTES_OUT, ret);
+        }
+      else if (err == EAGAIN || err == EWOULDBLOCK)
+        {
+          Metrics::add(Metrics::counter::COUNTER_WOULD_BLOCK);
+        }
+      errno = err;
+    }
+  return ret;
+}
+
+unsigned int SocketListenerUdpDemux::process(newPeerCb cb_new,
+                                             peerDataCb cb_data,
+                                             accessCb cb_access)
+{
+  return receive(mBatch, [&](DatagramBatch &batch) {
+    size_t i;
+
+    for (i = 0; i < batch.size(); i++)
+      {
+        const Socket::endpoint sender = batch.sender(i);
+        auto data = batch.data(i);
+
+        if (auto iter = mPeers.find(sender); iter != mPeers.end())
+          {
+            cb_data(iter->second, data);
+            continue;
+          }
+        if (cb_access)
+          {
+            mHandshake.assign(data.begin(), data.end());
+            if (auto access_ret = cb_access(sender, mHandshake);
+                access_ret != SocketListener::accessReturn::ACCESS_NEW)
+              {
+                LOG_DBG("Peer ", endpoint_to_string(sender), " ",
+                        (access_ret == SocketListener::accessReturn::ACCESS_DENY)
+                          ? "denied"
+                          : "existed");
+                mStats.denied +=
+                  (access_ret == SocketListener::accessReturn::ACCESS_DENY);
+                Metrics::add(
+                  Metrics::counter::COUNTER_DENIED,
+                  access_ret == SocketListener::accessReturn::ACCESS_DENY);
+                continue;
+              }
+          }
+
+        auto [iter, inserted] =
+          mPeers.emplace(std::piecewise_construct,
+                         std::forward_as_tuple(sender),
+                         std::forward_as_tuple(*this, sender));
+
+        LOG_DBG("New ", iter->second);
+        mStats.accepted++;
+        Metrics::add(Metrics::counter::COUNTER_ACCEPTS);
+        cb_new(iter->second, data);
+      }
+  });
+}
+
+const UdpPeer *SocketListenerUdpDemux::find(const Socket::endpoint &peer) const
+{
+  auto iter = mPeers.find(peer);
+
+  return (iter != mPeers.end()) ? &iter->second : nullptr;
+}
+
+bool SocketListenerUdpDemux::remove(const Socket::endpoint &peer)
+{
+  return mPeers.erase(peer);
+}
+
 AddrInfo::AddrInfo(const std::string node,
            std::optional<const std::string> service,
            std::optional<int> family,
@@ -0,0 +1,213 @@
+#include "timerwheel.hpp"
+
+using namespace Sukat;
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick)
+  : mTick(std::max(tick, std::chrono::milliseconds(1))), mStart(clock::now())
+{
+}
+
+TimerWheel::~TimerWheel()
+{
+  auto drop = [this](head &slot) {
+    while (slot.mNext != &slot)
+      {
+        remove(*slot.mNext);
+      }
+  };
+
+  for (auto &slot : mRoot)
+    {
+      drop(slot);
+    }
+  for (auto &level : mLevels)
+    {
+      for (auto &slot : level)
+        {
+          drop(slot);
+        }
+    }
+}
+
+void TimerWheel::schedule(Timer &timer, std::chrono::milliseconds delay)
+{
+  // Round up and count the partial tick we're in, so timers never fire
+  // early.
+  const uint64_t delay_ticks =
+    (std::max(delay, std::chrono::milliseconds(0)) + mTick -
+     std::chrono::milliseconds(1)) / mTick;
+
+  timer.cancel();
+  // Never behind the tick being processed, or a timer re-armed from a
+  // callback would land in the slot just emptied and wait a full turn.
+  timer.mExpires = std::max(ticks(clock::now()), mNow) + delay_ticks + 1;
+  timer.mWheel = this;
+  mSize++;
+  place(timer);
+}
+
+void TimerWheel::place(Timer &timer)
+{
+  const uint64_t expires = std::max(timer.mExpires, mNow);
+  head *slot;
+  unsigned int level;
+
+  if (expires - mNow < rootSlots)
+    {
+      slot = &mRoot[expires & (rootSlots - 1)];
+      level = 0;
+    }
+  else
+    {
+      // Count whole slot rows ahead of the current one, not ticks, so a
+      // timer never lands in the slot that has just been cascaded.
+      for (level = 1; level < levels; level++)
+        {
+          const unsigned int shift = rootBits + (level - 1) * levelBits;
+          const uint64_t ahead = (expires >> shift) - (mNow >> shift);
+
+          if (ahead < levelSlots || level == levels - 1)
+            {
+              const uint64_t row =
+                (mNow >> shift) + std::min(ahead, levelSlots - 1);
+
+              slot = &mLevels[level - 1][row & (levelSlots - 1)];
+              break;
+            }
+        }
+    }
+  timer.mLevel = level;
+  mCounts[level]++;
+  timer.mPrev = slot->mPrev;
+  timer.mNext = slot;
+  slot->mPrev->mNext = &timer;
+  slot->mPrev = &timer;
+}
+
+void TimerWheel::cascade()
+{
+  unsigned int level;
+
+  // Highest first, so timers moving down can cascade further right away.
+  for (level = levels - 1; level >= 1; level--)
+    {
+      const unsigned int shift = rootBits + (level - 1) * levelBits;
+
+      if (mNow & ((uint64_t{1} << shift) - 1))
+        {
+          continue;
+        }
+
+      head &slot = mLevels[level - 1][(mNow >> shift) & (levelSlots - 1)];
+
+      while (slot.mNext != &slot)
+        {
+          Timer &timer = *slot.mNext;
+
+          timer.unlink();
+          mCounts[level]--;
+          place(timer);
+        }
+    }
+}
+
+size_t TimerWheel::advance(clock::time_point now)
+{
+  const uint64_t target = ticks(now);
+  size_t fired = 0;
+
+  while (mNow <= target)
+    {
+      if (!mSize)
+        {
+          mNow = target + 1;
+          break;
+        }
+      if (!(mNow & (rootSlots - 1)))
+        {
+          cascade();
+        }
+      if (!mCounts[0])
+        {
+          // Nothing due before the next cascade.
+          mNow = std::min(target + 1, (mNow | (rootSlots - 1)) + 1);
+          continue;
+        }
+
+      head &slot = mRoot[mNow & (rootSlots - 1)];
+      head due;
+
+      // Detach first, callbacks may re-arm into this very slot.
+      if (slot.mNext != &slot)
+        {
+          due.mNext = slot.mNext;
+          due.mPrev = slot.mPrev;
+          due.mNext->mPrev = &due;
+          due.mPrev->mNext = &due;
+          slot.mNext = slot.mPrev = &slot;
+        }
+      while (due.mNext != &due)
+        {
+          Timer &timer = *due.mNext;
+
+          remove(timer);
+          fired++;
+          timer.mCb();
+        }
+      mNow++;
+    }
+  return fired;
+}
+
+std::optional<std::chrono::milliseconds> TimerWheel::timeout(
+  clock::time_point now) const
+{
+  uint64_t next = (mNow | (rootSlots - 1)) + 1;
+
+  if (!mSize)
+    {
+      return {};
+    }
+  if (!(mNow & (rootSlots - 1)))
+    {
+      unsigned int level;
+
+      // The cascade of the tick at hand is still to run.
+      for (level = 1; level < levels; level++)
+        {
+          const unsigned int shift = rootBits + (level - 1) * levelBits;
+          const head &slot =
+            mLevels[level - 1][(mNow >> shift) & (levelSlots - 1)];
+
+          if (!(mNow & ((uint64_t{1} << shift) - 1)) && slot.mNext != &slot)
+            {
+              next = mNow;
+            }
+        }
+    }
+  if (mCounts[0])
+    {
+      // Upper level timers may cascade due before any first level one.
+      const uint64_t cascade = (mSize > mCounts[0]) ? next : UINT64_MAX;
+      uint64_t i;
+
+      for (i = 0; i < rootSlots; i++)
+        {
+          const head &slot = mRoot[(mNow + i) & (rootSlots - 1)];
+
+          if (slot.mNext != &slot)
+            {
+              next = std::min(mNow + i, cascade);
+              break;
+            }
+        }
+    }
+
+  const auto at = mStart + next * mTick;
+
+  if (at <= now)
+    {
+      return std::chrono::milliseconds(0);
+    }
+  return std::chrono::ceil<std::chrono::milliseconds>(at - now);
+}
@@ -0,0 +1,409 @@
+#include <atomic>
+
+#include "uring.hpp"
+
+extern "C"
+{
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+}
+
+using namespace Sukat;
+
+namespace
+{
+int uring_setup(unsigned int entries, struct io_uring_params *params)
+{
+  return ::syscall(__NR_io_uring_setup, entries, params);
+}
+
+int uring_enter(int fd, unsigned int to_submit, unsigned int min_complete,
+                unsigned int flags, const void *arg, size_t argsz)
+{
+  return ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                   arg, argsz);
+}
+
+int uring_register(int fd, unsigned int opcode, void *arg,
+                   unsigned int nr_args)
+{
+  return ::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+uint32_t load_acquire(uint32_t *ptr)
+{
+  return std::atomic_ref<uint32_t>(*ptr).load(std::memory_order_acquire);
+}
+
+void store_release(uint32_t *ptr, uint32_t value)
+{
+  std::atomic_ref<uint32_t>(*ptr).store(value, std::memory_order_release);
+}
+} // namespace
+
+bool UringEngine::supported()
+{
+  static const bool is_supported = []() {
+    try
+      {
+        UringEngine probe(2, 1, 64);
+
+        return true;
+      }
+    catch (std::system_error &e)
+      {
+        LOG_INF("io_uring not usable: ", e.what());
+      }
+    return false;
+  }();
+
+  return is_supported;
+}
+
+UringEngine::UringEngine(unsigned int entries, unsigned int n_bufs,
+                         size_t buf_size)
+  : mRing(uring_setup(entries, &mParams)), mNumBufs(n_bufs),
+    mBufSize(buf_size), mBufs(n_bufs * buf_size)
+{
+  const char *failure = nullptr;
+  int err = 0;
+
+  if (mRing.fd() == -1)
+    {
+      throw std::system_error(errno, std::system_category(), "io_uring setup");
+    }
+  if (!(mParams.features & IORING_FEAT_EXT_ARG) || (n_bufs & (n_bufs - 1)))
+    {
+      throw std::system_error(EOPNOTSUPP, std::system_category(),
+                              "io_uring features");
+    }
+
+  mSqMapLen = mParams.sq_off.array + mParams.sq_entries * sizeof(uint32_t);
+  mCqMapLen =
+    mParams.cq_off.cqes + mParams.cq_entries * sizeof(struct io_uring_cqe);
+  if (mParams.features & IORING_FEAT_SINGLE_MMAP)
+    {
+      mSqMapLen = mCqMapLen = std::max(mSqMapLen, mCqMapLen);
+    }
+  mSqMap = ::mmap(nullptr, mSqMapLen, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, mRing.fd(), IORING_OFF_SQ_RING);
+  mCqMap = (mParams.features & IORING_FEAT_SINGLE_MMAP)
+             ? mSqMap
+             : ::mmap(nullptr, mCqMapLen, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, mRing.fd(),
+                      IORING_OFF_CQ_RING);
+  mSqes = static_cast<struct io_uring_sqe *>(
+    ::mmap(nullptr, mParams.sq_entries * sizeof(struct io_uring_sqe),
+           PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRing.fd(),
+           IORING_OFF_SQES));
+  mBufRing = static_cast<struct io_uring_buf_ring *>(
+    ::mmap(nullptr, n_bufs * sizeof(struct io_uring_buf),
+           PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+
+  if (mSqMap == MAP_FAILED || mCqMap == MAP_FAILED || mSqes == MAP_FAILED ||
+      mBufRing == MAP_FAILED)
+    {
+      err = errno;
+      failure = "io_uring mmap";
+    }
+  else
+    {
+      auto *sq = static_cast<uint8_t *>(mSqMap);
+      auto *cq = static_cast<uint8_t *>(mCqMap);
+      struct io_uring_buf_reg reg = {};
+      unsigned int i;
+
+      mSqHead = reinterpret_cast<uint32_t *>(sq + mParams.sq_off.head);
+      mSqTail = reinterpret_cast<uint32_t *>(sq + mParams.sq_off.tail);
+      mSqArray = reinterpret_cast<uint32_t *>(sq + mParams.sq_off.array);
+      mCqHead = reinterpret_cast<uint32_t *>(cq + mParams.cq_off.head);
+      mCqTail = reinterpret_cast<uint32_t *>(cq + mParams.cq_off.tail);
+      mCqes = reinterpret_cast<struct io_uring_cqe *>(cq + mParams.cq_off.cqes);
+      mSqLocalTail = *mSqTail;
+
+      reg.ring_addr = reinterpret_cast<uint64_t>(mBufRing);
+      reg.ring_entries = n_bufs;
+      reg.bgid = bufGroup;
+      if (!uring_register(mRing.fd(), IORING_REGISTER_PBUF_RING, &reg, 1))
+        {
+          mBufRing->tail = 0;
+          for (i = 0; i < n_bufs; i++)
+            {
+              recycle(i);
+            }
+          LOG_DBG("Created io_uring ", mRing.fd(), " with ",
+                  mParams.sq_entries, " entries");
+          return;
+        }
+      err = errno;
+      failure = "io_uring buffer ring";
+    }
+  unmap();
+  throw std::system_error(err, std::system_category(), failure);
+}
+
+UringEngine::~UringEngine()
+{
+  unmap();
+}
+
+void UringEngine::unmap()
+{
+  if (mBufRing && mBufRing != MAP_FAILED)
+    {
+      ::munmap(mBufRing, mNumBufs * sizeof(struct io_uring_buf));
+      mBufRing = nullptr;
+    }
+  if (mSqes && mSqes != MAP_FAILED)
+    {
+      ::munmap(mSqes, mParams.sq_entries * sizeof(struct io_uring_sqe));
+      mSqes = nullptr;
+    }
+  if (mCqMap && mCqMap != MAP_FAILED && mCqMap != mSqMap)
+    {
+      ::munmap(mCqMap, mCqMapLen);
+    }
+  mCqMap = nullptr;
+  if (mSqMap && mSqMap != MAP_FAILED)
+    {
+      ::munmap(mSqMap, mSqMapLen);
+      mSqMap = nullptr;
+    }
+}
+
+struct io_uring_sqe *UringEngine::getSqe()
+{
+  if (mSqLocalTail - load_acquire(mSqHead) >= mParams.sq_entries)
+    {
+      // Ring full, push what we have to the kernel first.
+      if (submit() < 0)
+        {
+          throw std::system_error(errno, std::system_category(),
+                                  "io_uring submit");
+        }
+    }
+
+  const uint32_t index = mSqLocalTail & (mParams.sq_entries - 1);
+  struct io_uring_sqe *sqe = &mSqes[index];
+
+  ::memset(sqe, 0, sizeof(*sqe));
+  mSqArray[index] = index;
+  mSqLocalTail++;
+  mToSubmit++;
+  return sqe;
+}
+
+void UringEngine::prepare(struct io_uring_sqe *sqe, uint8_t opcode,
+                          Handler *handler, op kind)
+{
+  sqe->opcode = opcode;
+  sqe->user_data =
+    reinterpret_cast<uint64_t>(handler) | static_cast<uint64_t>(kind);
+  if (handler)
+    {
+      sqe->fd = handler->mFd;
+      handler->mInflight++;
+    }
+}
+
+void UringEngine::recycle(uint16_t bid)
+{
+  const uint16_t mask = mNumBufs - 1;
+  // Not mBufRing->bufs: in C++ the uapi flex array lands at offset 8.
+  auto *bufs = reinterpret_cast<struct io_uring_buf *>(mBufRing);
+  struct io_uring_buf &buf = bufs[mBufRing->tail & mask];
+
+  buf.addr = reinterpret_cast<uint64_t>(mBufs.data() + bid * mBufSize);
+  buf.len = mBufSize;
+  buf.bid = bid;
+  std::atomic_ref<uint16_t>(mBufRing->tail)
+    .store(mBufRing->tail + 1, std::memory_order_release);
+}
+
+void UringEngine::accept(const SocketListenerStream &listener,
+                         Handler &handler)
+{
+  struct io_uring_sqe *sqe = getSqe();
+
+  handler.mFd = listener.fd();
+  prepare(sqe, IORING_OP_ACCEPT, &handler, op::OP_ACCEPT);
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+}
+
+void UringEngine::recv(const SocketConnection &conn, Handler &handler)
+{
+  handler.mFd = conn.fd();
+  armRecv(handler);
+}
+
+void UringEngine::armRecv(Handler &handler)
+{
+  struct io_uring_sqe *sqe = getSqe();
+
+  prepare(sqe, IORING_OP_RECV, &handler, op::OP_RECV);
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = bufGroup;
+}
+
+void UringEngine::send(const SocketConnection &conn,
+                       std::span<const struct iovec> iovs, Handler &handler)
+{
+  size_t i;
+
+  handler.mFd = conn.fd();
+  for (i = 0; i < iovs.size(); i++)
+    {
+      struct io_uring_sqe *sqe = getSqe();
+
+      prepare(sqe, IORING_OP_SEND, &handler, op::OP_SEND);
+      sqe->addr = reinterpret_cast<uint64_t>(iovs[i].iov_base);
+      sqe->len = iovs[i].iov_len;
+      // Short sends would reorder the stream, so have the kernel retry.
+      sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+      if (i + 1 < iovs.size())
+        {
+          sqe->flags = IOSQE_IO_LINK;
+        }
+    }
+}
+
+void UringEngine::cancel(const Socket &sock)
+{
+  struct io_uring_sqe *sqe = getSqe();
+
+  prepare(sqe, IORING_OP_ASYNC_CANCEL, nullptr, op::OP_CANCEL);
+  sqe->fd = sock.fd();
+  sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+}
+
+int UringEngine::submit()
+{
+  int ret;
+
+  store_release(mSqTail, mSqLocalTail);
+  ret = uring_enter(mRing.fd(), mToSubmit, 0, 0, nullptr, 0);
+  if (ret >= 0)
+    {
+      mToSubmit -= std::min<uint32_t>(ret, mToSubmit);
+    }
+  return ret;
+}
+
+size_t UringEngine::poll(int timeout)
+{
+  size_t count = 0;
+  uint32_t head;
+
+  store_release(mSqTail, mSqLocalTail);
+  if (timeout)
+    {
+      struct __kernel_timespec ts = {
+        .tv_sec = timeout / 1000,
+        .tv_nsec = (timeout % 1000) * 1000000L,
+      };
+      struct io_uring_getevents_arg arg = {};
+
+      arg.ts = reinterpret_cast<uint64_t>(&ts);
+      if (uring_enter(mRing.fd(), mToSubmit, 1,
+                      IORING_ENTER_GETEVENTS |
+                        ((timeout > 0) ? IORING_ENTER_EXT_ARG : 0),
+                      (timeout > 0) ? &arg : nullptr,
+                      (timeout > 0) ? sizeof(arg) : 0) >= 0 ||
+          errno == ETIME || errno == EINTR)
+        {
+          mToSubmit = 0;
+        }
+      else
+        {
+          throw std::system_error(errno, std::system_category(),
+                                  "io_uring wait");
+        }
+    }
+  else if (mToSubmit && submit() < 0)
+    {
+      throw std::system_error(errno, std::system_category(),
+                              "io_uring submit");
+    }
+
+  head = *mCqHead;
+  while (head != load_acquire(mCqTail))
+    {
+      // Copy out, the slot is handed back to the kernel before dispatch.
+      const struct io_uring_cqe cqe = mCqes[head & (mParams.cq_entries - 1)];
+
+      store_release(mCqHead, ++head);
+      complete(cqe);
+      count++;
+    }
+  return count;
+}
+
+void UringEngine::complete(const struct io_uring_cqe &cqe)
+{
+  Handler *handler = reinterpret_cast<Handler *>(cqe.user_data & ~opMask);
+  const op kind = static_cast<op>(cqe.user_data & opMask);
+  const bool more = cqe.flags & IORING_CQE_F_MORE;
+
+  if (!handler)
+    {
+      return;
+    }
+  if (!more)
+    {
+      handler->mInflight--;
+    }
+  switch (kind)
+    {
+      case op::OP_ACCEPT:
+        if (cqe.res >= 0)
+          {
+            handler->accepted(SocketConnection(Fd(cqe.res)));
+          }
+        break;
+      case op::OP_RECV:
+        if (cqe.res >= 0)
+          {
+            const uint16_t bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+            std::span<const uint8_t> data;
+
+            if (cqe.flags & IORING_CQE_F_BUFFER)
+              {
+                data = {mBufs.data() + bid * mBufSize,
+                        static_cast<size_t>(cqe.res)};
+              }
+            handler->received(data);
+            if (cqe.flags & IORING_CQE_F_BUFFER)
+              {
+                recycle(bid);
+              }
+            if (!more && cqe.res > 0)
+              {
+                // Multishot ended, e.g. CQ pressure. Re-arm.
+                armRecv(*handler);
+              }
+            return;
+          }
+        else if (cqe.res == -ENOBUFS)
+          {
+            // Ring ran dry, buffers return as handlers finish. Re-arm.
+            LOG_DBG("io_uring receive buffers exhausted on ", handler->mFd);
+            armRecv(*handler);
+            return;
+          }
+        break;
+      case op::OP_SEND:
+        handler->sent(cqe.res);
+        return;
+      case op::OP_CANCEL:
+        return;
+    }
+  if (cqe.res < 0)
+    {
+      LOG_DBG("io_uring operation ", static_cast<uint64_t>(kind), " on ",
+              handler->mFd, " failed: ", ::strerror(-cqe.res));
+      handler->error(cqe.res);
+    }
+}
@@ -0,0 +1,210 @@
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "binlog.hpp"
+#include "logging.hpp"
+
+using namespace Sukat;
+
+class SukatBinaryLogTest : public ::testing::Test
+{
+ protected:
+  SukatBinaryLogTest()
+  {
+  }
+
+  virtual ~SukatBinaryLogTest()
+  {
+  }
+
+  virtual void SetUp()
+  {
+  }
+
+  virtual void TearDown()
+  {
+  }
+
+  /** @brief Decoded lines of \p data without their timestamps */
+  static std::vector<std::string> decode(const std::string &data)
+  {
+    std::istringstream in(data);
+    std::ostringstream out;
+    std::vector<std::string> lines;
+    std::string line;
+
+    BinaryLog::decode(in, out);
+    std::istringstream rendered(out.str());
+    while (std::getline(rendered, line))
+      {
+        auto ts_end = line.find("] ");
+
+        lines.emplace_back((line.front() == '[' && ts_end != line.npos)
+                             ? line.substr(ts_end + 2)
+                             : line);
+      }
+    return lines;
+  }
+
+  /** @brief Log through a small dropping ring, exit 0 if all is decoded */
+  static void logDropping()
+  {
+    const unsigned int n_lines = 10000;
+    unsigned int i, rendered = 0, dropped = 0;
+    bool redefined = false;
+
+    Logger::initializeBinary(Logger::LogLevel::INFORMATIONAL, logfile,
+                             Logger::overflowPolicy::OVERFLOW_DROP, 256);
+    // Too long for the ring, dropped with its site definition.
+    for (const std::string &arg : {std::string(512, 'x'),
+                                   std::string("short")})
+      {
+        LOG_INF("first ", arg);
+      }
+    for (i = 0; i < n_lines; i++)
+      {
+        if (i % 2)
+          {
+            LOG_INF("odd ", i);
+          }
+        else
+          {
+            LOG_INF("even ", i);
+          }
+      }
+    Logger::flush();
+
+    std::ifstream in(logfile, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)),
+                     std::istreambuf_iterator<char>());
+    auto lines = decode(data);
+
+    ::unlink(logfile);
+    for (const auto &line : lines)
+      {
+        if (line.starts_with("Logger: "))
+          {
+            dropped += std::stoul(line.substr(8));
+            if (line.find(" undefined ") != std::string::npos)
+              {
+                std::cerr << line;
+                std::exit(1);
+              }
+          }
+        else
+          {
+            redefined |= line.ends_with("): first short");
+            rendered++;
+          }
+      }
+    if (!redefined || rendered + dropped != n_lines + 2)
+      {
+        std::cerr << "rendered " << rendered << " dropped " << dropped;
+        std::exit(1);
+      }
+    std::exit(0);
+  }
+
+  static constexpr const char *logfile = "/tmp/sukat_test_binlog.log";
+};
+
+TEST_F(SukatBinaryLogTest, SukatBinaryLogTestRoundTrip)
+{
+  std::string data(BinaryLog::magic);
+  char mutable_buf[] = "changes";
+  const std::string str = "string";
+  int value = -42;
+  auto line = [&](auto &&... args) {
+    BinaryLog::encodeLine<decltype(args)...>(
+      data, 1, 1234567890123456789, std::forward<decltype(args)>(args)...);
+  };
+
+  BinaryLog::encodeSite<const char(&)[5], int &, const char(&)[2],
+                        uint64_t, const char(&)[2], const std::string &,
+                        char(&)[8], double, bool, void *>(
+    data, 1, 0, "file", 7, "int ", value, " ", uint64_t{7}, " ", str,
+    mutable_buf, 0.5, true, nullptr);
+  line("int ", value, " ", uint64_t{7}, " ", str, mutable_buf, 0.5, true,
+       static_cast<void *>(nullptr));
+  BinaryLog::encodeDropped(data, 3);
+
+  auto lines = decode(data);
+  ASSERT_EQ(2, lines.size());
+  EXPECT_EQ("file(7): int -42 7 stringchanges0.510", lines[0]);
+  EXPECT_EQ("Logger: 3 lines dropped", lines[1]);
+
+  std::istringstream bad("NOTALOG!");
+  std::ostringstream out;
+  EXPECT_THROW(BinaryLog::decode(bad, out), std::runtime_error);
+  std::istringstream truncated(data.substr(0, data.size() - 3));
+  EXPECT_THROW(BinaryLog::decode(truncated, out), std::runtime_error);
+}
+
+TEST_F(SukatBinaryLogTest, SukatBinaryLogTestLogger)
+{
+  const unsigned int n_threads = 4, n_lines = 1000;
+  std::vector<std::jthread> threads;
+  unsigned int i;
+
+  Logger::initializeBinary(Logger::LogLevel::INFORMATIONAL, logfile,
+                           Logger::overflowPolicy::OVERFLOW_BLOCK);
+  for (i = 0; i < n_threads; i++)
+    {
+      threads.emplace_back([i]() {
+        unsigned int j;
+
+        for (j = 0; j < n_lines; j++)
+          {
+            LOG_INF("thread ", i, " line ", j, " ", std::string("dyn"));
+          }
+      });
+    }
+  threads.clear();
+  LOG_ERR("Failed: ", ::strerror(EAGAIN));
+  Logger::flush();
+
+  std::ifstream in(logfile, std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+  auto lines = decode(data);
+
+  ASSERT_EQ(n_threads * n_lines + 1, lines.size());
+  EXPECT_NE(std::string::npos, lines[0].find("): thread "));
+  EXPECT_NE(std::string::npos, lines[0].find(" dyn"));
+  EXPECT_EQ(std::string("): Failed: ") + ::strerror(EAGAIN),
+            lines.back().substr(lines.back().find("): ")));
+  ::unlink(logfile);
+}
+
+TEST_F(SukatBinaryLogTest, SukatBinaryLogTestUndefinedSite)
+{
+  std::string data(BinaryLog::magic);
+
+  BinaryLog::encodeSite<const char(&)[5]>(data, 1, 0, "file", 7, "site");
+  BinaryLog::encodeLine<const char(&)[5]>(data, 1, 0, "site");
+  BinaryLog::encodeLine<int>(data, 2, 0, 1);
+  BinaryLog::encodeLine<const char(&)[5]>(data, 1, 0, "site");
+
+  auto lines = decode(data);
+  ASSERT_EQ(3, lines.size());
+  EXPECT_EQ("file(7): site", lines[0]);
+  EXPECT_EQ("file(7): site", lines[1]);
+  EXPECT_EQ("Logger: 1 lines of undefined sites skipped", lines[2]);
+}
+
+TEST_F(SukatBinaryLogTest, SukatBinaryLogTestDropped)
+{
+  // Needs a Logger of its own, run in a fresh process.
+  ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+  EXPECT_EXIT(logDropping(), ::testing::ExitedWithCode(0), "");
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
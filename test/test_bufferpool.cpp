@@ -0,0 +1,118 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+
+#include "buffer.hpp"
+#include "bufferpool.hpp"
+
+class SukatBufferPoolTest : public ::testing::Test
+{
+ protected:
+  SukatBufferPoolTest()
+  {
+  }
+
+  virtual ~SukatBufferPoolTest()
+  {
+  }
+
+  virtual void SetUp()
+  {
+  }
+
+  virtual void TearDown()
+  {
+  }
+};
+
+TEST_F(SukatBufferPoolTest, SukatBufferPoolTestRecycle)
+{
+  Sukat::BufferPool pool(1000, 4);
+
+  EXPECT_EQ(0, pool.allocated());
+  auto first = pool.get();
+  ASSERT_TRUE(first);
+  EXPECT_EQ(1000, first.data().size());
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(first.data().data()) % 64);
+  EXPECT_EQ(4, pool.allocated());
+  EXPECT_EQ(3, pool.available());
+
+  uint8_t *storage = first.data().data();
+  auto shared = first;
+  EXPECT_EQ(2, first.useCount());
+  first.reset();
+  EXPECT_FALSE(first);
+  EXPECT_EQ(3, pool.available());
+  shared.reset();
+  EXPECT_EQ(4, pool.available());
+
+  // Most recently released comes back first, while still cache hot.
+  auto again = pool.get();
+  EXPECT_EQ(storage, again.data().data());
+
+  std::vector<Sukat::BufferPool::Handle> held;
+  unsigned int i;
+
+  for (i = 0; i < 5; i++)
+    {
+      held.emplace_back(pool.get());
+    }
+  EXPECT_EQ(8, pool.allocated());
+  held.clear();
+  EXPECT_EQ(7, pool.available());
+}
+
+TEST_F(SukatBufferPoolTest, SukatBufferPoolTestRemoteRelease)
+{
+  Sukat::BufferPool pool(128, 2);
+  auto handle = pool.get();
+  uint8_t *storage = handle.data().data();
+
+  EXPECT_EQ(1, pool.available());
+  std::thread([h = std::move(handle)]() mutable { h.reset(); }).join();
+  // Collected only once the owner runs out.
+  EXPECT_EQ(1, pool.available());
+  auto other = pool.get();
+  EXPECT_NE(storage, other.data().data());
+  auto returned = pool.get();
+  EXPECT_EQ(storage, returned.data().data());
+  EXPECT_EQ(2, pool.allocated());
+}
+
+TEST_F(SukatBufferPoolTest, SukatBufferPoolTestOutlivePool)
+{
+  Sukat::BufferPool::Handle handle;
+
+  {
+    Sukat::BufferPool pool(64, 1);
+
+    handle = pool.get();
+  }
+  handle.data()[63] = 42;
+  EXPECT_EQ(42, handle.data()[63]);
+  handle.reset();
+}
+
+TEST_F(SukatBufferPoolTest, SukatBufferPoolTestPooledBuffer)
+{
+  Sukat::BufferPool &pool = Sukat::BufferPool::local();
+
+  {
+    Sukat::Buffer buf(pool.get());
+
+    EXPECT_EQ(pool.slabSize(), buf.capacity());
+    buf.writable()[0] = 'a';
+    buf.commit(1);
+    EXPECT_EQ("a", buf.view());
+
+    Sukat::Buffer moved(std::move(buf));
+    EXPECT_EQ("a", moved.view());
+  }
+  EXPECT_EQ(pool.allocated(), pool.available());
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,183 @@
+#include <chrono>
+#include <mutex>
+#include <set>
+
+#include "gtest/gtest.h"
+
+#include "connectionhub.hpp"
+
+class SukatConnectionHubTest : public ::testing::Test
+{
+ protected:
+  SukatConnectionHubTest()
+  {
+  }
+
+  virtual ~SukatConnectionHubTest()
+  {
+  }
+
+  virtual void SetUp()
+  {
+  }
+
+  virtual void TearDown()
+  {
+  }
+
+  /** @brief Wait until \p pred holds, up to a second */
+  template <typename Pred> bool waitFor(Pred pred)
+  {
+    unsigned int i;
+
+    for (i = 0; i < 200; i++)
+      {
+        if (pred())
+          {
+            return true;
+          }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      }
+    return false;
+  }
+};
+
+TEST_F(SukatConnectionHubTest, SukatConnectionHubTestShard)
+{
+  Sukat::AddrInfo addrinfo("localhost", {}, AF_INET, SOCK_STREAM);
+  Sukat::SocketListenerStream tcp_listener(
+    Sukat::Socket::make_endpoint(addrinfo.mResults[0]));
+  auto saddr = tcp_listener.getSource().value();
+  std::atomic<unsigned int> connected{0}, received{0}, closed{0};
+  std::mutex lock;
+  std::set<std::thread::id> threads;
+  Sukat::ConnectionHub hub(
+    [&](Sukat::SocketConnection &conn, uint32_t events) {
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        threads.insert(std::this_thread::get_id());
+      }
+      if (events & EPOLLOUT)
+        {
+          connected++;
+        }
+      if (events & EPOLLIN)
+        {
+          thread_local Sukat::Buffer buf;
+          auto res = conn.read(buf);
+
+          buf.clear();
+
+          received += res.bytes;
+          if (res.status == Sukat::SocketConnection::readStatus::READ_EOF)
+            {
+              closed++;
+              return false;
+            }
+        }
+      return true;
+    },
+    2);
+  std::vector<Sukat::ConnectionHub::connectionId> ids;
+  std::vector<Sukat::SocketConnection> servers;
+  const unsigned int n_conns = 8;
+  unsigned int i;
+
+  EXPECT_EQ(2, hub.workers());
+  for (i = 0; i < n_conns; i++)
+    {
+      ids.push_back(hub.add(Sukat::SocketConnection(SOCK_STREAM, saddr)));
+    }
+  EXPECT_EQ(n_conns, hub.size());
+  EXPECT_TRUE(waitFor([&]() {
+    auto accepted = tcp_listener.accept();
+
+    std::move(accepted.begin(), accepted.end(), std::back_inserter(servers));
+    return servers.size() == n_conns;
+  }));
+  EXPECT_TRUE(waitFor([&]() { return connected == n_conns; }));
+
+  // Least loaded assignment alternates between the two workers.
+  for (i = 0; i < n_conns; i++)
+    {
+      EXPECT_EQ(i % 2, ids[i].worker);
+    }
+
+  for (auto &server : servers)
+    {
+      EXPECT_EQ(5, server.write("hello"));
+    }
+  EXPECT_TRUE(waitFor([&]() { return received == 5 * n_conns; }));
+
+  std::atomic<unsigned int> posted{0};
+  const auto main_thread = std::this_thread::get_id();
+  for (const auto &id : ids)
+    {
+      hub.post(id, [&](Sukat::SocketConnection &conn) {
+        EXPECT_EQ(id.fd, conn.fd());
+        EXPECT_NE(std::this_thread::get_id(), main_thread);
+        conn.write("ping");
+        posted++;
+      });
+    }
+  EXPECT_TRUE(waitFor([&]() { return posted == n_conns; }));
+  for (auto &server : servers)
+    {
+      EXPECT_TRUE(waitFor([&]() { return server.readData().str() == "ping"; }));
+    }
+
+  hub.remove(ids[0]);
+  EXPECT_TRUE(waitFor([&]() { return hub.size() == n_conns - 1; }));
+  servers.clear();
+  EXPECT_TRUE(waitFor([&]() { return hub.size() == 0; }));
+  EXPECT_EQ(n_conns - 1, closed);
+  EXPECT_EQ(2, threads.size());
+}
+
+TEST_F(SukatConnectionHubTest, SukatConnectionHubTestConnect)
+{
+  Sukat::AddrInfo addrinfo("127.0.0.1", {}, AF_INET, SOCK_STREAM);
+  Sukat::SocketListenerStream tcp_listener(
+    Sukat::Socket::make_endpoint(addrinfo.mResults[0]));
+  auto saddr = tcp_listener.getSource().value();
+  const std::string port = std::to_string(
+    ntohs(reinterpret_cast<struct sockaddr_in *>(&saddr.first)->sin_port));
+  std::atomic<unsigned int> connected{0}, received{0};
+  Sukat::ConnectionHub hub(
+    [&](Sukat::SocketConnection &conn, uint32_t events) {
+      if (events & EPOLLOUT)
+        {
+          connected++;
+        }
+      if (events & EPOLLIN)
+        {
+          thread_local Sukat::Buffer buf;
+
+          received += conn.read(buf).bytes;
+          buf.clear();
+        }
+      return true;
+    },
+    1);
+  std::vector<Sukat::SocketConnection> servers;
+
+  auto id = hub.connect(SOCK_STREAM, "127.0.0.1", port);
+  EXPECT_EQ(0, id.worker);
+  EXPECT_EQ(1, hub.size());
+  EXPECT_TRUE(waitFor([&]() {
+    auto accepted = tcp_listener.accept();
+
+    std::move(accepted.begin(), accepted.end(), std::back_inserter(servers));
+    return servers.size() == 1;
+  }));
+  EXPECT_TRUE(waitFor([&]() { return connected == 1; }));
+  EXPECT_EQ(5, servers[0].write("hello"));
+  EXPECT_TRUE(waitFor([&]() { return received == 5; }));
+}
+
+int main(int argc, char **argv)
+{
+  Sukat::Logger::initialize(Sukat::Logger::LogLevel::ERROR);
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
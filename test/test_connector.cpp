@@ -0,0 +1,185 @@
+#include "gtest/gtest.h"
+
+#include "connector.hpp"
+
+extern "C"
+{
+#include <arpa/inet.h>
+}
+
+class SukatConnectorTest : public ::testing::Test
+{
+ protected:
+  SukatConnectorTest()
+  {
+  }
+
+  virtual ~SukatConnectorTest()
+  {
+  }
+
+  virtual void SetUp()
+  {
+  }
+
+  virtual void TearDown()
+  {
+  }
+
+  static Sukat::Socket::endpoint make(int family, const char *addr,
+                                      uint16_t port)
+  {
+    Sukat::Socket::endpoint ep = Sukat::Socket::make_endpoint(family);
+
+    if (family == AF_INET)
+      {
+        auto *sin = reinterpret_cast<struct sockaddr_in *>(&ep.first);
+
+        ::inet_pton(AF_INET, addr, &sin->sin_addr);
+        sin->sin_port = htons(port);
+      }
+    else
+      {
+        auto *sin6 = reinterpret_cast<struct sockaddr_in6 *>(&ep.first);
+
+        ::inet_pton(AF_INET6, addr, &sin6->sin6_addr);
+        sin6->sin6_port = htons(port);
+      }
+    return ep;
+  }
+
+  /** @brief Run the race to its end */
+  void race(Sukat::Connector &connector)
+  {
+    unsigned int rounds = 0;
+
+    connector.start();
+    while (!finished && rounds++ < 100)
+      {
+        reactor.poll(100);
+      }
+  }
+
+  Sukat::Reactor reactor;
+  bool finished{false};
+  std::optional<Sukat::SocketConnection> winner;
+  int error{0};
+  Sukat::Connector::connectCb cb = [this](
+                                     std::optional<Sukat::SocketConnection>
+                                       &&conn,
+                                     int err) {
+    finished = true;
+    if (conn)
+      {
+        winner.emplace(std::move(conn.value()));
+      }
+    error = err;
+  };
+};
+
+TEST_F(SukatConnectorTest, SukatConnectorTestInterleave)
+{
+  auto v6a = make(AF_INET6, "2001:db8::1", 1), v6b = make(AF_INET6, "::1", 2),
+       v4a = make(AF_INET, "192.0.2.1", 3), v4b = make(AF_INET, "127.0.0.1", 4);
+  auto order = Sukat::Connector::interleave({v6a, v6b, v6b, v4a, v4b});
+  Sukat::Socket::endpointEqual eq;
+
+  ASSERT_EQ(5, order.size());
+  EXPECT_TRUE(eq(v6a, order[0]));
+  EXPECT_TRUE(eq(v4a, order[1]));
+  EXPECT_TRUE(eq(v6b, order[2]));
+  EXPECT_TRUE(eq(v4b, order[3]));
+  EXPECT_TRUE(eq(v6b, order[4]));
+}
+
+TEST_F(SukatConnectorTest, SukatConnectorTestFallbackOnRefused)
+{
+  Sukat::SocketListenerStream listener(AF_INET);
+  auto source = listener.getSource();
+  ASSERT_TRUE(source);
+  uint16_t port =
+    ntohs(reinterpret_cast<struct sockaddr_in *>(&source->first)->sin_port);
+  // Nothing listens on the v6 loopback port, so it is refused right away.
+  Sukat::Connector connector(
+    reactor, {make(AF_INET6, "::1", port), make(AF_INET, "127.0.0.1", port)},
+    SOCK_STREAM, cb, std::chrono::seconds(10));
+  auto start = std::chrono::steady_clock::now();
+
+  race(connector);
+  EXPECT_TRUE(finished);
+  ASSERT_TRUE(winner);
+  EXPECT_EQ(0, error);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  EXPECT_EQ(0, winner->polloutReady());
+  EXPECT_EQ(0, connector.running());
+}
+
+TEST_F(SukatConnectorTest, SukatConnectorTestStaggered)
+{
+  // A full accept queue drops SYNs, so connects to it hang.
+  Sukat::SocketListenerStream stalled(AF_INET, {}, SOCK_STREAM, 0);
+  Sukat::SocketListenerStream listener(AF_INET);
+  auto stalled_src = stalled.getSource(), src = listener.getSource();
+  ASSERT_TRUE(stalled_src && src);
+  std::vector<Sukat::SocketConnection> fill;
+  unsigned int i;
+
+  for (i = 0; i < 4; i++)
+    {
+      fill.emplace_back(SOCK_STREAM, stalled_src.value());
+    }
+  Sukat::Connector connector(reactor, {stalled_src.value(), src.value()},
+                             SOCK_STREAM, cb, std::chrono::milliseconds(50));
+  auto start = std::chrono::steady_clock::now();
+
+  race(connector);
+  ASSERT_TRUE(winner);
+  EXPECT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(50));
+  auto peer = listener.accept();
+  EXPECT_EQ(1, peer.size());
+}
+
+TEST_F(SukatConnectorTest, SukatConnectorTestTimeout)
+{
+  Sukat::SocketListenerStream stalled(AF_INET, {}, SOCK_STREAM, 0);
+  auto src = stalled.getSource();
+  ASSERT_TRUE(src);
+  std::vector<Sukat::SocketConnection> fill;
+  unsigned int i;
+
+  for (i = 0; i < 4; i++)
+    {
+      fill.emplace_back(SOCK_STREAM, src.value());
+    }
+  Sukat::Connector connector(reactor, {src.value()}, SOCK_STREAM, cb);
+  auto start = std::chrono::steady_clock::now();
+
+  connector.setTimeout(std::chrono::milliseconds(50));
+  race(connector);
+  EXPECT_TRUE(finished);
+  EXPECT_FALSE(winner);
+  EXPECT_EQ(ETIMEDOUT, error);
+  EXPECT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(50));
+  EXPECT_EQ(0, connector.running());
+}
+
+TEST_F(SukatConnectorTest, SukatConnectorTestAllFail)
+{
+  Sukat::Connector connector(reactor,
+                             {make(AF_INET6, "::1", 1),
+                              make(AF_INET, "127.0.0.1", 1)},
+                             SOCK_STREAM, cb);
+
+  race(connector);
+  EXPECT_TRUE(finished);
+  EXPECT_FALSE(winner);
+  EXPECT_EQ(ECONNREFUSED, error);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
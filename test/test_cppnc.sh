@@ -0,0 +1,36 @@
+#!/bin/sh
+# Plain netcat mode relays stdin to the peer and the reply to stdout.
+# Usage: test_cppnc.sh <path to Cppconnect>
+set -u
+
+nc="$1"
+port=$((20000 + $$ % 20000))
+fail=0
+
+# check <expected> <server args> -- <client args>
+check()
+{
+  expected="$1"
+  shift
+  server=""
+  while [ "$1" != "--" ]; do
+    server="$server $1"
+    shift
+  done
+  shift
+  $nc -l -i 0 -t 5 $server &
+  pid=$!
+  sleep 0.3
+  got=$(echo "$expected" | $nc -w 1 "$@")
+  if [ "$got" != "$expected" ]; then
+    echo "FAIL: $nc $*: got '$got', expected '$expected'"
+    fail=1
+  fi
+  kill $pid 2>/dev/null
+  wait $pid 2>/dev/null
+}
+
+check hello-unix -U @cppnc_test_$$ -- -U @cppnc_test_$$
+check hello-tcp 127.0.0.1 $port -- 127.0.0.1 $port
+check hello-udp -u 127.0.0.1 $port -- -u 127.0.0.1 $port
+exit $fail
@@ -0,0 +1,163 @@
+#include "gtest/gtest.h"
+
+#include "forwarder.hpp"
+
+extern "C"
+{
+#include <stdio.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+}
+
+class SukatForwarderTest : public ::testing::Test
+{
+ protected:
+  SukatForwarderTest()
+  {
+  }
+
+  virtual ~SukatForwarderTest()
+  {
+  }
+
+  virtual void SetUp()
+  {
+    ASSERT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, src));
+    ASSERT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, dst));
+  }
+
+  virtual void TearDown()
+  {
+    ::close(src[0]);
+    ::close(src[1]);
+    ::close(dst[0]);
+    ::close(dst[1]);
+  }
+
+  /** @brief Read everything available from \p fd. */
+  std::string drain(int fd)
+  {
+    std::string data;
+    char buf[4096];
+    ssize_t ret;
+
+    while ((ret = ::read(fd, buf, sizeof(buf))) > 0)
+      {
+        data.append(buf, ret);
+      }
+    return data;
+  }
+
+  int src[2], dst[2]; //!< Data flows src[0] -> src[1] -> dst[0] -> dst[1].
+};
+
+TEST_F(SukatForwarderTest, SukatForwarderTestSplice)
+{
+  using forwardStatus = Sukat::Forwarder::forwardStatus;
+  Sukat::Forwarder fwd(src[1], dst[0]);
+  std::string data = "spliced without a copy";
+
+  auto res = fwd.forward();
+  EXPECT_EQ(forwardStatus::FWD_IN_AGAIN, res.status);
+  EXPECT_EQ(0, res.bytes);
+
+  ASSERT_EQ(data.length(), ::write(src[0], data.c_str(), data.length()));
+  res = fwd.forward();
+  EXPECT_EQ(forwardStatus::FWD_IN_AGAIN, res.status);
+  EXPECT_EQ(data.length(), res.bytes);
+  EXPECT_EQ(data, drain(dst[1]));
+
+  // Fill the destination until it pushes back.
+  std::string chunk(65536, 'x');
+  size_t written = 0, forwarded = 0, received = 0;
+
+  do
+    {
+      ssize_t ret = ::write(src[0], chunk.c_str(), chunk.length());
+
+      written += (ret > 0) ? ret : 0;
+      res = fwd.forward();
+      forwarded += res.bytes;
+    }
+  while (res.status == forwardStatus::FWD_IN_AGAIN &&
+         written < 64 * 1024 * 1024);
+  EXPECT_EQ(forwardStatus::FWD_OUT_AGAIN, res.status);
+  EXPECT_GT(fwd.pending(), 0);
+
+  while (received < written)
+    {
+      std::string got = drain(dst[1]);
+
+      received += got.length();
+      EXPECT_EQ(std::string(got.length(), 'x'), got);
+      forwarded += fwd.forward().bytes;
+    }
+  EXPECT_EQ(written, forwarded);
+  EXPECT_EQ(0, fwd.pending());
+
+  ::shutdown(src[0], SHUT_WR);
+  EXPECT_EQ(forwardStatus::FWD_EOF, fwd.forward().status);
+}
+
+TEST_F(SukatForwarderTest, SukatForwarderTestSendfile)
+{
+  using forwardStatus = Sukat::Forwarder::forwardStatus;
+  FILE *file = ::tmpfile();
+  std::string data(100000, '\0');
+  size_t i;
+
+  ASSERT_NE(nullptr, file);
+  for (i = 0; i < data.length(); i++)
+    {
+      data[i] = static_cast<char>(i % 251);
+    }
+  ASSERT_EQ(data.length(), ::fwrite(data.c_str(), 1, data.length(), file));
+  ASSERT_EQ(0, ::fflush(file));
+  ::rewind(file);
+
+  Sukat::Forwarder fwd(::fileno(file), dst[0]);
+  std::string received;
+  Sukat::Forwarder::forwardResult res;
+
+  // Budget limited calls leave the file readable for the next one.
+  res = fwd.forward(1000);
+  EXPECT_EQ(forwardStatus::FWD_IN_AGAIN, res.status);
+  EXPECT_EQ(1000, res.bytes);
+  do
+    {
+      res = fwd.forward();
+      received += drain(dst[1]);
+    }
+  while (res.status == forwardStatus::FWD_OUT_AGAIN);
+  EXPECT_EQ(forwardStatus::FWD_EOF, res.status);
+  received += drain(dst[1]);
+  EXPECT_EQ(data, received);
+  ::fclose(file);
+}
+
+TEST_F(SukatForwarderTest, SukatForwarderTestCopyFallback)
+{
+  // Eventfds can not be spliced from, so the forwarder has to copy.
+  int efd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  uint64_t value = 42;
+
+  ASSERT_NE(-1, efd);
+  ASSERT_EQ(sizeof(value), ::write(efd, &value, sizeof(value)));
+  {
+    Sukat::Forwarder fwd(efd, dst[0]);
+    auto res = fwd.forward();
+
+    EXPECT_EQ(Sukat::Forwarder::forwardStatus::FWD_IN_AGAIN, res.status);
+    EXPECT_EQ(sizeof(value), res.bytes);
+  }
+  value = 0;
+  EXPECT_EQ(sizeof(value), ::read(dst[1], &value, sizeof(value)));
+  EXPECT_EQ(42, value);
+  ::close(efd);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
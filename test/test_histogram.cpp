@@ -0,0 +1,95 @@
+#include "gtest/gtest.h"
+
+#include "histogram.hpp"
+
+class SukatHistogramTest : public ::testing::Test
+{
+ protected:
+  SukatHistogramTest()
+  {
+  }
+
+  virtual ~SukatHistogramTest()
+  {
+  }
+
+  virtual void SetUp()
+  {
+  }
+
+  virtual void TearDown()
+  {
+  }
+};
+
+TEST_F(SukatHistogramTest, SukatHistogramTestExact)
+{
+  Sukat::Histogram hist;
+  uint64_t i;
+
+  EXPECT_EQ(0, hist.percentile(50));
+  for (i = 1; i <= 100; i++)
+    {
+      hist.record(i);
+    }
+  EXPECT_EQ(100, hist.count());
+  EXPECT_EQ(1, hist.min());
+  EXPECT_EQ(100, hist.max());
+  EXPECT_DOUBLE_EQ(50.5, hist.mean());
+  // Small values are counted exactly.
+  EXPECT_EQ(50, hist.percentile(50));
+  EXPECT_EQ(99, hist.percentile(99));
+  EXPECT_EQ(100, hist.percentile(100));
+  EXPECT_EQ(1, hist.percentile(0));
+}
+
+TEST_F(SukatHistogramTest, SukatHistogramTestRelativeError)
+{
+  Sukat::Histogram hist;
+  const uint64_t n = 1000000;
+  uint64_t i;
+
+  // Microseconds to seconds in ns.
+  for (i = 1; i <= n; i++)
+    {
+      hist.record(i * 1000);
+    }
+  for (double p : {10.0, 50.0, 90.0, 99.0, 99.9})
+    {
+      const double expect = p / 100 * n * 1000;
+
+      EXPECT_NEAR(expect, hist.percentile(p), expect / 100) << p;
+      EXPECT_GE(hist.percentile(p), expect) << p;
+    }
+  EXPECT_EQ(n * 1000, hist.percentile(100));
+
+  hist.record(UINT64_MAX);
+  EXPECT_EQ(UINT64_MAX, hist.max());
+  EXPECT_EQ(UINT64_MAX, hist.percentile(100));
+}
+
+TEST_F(SukatHistogramTest, SukatHistogramTestMerge)
+{
+  Sukat::Histogram a, b, coarse(4);
+
+  a.record(10, 3);
+  b.record(1000000);
+  a.merge(b);
+  EXPECT_EQ(4, a.count());
+  EXPECT_EQ(10, a.min());
+  EXPECT_EQ(1000000, a.max());
+  EXPECT_EQ(10, a.percentile(75));
+  EXPECT_EQ(1000000, a.percentile(100));
+  EXPECT_THROW(a.merge(coarse), std::invalid_argument);
+
+  a.reset();
+  EXPECT_EQ(0, a.count());
+  EXPECT_EQ(0, a.min());
+  EXPECT_EQ(0, a.max());
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,100 @@
+#include <atomic>
+#include <chrono>
+
+#include "gtest/gtest.h"
+
+#include "epoll.hpp"
+#include "listenergroup.hpp"
+
+class SukatListenerGroupTest : public ::testing::Test
+{
+ protected:
+  SukatListenerGroupTest()
+  {
+  }
+
+  virtual ~SukatListenerGroupTest()
+  {
+  }
+
+  virtual void SetUp()
+  {
+  }
+
+  virtual void TearDown()
+  {
+  }
+};
+
+TEST_F(SukatListenerGroupTest, SukatListenerGroupTestStream)
+{
+  Sukat::AddrInfo addrinfo("localhost", {}, AF_INET, SOCK_STREAM);
+  Sukat::ListenerGroup group(
+    Sukat::Socket::make_endpoint(addrinfo.mResults[0]), SOCK_STREAM, 4);
+  std::atomic<unsigned int> accepted{0};
+  std::vector<Sukat::SocketConnection> clients;
+  const unsigned int n_clients = 12;
+  unsigned int i;
+
+  EXPECT_EQ(4, group.size());
+  for (i = 1; i < group.size(); i++)
+    {
+      auto ep = group.listener(i).getSource();
+
+      ASSERT_TRUE(ep);
+      EXPECT_EQ(Sukat::Socket::endpoint_to_string(group.endpoint()),
+                Sukat::Socket::endpoint_to_string(ep.value()));
+    }
+
+  group.run([&](Sukat::SocketListener &listener, unsigned int,
+                std::stop_token stop) {
+    Sukat::Epoll ep;
+    std::vector<Sukat::SocketConnection> conns;
+
+    if (!ep.ctl(listener.fd()))
+      {
+        return;
+      }
+    while (!stop.stop_requested())
+      {
+        ep.wait(
+          [&](const struct epoll_event &) -> std::optional<int> {
+            accepted += listener.accept(
+              [&](Sukat::SocketConnection &&conn, std::vector<uint8_t> &) {
+                conns.emplace_back(std::move(conn));
+              });
+            return {};
+          },
+          10);
+      }
+  });
+
+  for (i = 0; i < n_clients; i++)
+    {
+      clients.emplace_back(SOCK_STREAM, group.endpoint());
+    }
+  for (i = 0; i < 200 && accepted < n_clients; i++)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  group.stop();
+  EXPECT_EQ(n_clients, accepted);
+}
+
+TEST_F(SukatListenerGroupTest, SukatListenerGroupTestUdp)
+{
+  Sukat::ListenerGroup group(Sukat::Socket::make_endpoint(AF_INET6),
+                             SOCK_DGRAM, 2, false);
+
+  EXPECT_EQ(2, group.size());
+  EXPECT_EQ(Sukat::Socket::endpoint_to_string(group.endpoint()),
+            Sukat::Socket::endpoint_to_string(
+              group.listener(1).getSource().value()));
+}
+
+int main(int argc, char **argv)
+{
+  Sukat::Logger::initialize(Sukat::Logger::LogLevel::ERROR);
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
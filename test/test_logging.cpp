@@ -0,0 +1,106 @@
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "logging.hpp"
+
+using namespace Sukat;
+
+class SukatLoggingTest : public ::testing::Test
+{
+ protected:
+  SukatLoggingTest()
+  {
+  }
+
+  virtual ~SukatLoggingTest()
+  {
+  }
+
+  virtual void SetUp()
+  {
+  }
+
+  virtual void TearDown()
+  {
+  }
+
+  static constexpr const char *logfile = "/tmp/sukat_test_logging.log";
+};
+
+TEST_F(SukatLoggingTest, SukatLoggingTestAsync)
+{
+  const unsigned int n_threads = 4, n_lines = 5000;
+  std::vector<std::jthread> threads;
+  unsigned int i;
+
+  // A small ring wraps often and makes callers wait on the writer.
+  Logger::initializeAsync(Logger::LogLevel::INFORMATIONAL, logfile,
+                          Logger::overflowPolicy::OVERFLOW_BLOCK, 1024);
+  for (i = 0; i < n_threads; i++)
+    {
+      threads.emplace_back([i]() {
+        unsigned int j;
+
+        for (j = 0; j < n_lines; j++)
+          {
+            LOG_INF("thread ", i, " line ", j);
+            LOG_DBG("filtered ", j);
+          }
+      });
+    }
+  threads.clear();
+  Logger::flush();
+  EXPECT_EQ(0, Logger::dropped());
+
+  std::ifstream in(logfile);
+  std::map<unsigned int, unsigned int> next;
+  std::string line;
+  unsigned int lines = 0;
+
+  while (std::getline(in, line))
+    {
+      std::istringstream fields(line.substr(line.find("): ") + 3));
+      std::string word;
+      unsigned int thread, seq;
+
+      fields >> word >> thread >> word >> seq;
+      // Lines of one thread stay in order.
+      EXPECT_EQ(next[thread], seq);
+      next[thread] = seq + 1;
+      lines++;
+    }
+  EXPECT_EQ(n_threads * n_lines, lines);
+  ::unlink(logfile);
+}
+
+TEST_F(SukatLoggingTest, SukatLoggingTestLazyArguments)
+{
+  unsigned int evaluated = 0;
+  auto count = [&]() { return ++evaluated; };
+
+  Logger::initializeAsync(Logger::LogLevel::INFORMATIONAL, logfile);
+  Logger::setLevel(Logger::LogLevel::ERROR);
+  EXPECT_FALSE(Logger::enabled(Logger::LogLevel::INFORMATIONAL));
+  LOG_INF("Not evaluated ", count());
+  EXPECT_EQ(0, evaluated);
+
+  Logger::setLevel(Logger::LogLevel::DEBUG);
+  LOG_INF("Evaluated ", count());
+  EXPECT_EQ(1, evaluated);
+  LOG_DBG("Evaluated if compiled in ", count());
+  EXPECT_EQ((SUKAT_LOG_COMPILED_LEVEL >= 2) ? 2 : 1, evaluated);
+  Logger::flush();
+  Logger::setLevel(Logger::LogLevel::INFORMATIONAL);
+  ::unlink(logfile);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
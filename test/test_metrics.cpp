@@ -0,0 +1,233 @@
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <thread>
+
+#include "buffer.hpp"
+#include "metrics.hpp"
+
+class SukatMetricsTest : public ::testing::Test
+{
+ protected:
+  SukatMetricsTest()
+  {
+  }
+
+  virtual ~SukatMetricsTest()
+  {
+  }
+
+  virtual void SetUp()
+  {
+    Sukat::Metrics::enable();
+  }
+
+  virtual void TearDown()
+  {
+    Sukat::Metrics::enable(false);
+  }
+
+  using counter = Sukat::Metrics::counter;
+
+  static uint64_t delta(const Sukat::Metrics::snapshot &before, counter c)
+  {
+    return Sukat::Metrics::collect()[c] - before[c];
+  }
+};
+
+TEST_F(SukatMetricsTest, SukatMetricsTestDisabled)
+{
+  Sukat::Metrics::enable(false);
+
+  const auto before = Sukat::Metrics::collect();
+  Sukat::SocketListenerStream listener;
+  Sukat::SocketConnection client(SOCK_STREAM, listener.getSource().value());
+  auto clients = listener.accept();
+
+  ASSERT_EQ(1, clients.size());
+  EXPECT_TRUE(client.ready(100));
+  EXPECT_EQ(5, client.write("hello"));
+  EXPECT_EQ(0, delta(before, counter::COUNTER_ACCEPTS));
+  EXPECT_EQ(0, delta(before, counter::COUNTER_BYTES_OUT));
+  EXPECT_EQ(0, client.stats().writes);
+}
+
+TEST_F(SukatMetricsTest, SukatMetricsTestTraffic)
+{
+  const auto before = Sukat::Metrics::collect();
+  Sukat::SocketListenerStream listener;
+  Sukat::SocketConnection client(SOCK_STREAM, listener.getSource().value());
+  auto clients = listener.accept();
+  Sukat::Buffer buf(64);
+
+  ASSERT_EQ(1, clients.size());
+  EXPECT_TRUE(client.ready(100));
+  EXPECT_EQ(0, client.polloutReady());
+  EXPECT_EQ(1, delta(before, counter::COUNTER_ACCEPTS));
+  EXPECT_EQ(1, delta(before, counter::COUNTER_CONNECTS));
+
+  EXPECT_EQ(5, client.write("hello"));
+  EXPECT_EQ(5, clients[0].read(buf).bytes);
+  EXPECT_EQ(5, delta(before, counter::COUNTER_BYTES_OUT));
+  EXPECT_EQ(5, delta(before, counter::COUNTER_BYTES_IN));
+  EXPECT_EQ(1, delta(before, counter::COUNTER_WRITES));
+  // Data, then EAGAIN.
+  EXPECT_EQ(2, delta(before, counter::COUNTER_READS));
+  EXPECT_EQ(1, delta(before, counter::COUNTER_WOULD_BLOCK));
+
+  EXPECT_EQ(5, client.stats().bytesOut);
+  EXPECT_EQ(1, client.stats().writes);
+  EXPECT_EQ(5, clients[0].stats().bytesIn);
+  EXPECT_EQ(1, clients[0].stats().wouldBlock);
+  EXPECT_EQ(0, clients[0].stats().bytesOut);
+}
+
+TEST_F(SukatMetricsTest, SukatMetricsTestDenied)
+{
+  const auto before = Sukat::Metrics::collect();
+  Sukat::SocketListenerStream listener;
+  Sukat::SocketConnection client(SOCK_STREAM, listener.getSource().value());
+
+  EXPECT_TRUE(client.ready(100));
+  EXPECT_EQ(0, listener
+                 .accept([](const Sukat::Socket::endpoint &,
+                            std::vector<uint8_t> &) {
+                   return Sukat::SocketListener::accessReturn::ACCESS_DENY;
+                 })
+                 .size());
+  EXPECT_EQ(1, delta(before, counter::COUNTER_DENIED));
+  EXPECT_EQ(0, delta(before, counter::COUNTER_ACCEPTS));
+}
+
+TEST_F(SukatMetricsTest, SukatMetricsTestConnectLatency)
+{
+  const auto before = Sukat::Metrics::collect();
+  Sukat::SocketListenerStream listener;
+  Sukat::SocketConnection client(SOCK_STREAM, listener.getSource().value());
+  const auto &dist = [&]() {
+    return Sukat::Metrics::collect().histograms[static_cast<size_t>(
+      Sukat::Metrics::histogram::HISTOGRAM_CONNECT_LATENCY)];
+  };
+  const auto count = dist().count;
+
+  EXPECT_TRUE(client.ready(100));
+  EXPECT_EQ(0, client.polloutReady());
+  if (client.connComplete())
+    {
+      GTEST_SKIP() << "Connected without a handshake to time";
+    }
+  EXPECT_EQ(count + 1, dist().count);
+  // Timed once per connect.
+  EXPECT_EQ(0, client.polloutReady());
+  EXPECT_EQ(count + 1, dist().count);
+  EXPECT_EQ(0, delta(before, counter::COUNTER_CONNECT_FAILURES));
+}
+
+TEST_F(SukatMetricsTest, SukatMetricsTestThreads)
+{
+  const auto before = Sukat::Metrics::collect();
+  std::vector<std::jthread> threads;
+  int i;
+
+  for (i = 0; i < 4; i++)
+    {
+      threads.emplace_back([]() {
+        int j;
+
+        for (j = 0; j < 1000; j++)
+          {
+            Sukat::Metrics::add(counter::COUNTER_PARTIAL_WRITES);
+          }
+      });
+    }
+  threads.clear();
+  // Exited threads' counts are kept.
+  EXPECT_EQ(4000, delta(before, counter::COUNTER_PARTIAL_WRITES));
+}
+
+TEST_F(SukatMetricsTest, SukatMetricsTestExporter)
+{
+  Sukat::Reactor reactor;
+  std::filesystem::path path("sukat_metrics_test");
+  Sukat::MetricsExporter exporter(reactor, path, true);
+  Sukat::SocketConnection scraper(path, true);
+  std::string response;
+  int i;
+
+  Sukat::Metrics::add(counter::COUNTER_ACCEPTS);
+  EXPECT_EQ(0, scraper.polloutReady());
+  EXPECT_GT(scraper.write("GET /metrics HTTP/1.0\r\n\r\n"), 0);
+  for (i = 0; i < 100 && !exporter.served(); i++)
+    {
+      reactor.poll(10);
+    }
+  EXPECT_EQ(1, exporter.served());
+  for (i = 0; i < 100; i++)
+    {
+      Sukat::Buffer buf(65536);
+      auto res = scraper.read(buf);
+
+      response += buf.view();
+      if (res.status == Sukat::SocketConnection::readStatus::READ_EOF)
+        {
+          break;
+        }
+      reactor.poll(10);
+    }
+  EXPECT_EQ(0, response.find("HTTP/1.0 200 OK\r\n"));
+  EXPECT_NE(std::string::npos,
+            response.find("# TYPE sukat_accepts_total counter\n"));
+  EXPECT_NE(std::string::npos,
+            response.find(
+              "sukat_connect_duration_seconds_bucket{le=\"+Inf\"}"));
+}
+
+TEST_F(SukatMetricsTest, SukatMetricsTestExporterTimeout)
+{
+  Sukat::Reactor reactor;
+  std::filesystem::path path("sukat_metrics_timeout_test");
+  Sukat::MetricsExporter exporter(reactor, path, true,
+                                  std::chrono::milliseconds(50));
+  Sukat::SocketConnection stalled(path, true);
+  Sukat::Buffer buf;
+  bool closed = false;
+  int i;
+
+  // Never finishes its request, so is closed unanswered.
+  EXPECT_EQ(0, stalled.polloutReady());
+  EXPECT_GT(stalled.write("GET /metrics"), 0);
+  for (i = 0; i < 100 && !closed; i++)
+    {
+      reactor.poll(10);
+      closed = stalled.read(buf).status ==
+               Sukat::SocketConnection::readStatus::READ_EOF;
+    }
+  EXPECT_TRUE(closed);
+  EXPECT_TRUE(buf.empty());
+  EXPECT_EQ(0, exporter.served());
+}
+
+TEST_F(SukatMetricsTest, SukatMetricsTestExporterPath)
+{
+  Sukat::Reactor reactor;
+  std::filesystem::path path("/tmp/sukat_metrics_test");
+
+  std::ofstream(path) << "keep";
+  EXPECT_THROW(Sukat::MetricsExporter(reactor, path), std::system_error);
+  EXPECT_TRUE(std::filesystem::is_regular_file(path));
+  std::filesystem::remove(path);
+
+  // A stale socket is replaced, and removed again on exit.
+  {
+    Sukat::SocketListenerStream stale(
+      Sukat::Socket::make_endpoint(path, false));
+  }
+  EXPECT_TRUE(std::filesystem::is_socket(path));
+  {
+    Sukat::MetricsExporter exporter(reactor, path);
+    Sukat::SocketConnection scraper(path, false);
+
+    EXPECT_EQ(0, scraper.polloutReady());
+  }
+  EXPECT_FALSE(std::filesystem::exists(path));
+}
@@ -0,0 +1,121 @@
+#include "gtest/gtest.h"
+
+#include "registry.hpp"
+
+class SukatRegistryTest : public ::testing::Test
+{
+ protected:
+  SukatRegistryTest()
+  {
+  }
+
+  virtual ~SukatRegistryTest()
+  {
+  }
+
+  virtual void SetUp()
+  {
+  }
+
+  virtual void TearDown()
+  {
+  }
+};
+
+struct Tracked
+{
+  Tracked(int value, int &alive) : value(value), alive(alive)
+  {
+    alive++;
+  }
+  ~Tracked()
+  {
+    alive--;
+  }
+  Tracked(const Tracked &) = delete;
+
+  int value;
+  int &alive;
+};
+
+TEST_F(SukatRegistryTest, SukatRegistryTestGeneration)
+{
+  Sukat::Registry<Tracked> registry;
+  int alive = 0;
+
+  auto first = registry.emplace(3, 30, alive);
+  ASSERT_TRUE(first);
+  EXPECT_FALSE(registry.emplace(3, 31, alive));
+  EXPECT_FALSE(registry.emplace(-1, 0, alive));
+  EXPECT_EQ(1, alive);
+
+  Tracked *obj = registry.find(3);
+  ASSERT_NE(nullptr, obj);
+  EXPECT_EQ(30, obj->value);
+  EXPECT_EQ(obj, registry.find(first.value()));
+  EXPECT_EQ(nullptr, registry.find(4));
+  EXPECT_EQ(nullptr, registry.find(100000));
+
+  // fd reused after close: the old handle no longer resolves.
+  EXPECT_TRUE(registry.erase(3));
+  EXPECT_EQ(0, alive);
+  auto second = registry.emplace(3, 32, alive);
+  ASSERT_TRUE(second);
+  EXPECT_EQ(nullptr, registry.find(first.value()));
+  EXPECT_FALSE(registry.erase(first.value()));
+  EXPECT_EQ(32, registry.find(second.value())->value);
+  EXPECT_EQ(1, registry.size());
+}
+
+TEST_F(SukatRegistryTest, SukatRegistryTestStableAddresses)
+{
+  Sukat::Registry<Tracked> registry;
+  int alive = 0, sum = 0;
+
+  ASSERT_TRUE(registry.emplace(1, 1, alive));
+  Tracked *low = registry.find(1);
+  // Far enough to need new chunks.
+  ASSERT_TRUE(registry.emplace(5000, 2, alive));
+  ASSERT_TRUE(registry.emplace(700, 3, alive));
+  EXPECT_EQ(low, registry.find(1));
+  EXPECT_EQ(3, registry.size());
+
+  registry.forEach([&](Tracked &obj) { sum = sum * 10 + obj.value; });
+  EXPECT_EQ(132, sum);
+
+  registry.clear();
+  EXPECT_TRUE(registry.empty());
+  EXPECT_EQ(0, alive);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+TEST_F(SukatRegistryTest, SukatRegistryTestForEachFrom)
+{
+  Sukat::Registry<Tracked> registry;
+  std::vector<int> seen;
+  int alive = 0, next;
+
+  for (int fd : {1, 5, 300, 301, 1000})
+    {
+      EXPECT_TRUE(registry.emplace(fd, fd, alive));
+    }
+
+  auto visit = [&](Tracked &t) { seen.push_back(t.value); };
+
+  next = registry.forEachFrom(0, 2, visit);
+  EXPECT_EQ(300, next);
+  next = registry.forEachFrom(next, 2, visit);
+  EXPECT_EQ(1000, next);
+  next = registry.forEachFrom(next, 2, visit);
+  EXPECT_EQ(-1, next);
+  EXPECT_EQ((std::vector<int>{1, 5, 300, 301, 1000}), seen);
+
+  // Nothing past the last occupant.
+  EXPECT_EQ(-1, registry.forEachFrom(1001, 2, visit));
+  EXPECT_EQ(5, seen.size());
+}
@@ -0,0 +1,105 @@
+#include "gtest/gtest.h"
+
+#include "resolver.hpp"
+
+class SukatResolverTest : public ::testing::Test
+{
+ protected:
+  SukatResolverTest()
+  {
+  }
+
+  virtual ~SukatResolverTest()
+  {
+  }
+
+  virtual void SetUp()
+  {
+    ASSERT_TRUE(reactor.add(resolver.fd(), resolver));
+  }
+
+  virtual void TearDown()
+  {
+  }
+
+  /** @brief Run the reactor until all lookups finished */
+  void wait()
+  {
+    unsigned int rounds = 0;
+
+    while (resolver.pending() && rounds++ < 100)
+      {
+        reactor.poll(100);
+      }
+  }
+
+  Sukat::Resolver resolver{2};
+  Sukat::Reactor reactor;
+};
+
+TEST_F(SukatResolverTest, SukatResolverTestCache)
+{
+  unsigned int calls = 0;
+  Sukat::Resolver::result last;
+  auto cb = [&](const Sukat::Resolver::result &res) {
+    calls++;
+    last = res;
+  };
+
+  resolver.resolve("127.0.0.1", "80", cb);
+  // Joins the lookup in flight.
+  resolver.resolve("127.0.0.1", "80", cb);
+  EXPECT_EQ(0, calls);
+  EXPECT_EQ(1, resolver.pending());
+  wait();
+  EXPECT_EQ(2, calls);
+  EXPECT_EQ(0, last.error);
+  EXPECT_FALSE(last.cached);
+  ASSERT_EQ(1, last.endpoints.size());
+  EXPECT_EQ(AF_INET, last.endpoints[0].first.ss_family);
+
+  resolver.resolve("127.0.0.1", "80", cb);
+  EXPECT_EQ(3, calls);
+  EXPECT_TRUE(last.cached);
+  EXPECT_EQ(0, resolver.pending());
+
+  // A different service is a different lookup.
+  resolver.resolve("127.0.0.1", "81", cb);
+  EXPECT_EQ(1, resolver.pending());
+  wait();
+  EXPECT_EQ(4, calls);
+
+  resolver.flush();
+  resolver.resolve("127.0.0.1", "80", cb);
+  EXPECT_EQ(1, resolver.pending());
+  wait();
+  EXPECT_FALSE(last.cached);
+}
+
+TEST_F(SukatResolverTest, SukatResolverTestError)
+{
+  Sukat::Resolver::result last{};
+  unsigned int calls = 0;
+  auto cb = [&](const Sukat::Resolver::result &res) {
+    calls++;
+    last = res;
+  };
+
+  resolver.resolve("127.0.0.1", "no-such-service-sukat", cb);
+  wait();
+  EXPECT_EQ(1, calls);
+  EXPECT_NE(0, last.error);
+  EXPECT_TRUE(last.endpoints.empty());
+
+  // Failures are cached too.
+  resolver.resolve("127.0.0.1", "no-such-service-sukat", cb);
+  EXPECT_EQ(2, calls);
+  EXPECT_TRUE(last.cached);
+  EXPECT_NE(0, last.error);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,133 @@
+#include "gtest/gtest.h"
+
+#include "sampler.hpp"
+
+extern "C"
+{
+#include <netinet/tcp.h>
+}
+
+class SukatSamplerTest : public ::testing::Test
+{
+ protected:
+  SukatSamplerTest()
+  {
+  }
+
+  virtual ~SukatSamplerTest()
+  {
+  }
+
+  virtual void SetUp()
+  {
+  }
+
+  virtual void TearDown()
+  {
+  }
+};
+
+TEST_F(SukatSamplerTest, SukatSamplerTestTcp)
+{
+  Sukat::SocketListenerStream listener;
+  Sukat::SocketConnection client(SOCK_STREAM, listener.getSource().value());
+  auto clients = listener.accept();
+  const std::string data(1000, 'x');
+
+  ASSERT_EQ(1, clients.size());
+  EXPECT_TRUE(client.ready(100));
+  EXPECT_EQ(data.size(), client.write(data));
+
+  // Unread on the server side.
+  auto server = clients[0].sample();
+
+  EXPECT_EQ(Sukat::SocketSample::SAMPLE_ALL, server.valid);
+  EXPECT_EQ(data.size(), server.inq);
+  EXPECT_EQ(TCP_ESTABLISHED, server.state);
+  EXPECT_EQ(data.size(), server.bytesReceived);
+  EXPECT_GT(server.rcvbuf, 0);
+  EXPECT_GT(server.rmemAlloc, 0);
+
+  auto sender = client.sample(Sukat::SocketSample::SAMPLE_TCP_INFO);
+
+  EXPECT_EQ(Sukat::SocketSample::SAMPLE_TCP_INFO, sender.valid);
+  EXPECT_GT(sender.cwnd, 0);
+  EXPECT_GT(sender.mss, 0);
+  EXPECT_EQ(0, sender.retransmits);
+  // Not asked for.
+  EXPECT_EQ(0, sender.sndbuf);
+}
+
+TEST_F(SukatSamplerTest, SukatSamplerTestUdp)
+{
+  Sukat::SocketListenerUdp listener(AF_INET);
+  Sukat::SocketConnection client(SOCK_DGRAM, listener.getSource().value());
+
+  EXPECT_EQ(5, client.write("hello"));
+
+  auto sample = listener.sample();
+
+  EXPECT_FALSE(sample.valid & Sukat::SocketSample::SAMPLE_TCP_INFO);
+  EXPECT_TRUE(sample.valid & Sukat::SocketSample::SAMPLE_QUEUES);
+  EXPECT_TRUE(sample.valid & Sukat::SocketSample::SAMPLE_MEMINFO);
+  // Size of the next datagram.
+  EXPECT_EQ(5, sample.inq);
+}
+
+TEST_F(SukatSamplerTest, SukatSamplerTestSchedule)
+{
+  Sukat::Reactor reactor;
+  Sukat::Registry<Sukat::SocketConnection> conns;
+  Sukat::SocketListenerStream listener;
+  std::vector<Sukat::SocketConnection> clients;
+  size_t samples = 0, passes = 0, inq = 0;
+  int i;
+
+  for (i = 0; i < 5; i++)
+    {
+      clients.emplace_back(SOCK_STREAM, listener.getSource().value());
+      EXPECT_TRUE(clients.back().ready(100));
+      EXPECT_EQ(1, clients.back().write("x"));
+    }
+  for (auto &conn : listener.accept())
+    {
+      const int fd = conn.fd();
+
+      EXPECT_TRUE(conns.emplace(fd, std::move(conn)));
+    }
+  ASSERT_EQ(5, conns.size());
+
+  Sukat::Sampler<Sukat::SocketConnection> sampler(
+    reactor, conns,
+    [&](Sukat::SocketConnection &, const Sukat::SocketSample &sample) {
+      samples++;
+      inq += sample.inq;
+    },
+    std::chrono::milliseconds(20), Sukat::SocketSample::SAMPLE_QUEUES);
+
+  sampler.setBatch(2);
+  sampler.setPassCb([&]() { passes++; });
+  sampler.start();
+  // Two connections per timer tick, the pass ends on the third.
+  reactor.poll(10);
+  EXPECT_EQ(2, samples);
+  reactor.poll(10);
+  reactor.poll(10);
+  EXPECT_EQ(5, samples);
+  EXPECT_EQ(1, passes);
+  EXPECT_EQ(5, inq);
+
+  // Next pass only after the interval.
+  reactor.poll(0);
+  EXPECT_EQ(5, samples);
+  for (i = 0; i < 100 && passes < 2; i++)
+    {
+      reactor.poll(10);
+    }
+  EXPECT_EQ(2, passes);
+  EXPECT_EQ(10, samples);
+
+  sampler.stop();
+  sampler.sampleAll();
+  EXPECT_EQ(15, samples);
+}
@@ -177,6 +177,405 @@ TEST_F(SukatSocketTest, SukatSocketTestUnix)
 
   auto data = conn.readData();
   EXPECT_EQ(data_reply, data.str());
+  EXPECT_EQ("(@./test_unix.socket)", Sukat::Socket::endpoint_to_string(
+                                        unix_listener.getSource().value()));
+}
+
+TEST_F(SukatSocketTest, SukatSocketTestUnixPath)
+{
+  std::filesystem::path path("./test_unix_path.socket");
+
+  std::filesystem::remove(path);
+  {
+    Sukat::SocketListenerStream unix_listener(
+      Sukat::Socket::make_endpoint(path));
+
+    EXPECT_TRUE(std::filesystem::exists(path));
+    EXPECT_EQ("(./test_unix_path.socket)",
+              Sukat::Socket::endpoint_to_string(
+                unix_listener.getSource().value()));
+
+    Sukat::SocketConnection conn(path, false);
+    EXPECT_EQ(1, unix_listener.accept().size());
+  }
+  std::filesystem::remove(path);
+}
+
+TEST_F(SukatSocketTest, SukatSocketTestReadBuffer)
+{
+  Sukat::SocketListenerStream tcp_listener;
+  auto saddr = tcp_listener.getSource();
+  ASSERT_TRUE(saddr);
+  auto client =
+    std::make_unique<Sukat::SocketConnection>(SOCK_STREAM, saddr.value());
+  auto clients = tcp_listener.accept();
+  ASSERT_EQ(1, clients.size());
+  EXPECT_TRUE(client->ready(10));
+
+  Sukat::Buffer buf(8);
+  std::string data = "0123456789ab";
+  using readStatus = Sukat::SocketConnection::readStatus;
+
+  auto res = clients[0].read(buf);
+  EXPECT_EQ(readStatus::READ_AGAIN, res.status);
+  EXPECT_EQ(0, res.bytes);
+
+  EXPECT_EQ(data.length(), client->write(data));
+  res = clients[0].read(buf);
+  EXPECT_EQ(readStatus::READ_FULL, res.status);
+  EXPECT_EQ(8, res.bytes);
+  EXPECT_EQ("01234567", buf.view());
+
+  buf.consume(6);
+  res = clients[0].read(buf);
+  EXPECT_EQ(readStatus::READ_AGAIN, res.status);
+  EXPECT_EQ(4, res.bytes);
+  EXPECT_EQ("6789ab", buf.view());
+  buf.consume(buf.size());
+  EXPECT_TRUE(buf.empty());
+
+  client.reset();
+  res = clients[0].read(buf);
+  EXPECT_EQ(readStatus::READ_EOF, res.status);
+}
+
+TEST_F(SukatSocketTest, SukatSocketTestWriteQueue)
+{
+  Sukat::SocketListenerStream tcp_listener;
+  auto saddr = tcp_listener.getSource();
+  ASSERT_TRUE(saddr);
+  Sukat::SocketConnection client(SOCK_STREAM, saddr.value());
+  auto clients = tcp_listener.accept();
+  ASSERT_EQ(1, clients.size());
+  EXPECT_TRUE(client.ready(10));
+
+  // More than loopback socket buffers take in one go.
+  const size_t total = 32 * 1024 * 1024, piece = 1000;
+  Sukat::WriteQueue queue(64 * 1024, 1024 * 1024);
+  std::string data(piece, '\0');
+  size_t pushed = 0, received = 0;
+  bool mismatch = false;
+  Sukat::Buffer buf(65536);
+
+  auto fill = [&]() {
+    while (pushed < total && !queue.blocked())
+      {
+        size_t i;
+
+        for (i = 0; i < piece; i++)
+          {
+            data[i] = static_cast<char>((pushed + i) % 251);
+          }
+        queue.push(data);
+        pushed += piece;
+      }
+  };
+
+  fill();
+  EXPECT_TRUE(queue.blocked());
+  EXPECT_EQ(pushed, queue.size());
+
+  while (received < total)
+    {
+      ASSERT_GE(client.write(queue), 0);
+      fill();
+      auto res = clients[0].read(buf);
+      ASSERT_NE(Sukat::SocketConnection::readStatus::READ_ERROR, res.status);
+      for (auto byte : buf.readable())
+        {
+          mismatch |= (byte != (received++ % 251));
+        }
+      buf.clear();
+    }
+  EXPECT_FALSE(mismatch);
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.blocked());
+  EXPECT_EQ(0, client.write(queue));
+}
+
+TEST_F(SukatSocketTest, SukatSocketTestWriteQueueZerocopy)
+{
+  Sukat::SocketListenerStream tcp_listener;
+  auto saddr = tcp_listener.getSource();
+  ASSERT_TRUE(saddr);
+  Sukat::SocketConnection client(SOCK_STREAM, saddr.value());
+  auto clients = tcp_listener.accept();
+  ASSERT_EQ(1, clients.size());
+  EXPECT_TRUE(client.ready(10));
+  if (!client.setZerocopy())
+    {
+      GTEST_SKIP() << "SO_ZEROCOPY not supported";
+    }
+
+  const size_t n_chunks = 8, chunk_size = 256 * 1024;
+  Sukat::WriteQueue queue;
+  size_t released = 0, received = 0, i;
+  bool mismatch = false;
+  Sukat::Buffer buf(65536);
+
+  queue.setZerocopy(true);
+  queue.setRelease([&](std::vector<uint8_t> &&chunk) {
+    EXPECT_TRUE(chunk.empty());
+    EXPECT_EQ(chunk_size, chunk.capacity());
+    released++;
+  });
+  for (i = 0; i < n_chunks; i++)
+    {
+      queue.push(std::vector<uint8_t>(chunk_size, static_cast<uint8_t>(i)));
+    }
+
+  while (received < n_chunks * chunk_size || released < n_chunks)
+    {
+      ASSERT_GE(client.write(queue), 0);
+      ASSERT_GE(client.reap(queue), 0);
+      if (!clients[0].ready(10))
+        {
+          continue;
+        }
+      auto res = clients[0].read(buf);
+      ASSERT_NE(Sukat::SocketConnection::readStatus::READ_ERROR, res.status);
+      for (auto byte : buf.readable())
+        {
+          mismatch |= (byte != received++ / chunk_size);
+        }
+      buf.clear();
+    }
+  EXPECT_FALSE(mismatch);
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(0, queue.pinned());
+}
+
+TEST_F(SukatSocketTest, SukatSocketTestUdpBatch)
+{
+  Sukat::SocketListenerUdp udp_listener;
+  auto saddr = udp_listener.getSource();
+  ASSERT_TRUE(saddr);
+  Sukat::SocketConnection client(SOCK_DGRAM, saddr.value());
+  Sukat::DatagramBatch batch(4, 64);
+  unsigned int n_msgs = 10, i, received = 0, batches = 0;
+
+  for (i = 0; i < n_msgs; i++)
+    {
+      std::string msg = "datagram " + std::to_string(i);
+      EXPECT_EQ(msg.length(), client.write(msg));
+    }
+
+  auto ret = udp_listener.receive(batch, [&](Sukat::DatagramBatch &batch) {
+    size_t j;
+
+    for (j = 0; j < batch.size(); j++)
+      {
+        auto data = batch.data(j);
+        std::string expected = "datagram " + std::to_string(received++);
+
+        EXPECT_EQ(expected, std::string(data.begin(), data.end()));
+        EXPECT_FALSE(batch.truncated(j));
+        EXPECT_EQ(batch.sender(j).second, client.getSource().value().second);
+      }
+    batches++;
+  });
+  EXPECT_EQ(n_msgs, ret);
+  EXPECT_EQ(n_msgs, received);
+  EXPECT_EQ(3, batches);
+}
+
+TEST_F(SukatSocketTest, SukatSocketTestUdpBatchPooled)
+{
+  Sukat::BufferPool pool(300, 4);
+  Sukat::SocketListenerUdp udp_listener;
+  auto saddr = udp_listener.getSource();
+  ASSERT_TRUE(saddr);
+  Sukat::SocketConnection client(SOCK_DGRAM, saddr.value());
+  std::vector<std::string> received;
+
+  EXPECT_THROW(Sukat::DatagramBatch(4, 301, pool), std::invalid_argument);
+  {
+    // Three 100 byte buffers per slab, last one truncates.
+    Sukat::DatagramBatch batch(5, 100, pool);
+
+    EXPECT_EQ(2, pool.allocated() - pool.available());
+    EXPECT_EQ(5, client.write("short"));
+    EXPECT_EQ(150, client.write(std::string(150, 'x')));
+    EXPECT_EQ(2, udp_listener.receive(batch, [&](Sukat::DatagramBatch &batch) {
+      size_t j;
+
+      for (j = 0; j < batch.size(); j++)
+        {
+          auto data = batch.data(j);
+          received.emplace_back(data.begin(), data.end());
+        }
+      EXPECT_FALSE(batch.truncated(0));
+      EXPECT_TRUE(batch.truncated(1));
+    }));
+  }
+  ASSERT_EQ(2, received.size());
+  EXPECT_EQ("short", received[0]);
+  EXPECT_EQ(std::string(100, 'x'), received[1]);
+  EXPECT_EQ(pool.allocated(), pool.available());
+}
+
+TEST_F(SukatSocketTest, SukatSocketTestUdpQueue)
+{
+  Sukat::SocketListenerUdp udp_listener;
+  auto saddr = udp_listener.getSource();
+  ASSERT_TRUE(saddr);
+  Sukat::SocketConnection client(SOCK_DGRAM, saddr.value());
+  Sukat::DatagramQueue queue(16);
+  Sukat::DatagramBatch batch(16, 64);
+  std::vector<std::string> received;
+  auto collect = [&](Sukat::DatagramBatch &batch) {
+    size_t j;
+
+    for (j = 0; j < batch.size(); j++)
+      {
+        auto data = batch.data(j);
+        received.emplace_back(data.begin(), data.end());
+      }
+  };
+  unsigned int i;
+
+  for (i = 0; i < 10; i++)
+    {
+      EXPECT_TRUE(queue.push("msg " + std::to_string(i)));
+    }
+  EXPECT_EQ(10, client.write(queue));
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(10, udp_listener.receive(batch, collect));
+  ASSERT_EQ(10, received.size());
+  EXPECT_EQ("msg 9", received[9]);
+
+  // Same destination and length, last shorter: one GSO burst.
+  received.clear();
+  queue.setSegmentation(true);
+  for (i = 0; i < 5; i++)
+    {
+      EXPECT_TRUE(queue.push("segment " + std::to_string(i), saddr));
+    }
+  EXPECT_TRUE(queue.push("last", saddr));
+  EXPECT_EQ(6, client.write(queue));
+  EXPECT_EQ(6, udp_listener.receive(batch, collect));
+  ASSERT_EQ(6, received.size());
+  EXPECT_EQ("segment 4", received[4]);
+  EXPECT_EQ("last", received[5]);
+
+  // Empty datagrams have no segment length to burst with.
+  received.clear();
+  EXPECT_TRUE(queue.push("", saddr));
+  EXPECT_TRUE(queue.push("", saddr));
+  EXPECT_EQ(2, client.write(queue));
+  EXPECT_EQ(2, udp_listener.receive(batch, collect));
+  ASSERT_EQ(2, received.size());
+  EXPECT_EQ("", received[1]);
+
+  // Too large for any UDP datagram, let alone a segment.
+  for (const size_t len : {size_t{65528}, size_t{65536}})
+    {
+      Sukat::DatagramQueue big(2, 2 * len);
+      const std::string payload(len, 'x');
+
+      big.setSegmentation(true);
+      EXPECT_TRUE(big.push(payload, saddr));
+      EXPECT_TRUE(big.push(payload, saddr));
+      EXPECT_EQ(-1, client.write(big));
+      EXPECT_EQ(EMSGSIZE, errno);
+      EXPECT_EQ(2, big.size());
+    }
+
+  Sukat::DatagramQueue small(2, 8);
+  EXPECT_TRUE(small.push("1234"));
+  EXPECT_FALSE(small.push("123456789"));
+  EXPECT_TRUE(small.push("5678"));
+  EXPECT_FALSE(small.push("9"));
+}
+
+TEST_F(SukatSocketTest, SukatSocketTestUdpDemux)
+{
+  Sukat::SocketListenerUdpDemux demux;
+  auto saddr = demux.getSource();
+  ASSERT_TRUE(saddr);
+  std::vector<Sukat::SocketConnection> clients;
+  std::vector<Sukat::Socket::endpoint> peers;
+  unsigned int n_clients = 4, i, new_peers = 0, data_msgs = 0, denied = 0;
+
+  for (i = 0; i < n_clients; i++)
+    {
+      clients.emplace_back(SOCK_DGRAM, saddr.value());
+      clients.back().write("hello");
+      clients.back().write("data");
+    }
+
+  auto on_new = [&](Sukat::UdpPeer &peer, std::span<uint8_t> data) {
+    EXPECT_EQ("hello", std::string(data.begin(), data.end()));
+    peer.write("welcome");
+    peers.push_back(peer.peer());
+    new_peers++;
+  };
+  auto on_data = [&](Sukat::UdpPeer &peer, std::span<uint8_t> data) {
+    EXPECT_EQ("data", std::string(data.begin(), data.end()));
+    EXPECT_NE(nullptr, demux.find(peer.peer()));
+    data_msgs++;
+  };
+  auto ret = demux.process(on_new, on_data);
+  EXPECT_EQ(2 * n_clients, ret);
+  EXPECT_EQ(n_clients, new_peers);
+  EXPECT_EQ(n_clients, data_msgs);
+  EXPECT_EQ(n_clients, demux.size());
+
+  for (auto &client : clients)
+    {
+      EXPECT_EQ("welcome", client.readData().str());
+    }
+
+  // Forgotten peers go through access control again.
+  for (const auto &peer : peers)
+    {
+      EXPECT_TRUE(demux.remove(peer));
+    }
+  EXPECT_EQ(0, demux.size());
+  clients[0].write("hello");
+  ret = demux.process(on_new, on_data,
+                      [&](const Sukat::Socket::endpoint &,
+                          std::vector<uint8_t> &data) {
+                        EXPECT_EQ("hello",
+                                  std::string(data.begin(), data.end()));
+                        denied++;
+                        return Sukat::SocketListener::accessReturn::ACCESS_DENY;
+                      });
+  EXPECT_EQ(1, ret);
+  EXPECT_EQ(1, denied);
+  EXPECT_EQ(n_clients, new_peers);
+}
+
+TEST_F(SukatSocketTest, SukatSocketTestAcceptBudget)
+{
+  Sukat::SocketListenerStream tcp_listener(AF_INET6, {}, SOCK_STREAM, 64);
+  auto saddr = tcp_listener.getSource();
+  ASSERT_TRUE(saddr);
+  std::vector<Sukat::SocketConnection> connections;
+  unsigned int i;
+
+  EXPECT_GT(Sukat::SocketListenerStream::somaxconn(), 0);
+  for (i = 0; i < 8; i++)
+    {
+      connections.emplace_back(SOCK_STREAM, saddr.value());
+    }
+
+  auto clients = tcp_listener.accept(nullptr, 3);
+  EXPECT_EQ(3, clients.size());
+  EXPECT_EQ(1, tcp_listener.stats().overflowed);
+
+  clients = tcp_listener.accept(
+    [](const Sukat::Socket::endpoint &, std::vector<uint8_t> &) {
+      return Sukat::SocketListener::accessReturn::ACCESS_DENY;
+    });
+  EXPECT_EQ(0, clients.size());
+  EXPECT_EQ(1, tcp_listener.stats().denied);
+
+  // Budget used up exactly, but nobody left waiting.
+  clients = tcp_listener.accept(nullptr, 4);
+  EXPECT_EQ(4, clients.size());
+  EXPECT_EQ(7, tcp_listener.stats().accepted);
+  EXPECT_EQ(1, tcp_listener.stats().overflowed);
 }
 
 int main(int argc, char **argv)
@@ -0,0 +1,208 @@
+#include "gtest/gtest.h"
+
+#include "epoll.hpp"
+#include "timerwheel.hpp"
+
+using namespace std::chrono_literals;
+
+class SukatTimerWheelTest : public ::testing::Test
+{
+ protected:
+  SukatTimerWheelTest()
+  {
+  }
+
+  virtual ~SukatTimerWheelTest()
+  {
+  }
+
+  virtual void SetUp()
+  {
+  }
+
+  virtual void TearDown()
+  {
+  }
+
+  /** @brief Advance \p wheel in 1ms steps up to \p until from now */
+  static size_t step(Sukat::TimerWheel &wheel,
+                     Sukat::TimerWheel::clock::time_point from,
+                     std::chrono::milliseconds until)
+  {
+    size_t fired = 0;
+    std::chrono::milliseconds t;
+
+    for (t = 0ms; t <= until; t += 1ms)
+      {
+        fired += wheel.advance(from + t);
+      }
+    return fired;
+  }
+};
+
+TEST_F(SukatTimerWheelTest, SukatTimerWheelTestOrder)
+{
+  Sukat::TimerWheel wheel;
+  std::vector<int> order;
+  Sukat::Timer first([&]() { order.push_back(1); }),
+    second([&]() { order.push_back(2); }),
+    third([&]() { order.push_back(3); });
+  auto now = Sukat::TimerWheel::clock::now();
+
+  wheel.schedule(third, 30ms);
+  wheel.schedule(first, 10ms);
+  wheel.schedule(second, 20ms);
+  EXPECT_EQ(3, wheel.size());
+  EXPECT_TRUE(first.armed());
+
+  // Never early.
+  EXPECT_EQ(0, wheel.advance(now + 9ms));
+  EXPECT_EQ(3, wheel.advance(now + 40ms));
+  EXPECT_EQ(std::vector<int>({1, 2, 3}), order);
+  EXPECT_EQ(0, wheel.size());
+  EXPECT_FALSE(first.armed());
+  EXPECT_FALSE(wheel.timeout());
+}
+
+TEST_F(SukatTimerWheelTest, SukatTimerWheelTestCancel)
+{
+  Sukat::TimerWheel wheel;
+  unsigned int fired = 0;
+  Sukat::Timer timer([&]() { fired++; });
+  auto now = Sukat::TimerWheel::clock::now();
+
+  wheel.schedule(timer, 5ms);
+  timer.cancel();
+  EXPECT_FALSE(timer.armed());
+  EXPECT_EQ(0, wheel.size());
+  EXPECT_EQ(0, wheel.advance(now + 10ms));
+
+  // Re-scheduling moves rather than duplicates. Delays count from the
+  // wheel's own time once it has advanced past the clock.
+  wheel.schedule(timer, 5ms);
+  wheel.schedule(timer, 50ms);
+  EXPECT_EQ(1, wheel.size());
+  EXPECT_EQ(0, wheel.advance(now + 20ms));
+  EXPECT_EQ(1, wheel.advance(now + 80ms));
+  EXPECT_EQ(1, fired);
+
+  {
+    Sukat::Timer scoped([&]() { fired++; });
+
+    wheel.schedule(scoped, 1ms);
+  }
+  EXPECT_EQ(0, wheel.size());
+}
+
+TEST_F(SukatTimerWheelTest, SukatTimerWheelTestRearm)
+{
+  Sukat::TimerWheel wheel;
+  unsigned int fired = 0;
+  Sukat::Timer periodic([&]() {
+    if (++fired < 5)
+      {
+        wheel.schedule(periodic, 10ms);
+      }
+  });
+  auto now = Sukat::TimerWheel::clock::now();
+
+  wheel.schedule(periodic, 10ms);
+  step(wheel, now, 100ms);
+  EXPECT_EQ(5, fired);
+  EXPECT_FALSE(periodic.armed());
+}
+
+TEST_F(SukatTimerWheelTest, SukatTimerWheelTestCascade)
+{
+  Sukat::TimerWheel wheel;
+  std::vector<std::chrono::milliseconds> delays = {
+    250ms, 270ms, 300ms, 1000ms, 16370ms, 16400ms, 20000ms, 70000ms};
+  std::vector<std::unique_ptr<Sukat::Timer>> timers;
+  std::vector<std::chrono::milliseconds> fired;
+  auto now = Sukat::TimerWheel::clock::now();
+  size_t i;
+
+  for (i = 0; i < delays.size(); i++)
+    {
+      timers.emplace_back(std::make_unique<Sukat::Timer>(
+        [&, i]() { fired.push_back(delays[i]); }));
+      wheel.schedule(*timers.back(), delays[i]);
+    }
+  // Jumping straight to each deadline works as well as small steps.
+  for (i = 0; i < delays.size(); i++)
+    {
+      EXPECT_EQ(0, wheel.advance(now + delays[i] - 1ms));
+      EXPECT_EQ(1, wheel.advance(now + delays[i] + 5ms));
+    }
+  EXPECT_EQ(delays, fired);
+}
+
+TEST_F(SukatTimerWheelTest, SukatTimerWheelTestTimeout)
+{
+  Sukat::TimerWheel wheel;
+  Sukat::Timer near([]() {}), far([]() {});
+  auto now = Sukat::TimerWheel::clock::now();
+
+  EXPECT_FALSE(wheel.timeout(now));
+  wheel.schedule(far, 5000ms);
+  // Far timers only bound the wait until the next cascade.
+  auto wait = wheel.timeout(now);
+  ASSERT_TRUE(wait);
+  EXPECT_LE(*wait, 5001ms);
+
+  wheel.schedule(near, 20ms);
+  wait = wheel.timeout(now);
+  ASSERT_TRUE(wait);
+  EXPECT_GE(*wait, 20ms);
+  EXPECT_LE(*wait, 25ms);
+}
+
+TEST_F(SukatTimerWheelTest, SukatTimerWheelTestTimeoutCascade)
+{
+  Sukat::TimerWheel wheel;
+  unsigned int fired = 0;
+  Sukat::Timer upper([&]() { fired++; }), root([]() {});
+  auto now = Sukat::TimerWheel::clock::now();
+
+  // Beyond the first level, due with the cascade at tick 256.
+  wheel.schedule(upper, 256ms);
+  EXPECT_EQ(0, wheel.advance(now + 100ms));
+  // Due after that cascade, yet must not hide it.
+  wheel.schedule(root, 200ms);
+
+  auto wait = wheel.timeout(now + 100ms);
+  ASSERT_TRUE(wait);
+  EXPECT_LE(*wait, 157ms);
+
+  EXPECT_EQ(0, wheel.advance(now + 100ms + *wait));
+  wait = wheel.timeout(now + 100ms + *wait);
+  ASSERT_TRUE(wait);
+  EXPECT_LE(*wait, 3ms);
+  EXPECT_EQ(1, wheel.advance(now + 260ms));
+  EXPECT_EQ(1, fired);
+  EXPECT_TRUE(root.armed());
+}
+
+TEST_F(SukatTimerWheelTest, SukatTimerWheelTestReactor)
+{
+  Sukat::Reactor reactor;
+  bool fired = false;
+  Sukat::Timer timer([&]() {
+    fired = true;
+    reactor.stop(0);
+  });
+  auto start = std::chrono::steady_clock::now();
+
+  // No fds registered, only the timer bounds the wait.
+  reactor.schedule(timer, 20ms);
+  EXPECT_EQ(0, reactor.run());
+  EXPECT_TRUE(fired);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
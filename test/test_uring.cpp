@@ -0,0 +1,124 @@
+#include "gtest/gtest.h"
+
+#include "uring.hpp"
+
+class SukatUringTest : public ::testing::Test
+{
+ protected:
+  SukatUringTest()
+  {
+  }
+
+  virtual ~SukatUringTest()
+  {
+  }
+
+  virtual void SetUp()
+  {
+    if (!Sukat::UringEngine::supported())
+      {
+        GTEST_SKIP() << "io_uring not available";
+      }
+  }
+
+  virtual void TearDown()
+  {
+  }
+};
+
+class TestHandler : public Sukat::UringEngine::Handler
+{
+ public:
+  virtual void accepted(Sukat::SocketConnection &&conn) override
+  {
+    conns.emplace_back(std::move(conn));
+  }
+
+  virtual void received(std::span<const uint8_t> data) override
+  {
+    eof = data.empty();
+    rx.append(data.begin(), data.end());
+  }
+
+  virtual void sent(int res) override
+  {
+    sends.push_back(res);
+  }
+
+  virtual void error(int res) override
+  {
+    errors.push_back(res);
+  }
+
+  std::vector<Sukat::SocketConnection> conns;
+  std::string rx;
+  std::vector<int> sends, errors;
+  bool eof{false};
+};
+
+TEST_F(SukatUringTest, SukatUringTestEcho)
+{
+  Sukat::UringEngine engine(32, 8, 64);
+  Sukat::SocketListenerStream tcp_listener;
+  auto saddr = tcp_listener.getSource();
+  ASSERT_TRUE(saddr);
+  TestHandler listen_handler, conn_handler;
+  unsigned int i;
+
+  engine.accept(tcp_listener, listen_handler);
+  auto client =
+    std::make_unique<Sukat::SocketConnection>(SOCK_STREAM, saddr.value());
+  for (i = 0; i < 10 && listen_handler.conns.empty(); i++)
+    {
+      engine.poll(100);
+    }
+  ASSERT_EQ(1, listen_handler.conns.size());
+  EXPECT_FALSE(listen_handler.idle());
+  auto &server = listen_handler.conns.front();
+
+  engine.recv(server, conn_handler);
+  EXPECT_TRUE(client->ready(100));
+  EXPECT_EQ(5, client->write("hello"));
+  for (i = 0; i < 10 && conn_handler.rx.size() < 5; i++)
+    {
+      engine.poll(100);
+    }
+  EXPECT_EQ("hello", conn_handler.rx);
+
+  std::string first = "linked ", second = "reply";
+  struct iovec iovs[] = {{first.data(), first.size()},
+                         {second.data(), second.size()}};
+  engine.send(server, iovs, conn_handler);
+  for (i = 0; i < 10 && conn_handler.sends.size() < 2; i++)
+    {
+      engine.poll(100);
+    }
+  ASSERT_EQ(2, conn_handler.sends.size());
+  EXPECT_EQ(first.size(), conn_handler.sends[0]);
+  EXPECT_EQ(second.size(), conn_handler.sends[1]);
+  EXPECT_EQ("linked reply", client->readData().str());
+
+  client.reset();
+  for (i = 0; i < 10 && !conn_handler.eof; i++)
+    {
+      engine.poll(100);
+    }
+  EXPECT_TRUE(conn_handler.eof);
+  EXPECT_TRUE(conn_handler.idle());
+
+  engine.cancel(tcp_listener);
+  for (i = 0; i < 10 && !listen_handler.idle(); i++)
+    {
+      engine.poll(100);
+    }
+  EXPECT_TRUE(listen_handler.idle());
+  ASSERT_EQ(1, listen_handler.errors.size());
+  EXPECT_EQ(-ECANCELED, listen_handler.errors[0]);
+}
+
+int main(int argc, char **argv)
+{
+  Sukat::Logger::initialize(Sukat::Logger::LogLevel::ERROR);
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,16 +1,26 @@
 #include <system_error>
 
+#include "connector.hpp"
 #include "epoll.hpp"
+#include "forwarder.hpp"
+#include "loadgen.hpp"
+#include "loadserver.hpp"
 #include "logging.hpp"
+#include "metrics.hpp"
+#include "registry.hpp"
+#include "resolver.hpp"
 #include "socket.hpp"
 
 extern "C"
 {
 #include <assert.h>
+#include <fcntl.h>
 #include <getopt.h>
 #include <netdb.h>
 #include <sys/epoll.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 }
@@ -19,136 +29,391 @@ using namespace Sukat;
 
 class NetCat
 {
-  std::map<int, std::unique_ptr<Sukat::Socket>> conns;
-  Sukat::Epoll epIn, epOut, epMain;
+  /** @brief An established connection registered to the reactor */
+  class Connection : public SocketConnection, public EventHandler
+  {
+   public:
+    Connection(NetCat &owner, SocketConnection &&conn)
+      : SocketConnection(std::move(conn)), mDown(fd(), STDOUT_FILENO),
+        mOwner(owner)
+    {
+    }
 
- public:
-  NetCat()
+    virtual void handleEvent(uint32_t events) override
+    {
+      mOwner.touch();
+      if (events & EPOLLERR && mOut.pinned())
+        {
+          // Zerocopy completions, not necessarily a socket error.
+          if (reap(mOut) < 0)
+            {
+              mOwner.reactor.stop(-1);
+              return;
+            }
+          events &= ~EPOLLERR;
+        }
+      if (events & EPOLLOUT)
+        {
+          mOwner.writable(*this);
+        }
+      if (events & ~EPOLLOUT)
+        {
+          mOwner.readable(*this);
+        }
+    }
+
+    Forwarder mDown;              //!< Connection to stdout.
+    std::optional<Forwarder> mUp; //!< Stdin to connection, unless queued.
+    WriteQueue mOut;              //!< Stdin data queued for zerocopy sends.
+    bool mDownPaused{false};      //!< Stdout full, not reading.
+    bool mUpPaused{false};        //!< Connection full, stdin waits.
+    uint32_t mEvents{0};          //!< Events currently polled.
+
+   private:
+    NetCat &mOwner;
+  };
+
+  Registry<Connection> conns;
+  Sukat::Reactor reactor;
+  Resolver resolver{1};
+  std::unique_ptr<Connector> connector;
+  std::chrono::milliseconds timeout{0}; //!< Connect and idle, 0 for none.
+  Timer idleTimer{[this]() {
+    LOG_INF("Idle for ", timeout.count(), "ms, closing");
+    reactor.stop(0);
+  }};
+  Sukat::Buffer rxBuf;
+  EventCallback<std::function<void(uint32_t)>> stdinHandler{
+    [this](uint32_t) { stdinReadable(); }};
+  EventCallback<std::function<void(uint32_t)>> stdoutHandler{
+    [this](uint32_t) { stdoutWritable(); }};
+  bool stdinRegistered{false};
+  bool stdinClosed{false};
+  bool stdinPollable{true}; //!< False for e.g. regular files.
+  bool stdoutRegistered{false};
+  bool zerocopy{false};
+  int stdinFlags;
+
+  /** @brief Push back the idle timeout on activity */
+  void touch()
   {
-    if (!epMain.ctl(epIn.fd()) || !epMain.ctl(epOut.fd()))
+    if (timeout.count() > 0)
       {
-        throw std::system_error(errno, std::system_category(),
-                                "Failed to bind efds");
+        reactor.schedule(idleTimer, timeout);
       }
   }
 
   void registerStdin()
   {
-    if (!epIn.ctl(STDIN_FILENO))
+    if (!stdinRegistered && !stdinClosed && stdinPollable)
       {
-        throw std::system_error(errno, std::system_category(),
-                                "Failed to register stdin");
+        if (reactor.add(STDIN_FILENO, stdinHandler))
+          {
+            stdinRegistered = true;
+          }
+        else if (errno == EPERM)
+          {
+            LOG_DBG("Stdin not pollable, reading on EPOLLOUT");
+            stdinPollable = false;
+            conns.forEach([&](Connection &conn) { update(conn); });
+          }
+        else
+          {
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to register stdin");
+          }
       }
   }
 
-  auto connect(const std::string &dst, const std::string &port,
-               int type = SOCK_STREAM)
+  /** @brief Stop reading stdin until the connections catch up */
+  void pauseStdin()
   {
-    AddrInfo endpoint(dst, port, {}, type);
-    auto new_conn =
-      std::make_unique<SocketConnection>(endpoint.mResults.front());
-    auto [ret, inserted] =
-      conns.insert(std::pair<int, std::unique_ptr<SocketConnection>>(
-        new_conn->fd(), std::move(new_conn)));
-    assert(inserted);
-    const bool connected =
-      dynamic_cast<SocketConnection *>(ret->second.get())->connComplete();
-    const auto &efdTarget = (connected) ? epIn : epOut;
-    const auto events = (connected) ? EPOLLIN : EPOLLOUT;
-    int fd = ret->second->fd();
+    if (stdinRegistered)
+      {
+        LOG_DBG("Output full, pausing stdin");
+        reactor.remove(STDIN_FILENO, stdinHandler);
+        stdinRegistered = false;
+      }
+  }
+
+  void closeStdin()
+  {
+    LOG_DBG("Stdin closed");
+    pauseStdin();
+    stdinClosed = true;
+    conns.forEach([&](Connection &conn) { update(conn); });
+  }
+
+  bool anyBlocked()
+  {
+    bool blocked = false;
+
+    conns.forEach([&](Connection &conn) { blocked |= conn.mOut.blocked(); });
+    return blocked;
+  }
 
-    if (!efdTarget.ctl(fd, EPOLL_CTL_ADD, events))
+  /** @brief Poll \p conn only for what it is waiting on */
+  void update(Connection &conn)
+  {
+    uint32_t events = (conn.mDownPaused) ? 0 : static_cast<uint32_t>(EPOLLIN);
+
+    if (!conn.mOut.empty() || conn.mUpPaused ||
+        (!stdinPollable && !stdinClosed))
       {
-        throw std::system_error(errno, std::system_category(),
-                                "Failed to register fd");
+        events |= EPOLLOUT;
+      }
+    if (events != conn.mEvents)
+      {
+        if (!reactor.modify(conn.fd(), conn, events))
+          {
+            LOG_ERR("Failed to modify epoll for ", &conn);
+            reactor.stop(-1);
+            return;
+          }
+        conn.mEvents = events;
+      }
+  }
+
+  /** @brief Send queued data, polling EPOLLOUT only while some is left */
+  void flush(Connection &conn)
+  {
+    if (conn.write(conn.mOut) < 0)
+      {
+        reactor.stop(-1);
+        return;
       }
-    else if (connected)
+    update(conn);
+    if (!anyBlocked())
       {
-        // Ready to send stuff from stdin.
         registerStdin();
       }
+  }
+
+  /** @brief Splice stdin to \p conn until either side would block */
+  void upstream(Connection &conn)
+  {
+    auto res = conn.mUp->forward();
 
-    return ret->second.get();
+    conn.mUpPaused = false;
+    switch (res.status)
+      {
+        case Forwarder::forwardStatus::FWD_ERROR:
+          LOG_ERR("Failed to forward stdin to ", &conn, ": ",
+                  strerror(res.error));
+          reactor.stop(-1);
+          return;
+        case Forwarder::forwardStatus::FWD_EOF:
+          closeStdin();
+          break;
+        case Forwarder::forwardStatus::FWD_OUT_AGAIN:
+          conn.mUpPaused = true;
+          pauseStdin();
+          break;
+        case Forwarder::forwardStatus::FWD_IN_AGAIN:
+          registerStdin();
+          break;
+      }
+    update(conn);
+  }
+
+  void writable(Connection &conn)
+  {
+    if (conn.mUp)
+      {
+        upstream(conn);
+        return;
+      }
+    flush(conn);
+    if (!stdinPollable && !stdinClosed && !conn.mOut.blocked())
+      {
+        stdinReadable();
+      }
   }
 
-  ~NetCat() = default;
+  /** @brief Splice \p conn to stdout until either side would block */
+  void readable(Connection &conn)
+  {
+    auto res = conn.mDown.forward();
+
+    switch (res.status)
+      {
+        case Forwarder::forwardStatus::FWD_ERROR:
+          LOG_ERR("Failed to relay ", &conn, " to stdout: ",
+                  strerror(res.error));
+          reactor.stop(-1);
+          break;
+        case Forwarder::forwardStatus::FWD_EOF:
+          reactor.stop(0);
+          break;
+        case Forwarder::forwardStatus::FWD_OUT_AGAIN:
+          conn.mDownPaused = true;
+          if (!stdoutRegistered)
+            {
+              stdoutRegistered =
+                reactor.add(STDOUT_FILENO, stdoutHandler, EPOLLOUT);
+            }
+          update(conn);
+          break;
+        case Forwarder::forwardStatus::FWD_IN_AGAIN:
+          break;
+      }
+  }
+
+  void stdoutWritable()
+  {
+    reactor.remove(STDOUT_FILENO, stdoutHandler);
+    stdoutRegistered = false;
+    conns.forEach([&](Connection &conn) {
+      if (conn.mDownPaused)
+        {
+          conn.mDownPaused = false;
+          update(conn);
+          readable(conn);
+        }
+    });
+  }
 
-  std::optional<int> process(int timeout)
+  void stdinReadable()
   {
-    return epMain.wait(
-      [&](const struct epoll_event &ev) {
-        if (ev.data.fd == epOut.fd())
+    touch();
+    if (!zerocopy)
+      {
+        conns.forEach([&](Connection &conn) { upstream(conn); });
+        return;
+      }
+
+    auto space = rxBuf.writable();
+    ssize_t ret = ::read(STDIN_FILENO, space.data(), space.size());
+
+    if (ret > 0)
+      {
+        rxBuf.commit(ret);
+        conns.forEach([&](Connection &conn) {
+          conn.mOut.push(rxBuf.view());
+          flush(conn);
+        });
+        rxBuf.clear();
+        if (anyBlocked())
           {
-            return epOut.wait(
-              [&](const struct epoll_event &ev) -> std::optional<int> {
-                if (auto &iter = conns.at(ev.data.fd))
-                  {
-                    int ret;
-
-                    if (ev.events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP))
-                      {
-                        LOG_ERR("Failed to connect to ", iter.get(), " events ",
-                                Epoll::event_to_string(ev));
-                      }
-                    else if ((ret =
-                                dynamic_cast<SocketConnection *>((iter).get())
-                                  ->polloutReady()))
-                      {
-                        LOG_ERR("Failed to finalize connection: ",
-                                strerror(ret));
-                      }
-                    else if (!epOut.ctl(iter->fd(), EPOLL_CTL_DEL) ||
-                             !epIn.ctl(iter->fd()))
-                      {
-                        LOG_ERR("Failed to modify epoll after connect finish");
-                      }
-                    else
-                      {
-                        registerStdin();
-                        // All good.
-                        return {};
-                      }
-                    return std::make_optional<int>(-1);
-                  }
-                return {};
-              },
-              timeout);
+            pauseStdin();
           }
-        else if (ev.data.fd == epIn.fd())
+      }
+    else if (ret == 0 || (errno != EINTR && errno != EAGAIN))
+      {
+        closeStdin();
+      }
+  }
+
+ public:
+  /** @param use_zerocopy Send with MSG_ZEROCOPY where supported, instead of
+   *                      splicing stdin.
+   *  @param wait         Connect and idle timeout, 0 for none. */
+  NetCat(bool use_zerocopy = false,
+         std::chrono::milliseconds wait = std::chrono::milliseconds(0))
+    : timeout(wait), zerocopy(use_zerocopy), stdinFlags(::fcntl(STDIN_FILENO, F_GETFL))
+  {
+    struct stat st;
+
+    if (!reactor.add(resolver.fd(), resolver))
+      {
+        throw std::system_error(errno, std::system_category(),
+                                "Failed to register resolver");
+      }
+
+    // Regular files can't be polled, they are read whenever there's room.
+    stdinPollable = ::fstat(STDIN_FILENO, &st) || !S_ISREG(st.st_mode);
+    // A blocking terminal or socket on stdin would stall the reactor.
+    if (stdinFlags != -1 && !(stdinFlags & O_NONBLOCK))
+      {
+        ::fcntl(STDIN_FILENO, F_SETFL, stdinFlags | O_NONBLOCK);
+      }
+  }
+
+  /** @brief Resolve \p dst and race connects to its addresses */
+  void connect(const std::string &dst, const std::string &port,
+               int type = SOCK_STREAM)
+  {
+    resolver.resolve(
+      dst, port,
+      [this, dst, type](const Resolver::result &res) {
+        if (res.error)
           {
-            LOG_DBG("Data in epIn ", epIn.fd());
-            return epIn.wait(
-              [&](const struct epoll_event &ev) -> std::optional<int> {
-                if (auto &iter = conns.at(ev.data.fd))
-                  {
-                    auto data =
-                      dynamic_cast<SocketConnection *>(iter.get())->readData();
-                    std::cout << data.str() << std::endl;
-                    ;
-                  }
-                else if (ev.data.fd == STDIN_FILENO)
-                  {
-                    std::ostringstream data;
-                    data << std::cin.rdbuf();
-                    for (const auto &conn : conns)
-                      {
-                      //TODO This needs a better way.
-                        auto *connection =
-                          dynamic_cast<SocketConnection *>(conn.second.get());
-                        if (connection->ready())
-                          {
-                            connection->write(data.str().c_str());
-                          }
-                      }
-                    return {};
-                  }
-                return std::make_optional<int>(-1);
-              },
-              timeout);
+            std::cerr << "Failed to resolve " << dst << ": "
+                      << gai_strerror(res.error) << std::endl;
+            reactor.stop(-1);
+            return;
           }
-        abort(); // Not reached.
+        connector = std::make_unique<Connector>(
+          reactor, res.endpoints, static_cast<__socket_type>(type),
+          [this, dst](std::optional<SocketConnection> &&conn, int error) {
+            if (conn)
+              {
+                adopt(std::move(conn.value()));
+              }
+            else
+              {
+                std::cerr << "Failed to connect to " << dst << ": "
+                          << strerror(error) << std::endl;
+                reactor.stop(-1);
+              }
+          });
+        connector->setTimeout(timeout);
+        connector->start();
       },
-      timeout);
+      type);
+  }
+
+  /** @brief Connect straight to \p dst, e.g. a unix socket, no lookup needed */
+  void connect(const Socket::endpoint &dst, int type = SOCK_STREAM)
+  {
+    adopt(SocketConnection(static_cast<__socket_type>(type), dst));
+  }
+
+  /** @brief Start relaying over an established connection */
+  Connection *adopt(SocketConnection &&new_conn)
+  {
+    const int fd = new_conn.fd();
+    auto inserted = conns.emplace(fd, *this, std::move(new_conn));
+    assert(inserted);
+    auto &conn = *conns.find(inserted.value());
+
+    if (zerocopy && conn.setZerocopy())
+      {
+        conn.mOut.setZerocopy(true);
+      }
+    else if (!zerocopy)
+      {
+        conn.mUp.emplace(STDIN_FILENO, conn.fd());
+      }
+    conn.mEvents = EPOLLIN;
+    if (!reactor.add(conn.fd(), conn, conn.mEvents))
+      {
+        throw std::system_error(errno, std::system_category(),
+                                "Failed to register fd");
+      }
+    // Ready to send stuff from stdin.
+    registerStdin();
+    update(conn);
+    touch();
+    return &conn;
+  }
+
+  ~NetCat()
+  {
+    if (stdinFlags != -1)
+      {
+        ::fcntl(STDIN_FILENO, F_SETFL, stdinFlags);
+      }
+  }
+
+  int run()
+  {
+    return reactor.run();
+  }
+
+  Sukat::Reactor &loop()
+  {
+    return reactor;
   }
 };
 
@@ -157,9 +422,91 @@ void usage(const std::string bin)
   std::cout << bin << ": Netcat utility." << std::endl;
   std::cout << "Usage: " << bin << " <IP> "
             << " <Port>" << std::endl;
+  std::cout << "       " << bin << " -U <path>, @ prefix for abstract"
+            << std::endl;
   std::cout << "Options: " << std::endl;
+  std::cout << "  -a    Log from a background thread" << std::endl;
+  std::cout << "  -b f  Log in binary to file f, see Cpplogdecode"
+            << std::endl;
   std::cout << "  -h    This help" << std::endl;
+  std::cout << "  -M p  Count socket metrics, served in Prometheus format "
+               "on unix socket p, @ prefix for abstract"
+            << std::endl;
+  std::cout << "  -u    UDP, in every mode" << std::endl;
+  std::cout << "  -U    Unix domain socket, in every mode" << std::endl;
   std::cout << "  -v    Increase verbosity" << std::endl;
+  std::cout << "  -w s  Connect and idle timeout in seconds" << std::endl;
+  std::cout << "  -z    Send with MSG_ZEROCOPY" << std::endl;
+  std::cout << "Load generation, enabled by -n:" << std::endl;
+  std::cout << "  -n N  Concurrent connections" << std::endl;
+  std::cout << "  -m p  rr: request/response to an echo server (default),"
+            << std::endl;
+  std::cout << "        stream: send only" << std::endl;
+  std::cout << "  -s B  Bytes per request or write, default 64" << std::endl;
+  std::cout << "  -r R  Requests or writes per second over all "
+               "connections, default as fast as possible"
+            << std::endl;
+  std::cout << "  -t s  Duration in seconds, default 10, 0 until killed"
+            << std::endl;
+  std::cout << "  -i s  Seconds between reports, default 1, 0 for none"
+            << std::endl;
+  std::cout << "  -w s  Datagram response timeout, default 1" << std::endl;
+  std::cout << "Listening, enabled by -l, on <IP> <Port> or -U <path>:"
+            << std::endl;
+  std::cout << "  -l    Serve clients until killed or -t" << std::endl;
+  std::cout << "  -m s  echo (default), discard or chargen" << std::endl;
+  std::cout << "  -s B  Bytes per chargen write or datagram" << std::endl;
+  std::cout << "  -w s  Forget datagram peers idle this long, default 10"
+            << std::endl;
+}
+
+/** @brief Enable metrics and serve them on \p path, if one was given */
+static std::unique_ptr<MetricsExporter> exportMetrics(Reactor &reactor,
+                                                      const std::string &path)
+{
+  if (path.empty())
+    {
+      return nullptr;
+    }
+
+  const bool abstract = path.front() == '@';
+
+  Metrics::enable();
+  return std::make_unique<MetricsExporter>(
+    reactor, (abstract) ? path.substr(1) : path, abstract);
+}
+
+/** @brief Allow as many fds as the hard limit, for thousands of clients */
+static void raiseFdLimit()
+{
+  struct rlimit lim;
+
+  if (!::getrlimit(RLIMIT_NOFILE, &lim) && lim.rlim_cur < lim.rlim_max)
+    {
+      lim.rlim_cur = lim.rlim_max;
+      if (::setrlimit(RLIMIT_NOFILE, &lim))
+        {
+          LOG_ERR("Failed to raise fd limit: ", ::strerror(errno));
+        }
+    }
+}
+
+/** @brief End-point from the positional arguments */
+static Socket::endpoint endpoint(const std::string &dst,
+                                    const std::string &port, int type,
+                                    bool unix_socket)
+{
+  if (unix_socket)
+    {
+      const bool abstract = !dst.empty() && dst.front() == '@';
+      std::filesystem::path path((abstract) ? dst.substr(1) : dst);
+
+      return Socket::make_endpoint(path, abstract);
+    }
+
+  AddrInfo info(dst, port, {}, type);
+
+  return Socket::make_endpoint(info.mResults.front());
 }
 
 int main(int argc, char *argv[])
@@ -167,15 +514,71 @@ int main(int argc, char *argv[])
   int exit_ret = EXIT_FAILURE;
   std::string dst, port, src;
   int c;
+  bool zerocopy = false;
+  bool async_log = false;
+  std::string binary_log;
+  std::string metrics_path;
+  std::chrono::milliseconds timeout(0);
+  bool unix_socket = false;
+  int type = SOCK_STREAM;
+  bool listen = false;
+  bool generate = false;
+  std::string mode;
+  std::optional<std::chrono::seconds> duration, interval;
+  LoadGenerator::options load;
+  LoadServer::options serve;
   int log_lvl = static_cast<int>(Sukat::Logger::LogLevel::ERROR);
 
-  while ((c = getopt(argc, argv, "vh")) != -1)
+  while ((c = getopt(argc, argv, "ab:i:lm:M:n:r:s:t:uUvhw:z")) != -1)
     {
       switch (c)
         {
+          case 'a':
+            async_log = true;
+            break;
+          case 'b':
+            binary_log = optarg;
+            break;
+          case 'i':
+            interval = std::chrono::seconds(::strtoul(optarg, nullptr, 10));
+            break;
+          case 'l':
+            listen = true;
+            break;
+          case 'm':
+            mode = optarg;
+            break;
+          case 'M':
+            metrics_path = optarg;
+            break;
+          case 'n':
+            generate = true;
+            load.connections = ::strtoul(optarg, nullptr, 10);
+            break;
+          case 'r':
+            load.rate = ::strtod(optarg, nullptr);
+            break;
+          case 's':
+            load.size = serve.size = ::strtoul(optarg, nullptr, 10);
+            break;
+          case 't':
+            duration = std::chrono::seconds(::strtoul(optarg, nullptr, 10));
+            break;
+          case 'u':
+            type = SOCK_DGRAM;
+            break;
+          case 'U':
+            unix_socket = true;
+            break;
           case 'v':
             ++log_lvl;
             break;
+          case 'w':
+            timeout = std::chrono::seconds(::strtoul(optarg, nullptr, 10));
+            break;
+          case 'z':
+            zerocopy = true;
+            break;
           default:
             std::cerr << "Unknown argument " << c << std::endl;
             [[fallthrough]];
@@ -185,25 +588,106 @@ int main(int argc, char *argv[])
         }
     }
 
-  Logger::initialize(log_lvl);
+  log_lvl = std::min(log_lvl, static_cast<int>(Logger::LogLevel::DEBUG));
+  if (!binary_log.empty())
+    {
+      Logger::initializeBinary(static_cast<Logger::LogLevel>(log_lvl),
+                               binary_log);
+    }
+  else if (async_log)
+    {
+      Logger::initializeAsync(static_cast<Logger::LogLevel>(log_lvl));
+    }
+  else
+    {
+      Logger::initialize(log_lvl);
+    }
 
-  if (optind + 1 < argc)
+  load.type = serve.type = static_cast<__socket_type>(type);
+  load.duration = duration.value_or(load.duration);
+  serve.duration = duration.value_or(serve.duration);
+  load.interval = serve.interval = interval.value_or(load.interval);
+  if (timeout.count() > 0)
+    {
+      load.timeout = timeout;
+      serve.idle =
+        std::chrono::duration_cast<std::chrono::seconds>(timeout);
+    }
+  if (mode == "stream")
+    {
+      load.mode = LoadGenerator::pattern::PATTERN_STREAM;
+    }
+  else if (mode == "discard")
+    {
+      serve.mode = LoadServer::service::SERVICE_DISCARD;
+    }
+  else if (mode == "chargen")
+    {
+      serve.mode = LoadServer::service::SERVICE_CHARGEN;
+    }
+  else if (!mode.empty() && mode != "rr" && mode != "echo")
+    {
+      std::cerr << "Unknown mode " << mode << std::endl;
+      usage(argv[0]);
+      return exit_ret;
+    }
+
+  if (listen && optind + (unix_socket ? 0 : 1) < argc)
+    {
+      src = argv[optind];
+      port = (unix_socket) ? "" : argv[optind + 1];
+      raiseFdLimit();
+      try
+        {
+          LoadServer server(endpoint(src, port, type, unix_socket), serve);
+          auto exporter = exportMetrics(server.reactor(), metrics_path);
+
+          exit_ret = (!server.run()) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+      catch (std::exception &e)
+        {
+          std::cerr << "Failed to listen on " << src << ": " << e.what()
+                    << std::endl;
+        }
+    }
+  else if (generate && optind + (unix_socket ? 0 : 1) < argc)
+    {
+      dst = argv[optind];
+      port = (unix_socket) ? "" : argv[optind + 1];
+      raiseFdLimit();
+      try
+        {
+          LoadGenerator generator(endpoint(dst, port, type, unix_socket),
+                                  load);
+          auto exporter = exportMetrics(generator.reactor(), metrics_path);
+
+          exit_ret = (!generator.run()) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+      catch (std::exception &e)
+        {
+          std::cerr << "Failed to generate load to " << dst << ": "
+                    << e.what() << std::endl;
+        }
+    }
+  else if (optind + (unix_socket ? 0 : 1) < argc)
     {
       dst = std::string(argv[optind]);
-      port = std::string(argv[optind + 1]);
+      port = (unix_socket) ? "" : std::string(argv[optind + 1]);
       try
         {
-          NetCat catter;
-          std::optional<int> ret;
+          NetCat catter(zerocopy, timeout);
+          auto exporter = exportMetrics(catter.loop(), metrics_path);
 
           LOG_DBG("Ready to connect");
-          auto conn = catter.connect(dst, port);
-          exit_ret = EXIT_SUCCESS;
-          do
+          if (unix_socket)
+            {
+              catter.connect(endpoint(dst, port, type, true), type);
+            }
+          else
             {
-              ret = catter.process(-1);
+              catter.connect(dst, port, type);
             }
-          while (!ret.has_value());
+          exit_ret = (!catter.run()) ? EXIT_SUCCESS : EXIT_FAILURE;
         }
       catch (std::system_error &e)
         {
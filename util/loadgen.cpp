@@ -0,0 +1,563 @@
+#include "loadgen.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "buffer.hpp"
+#include "logging.hpp"
+
+using namespace Sukat;
+
+namespace
+{
+/** @brief Human readable duration of \p ns */
+std::string duration(uint64_t ns)
+{
+  std::ostringstream os;
+
+  os << std::fixed << std::setprecision(1);
+  if (ns < 1000)
+    {
+      os << ns << "ns";
+    }
+  else if (ns < 1000000)
+    {
+      os << ns / 1e3 << "us";
+    }
+  else if (ns < 1000000000)
+    {
+      os << ns / 1e6 << "ms";
+    }
+  else
+    {
+      os << ns / 1e9 << "s";
+    }
+  return os.str();
+}
+
+uint64_t nanoseconds(std::chrono::steady_clock::duration d)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+}
+
+double megabytes(uint64_t bytes, double secs)
+{
+  return (secs > 0) ? bytes / secs / 1e6 : 0;
+}
+} // namespace
+
+/** @brief One connection and its schedule */
+class LoadGenerator::Conn : public EventHandler
+{
+ public:
+  Conn(LoadGenerator &owner, size_t index)
+    : mOwner(owner), mSock(owner.mOpts.type, owner.mDst),
+      mStarted(clock::now()), mPacer([this]() { pace(); }),
+      mExpiry([this]() { expire(clock::now()); })
+  {
+    if (datagram())
+      {
+        mDgram = owner.mPayload;
+      }
+    if (owner.mOpts.rate > 0)
+      {
+        const auto gap = std::chrono::duration<double>(
+          owner.mOpts.connections / owner.mOpts.rate);
+
+        mGap = std::max(std::chrono::duration_cast<clock::duration>(gap),
+                        clock::duration(1));
+        // Spread the connections over the first gap.
+        mNext = mStarted + mGap * index / owner.mOpts.connections;
+      }
+  }
+
+  ~Conn()
+  {
+    close();
+  }
+
+  /** @brief Register and wait for the connect to finish */
+  bool start()
+  {
+    mEvents = EPOLLOUT;
+    return mOwner.mReactor.add(mSock.fd(), *this, mEvents);
+  }
+
+  virtual void handleEvent(uint32_t events) override
+  {
+    if (!mConnected)
+      {
+        if (mSock.polloutReady() || (events & (EPOLLERR | EPOLLHUP)))
+          {
+            LOG_ERR("Failed to connect ", &mSock);
+            fail();
+            return;
+          }
+        connected();
+      }
+    else if (events & EPOLLERR)
+      {
+        fail();
+        return;
+      }
+    if (events & EPOLLIN)
+      {
+        readable();
+      }
+    if (!mClosed && (events & EPOLLOUT))
+      {
+        writable();
+      }
+    update();
+  }
+
+  bool closed() const
+  {
+    return mClosed;
+  }
+
+ private:
+  bool request() const
+  {
+    return mOwner.mOpts.mode == pattern::PATTERN_REQUEST;
+  }
+
+  bool closedLoop() const
+  {
+    return request() && mOwner.mOpts.rate <= 0;
+  }
+
+  bool datagram() const
+  {
+    return mOwner.mOpts.type == SOCK_DGRAM;
+  }
+
+  /** @brief Give up on datagram requests unanswered for too long */
+  void expire(clock::time_point now)
+  {
+    while (!mOutstanding.empty() &&
+           now - mOutstanding.front().sent >= mOwner.mOpts.timeout)
+      {
+        mOutstanding.pop_front();
+        mOwner.mTotal.timeouts++;
+        mOwner.mInterval.timeouts++;
+      }
+    if (!mClosed && closedLoop() && mOutstanding.empty())
+      {
+        send(now);
+        update();
+      }
+    arm(now);
+  }
+
+  /** @brief Time out the oldest outstanding datagram request */
+  void arm(clock::time_point now)
+  {
+    if (mClosed || mOutstanding.empty() || mExpiry.armed())
+      {
+        return;
+      }
+    mOwner.mReactor.schedule(
+      mExpiry, std::chrono::ceil<std::chrono::milliseconds>(
+                 mOutstanding.front().sent + mOwner.mOpts.timeout - now));
+  }
+
+  /** @brief Match the reply tagged \p seq to its request */
+  void answered(uint64_t seq, clock::time_point now)
+  {
+    auto iter = std::lower_bound(
+      mOutstanding.begin(), mOutstanding.end(), seq,
+      [](const outstanding &req, uint64_t seq) { return req.seq < seq; });
+
+    if (iter == mOutstanding.end() || iter->seq != seq)
+      {
+        // Timed out already, or duplicated on the way.
+        mOwner.mTotal.late++;
+        mOwner.mInterval.late++;
+        return;
+      }
+    completed(iter->sent, now);
+    mOutstanding.erase(iter);
+    if (closedLoop())
+      {
+        send(now);
+      }
+  }
+
+  void completed(clock::time_point sent, clock::time_point now)
+  {
+    const uint64_t ns = nanoseconds(now - sent);
+
+    mOwner.mLatency.record(ns);
+    mOwner.mIntervalLatency.record(ns);
+    mOwner.mTotal.requests++;
+    mOwner.mInterval.requests++;
+  }
+
+  void connected()
+  {
+    const auto now = clock::now();
+
+    mConnected = true;
+    mOwner.mConnected++;
+    mOwner.mConnectLatency.record(nanoseconds(now - mStarted));
+    if (closedLoop())
+      {
+        send(now);
+      }
+    else if (mOwner.mOpts.rate > 0)
+      {
+        pace();
+      }
+  }
+
+  /** @brief Send what's due on the schedule, then sleep until the next */
+  void pace()
+  {
+    const auto now = clock::now();
+
+    while (mNext <= now)
+      {
+        send(mNext);
+        mNext += mGap;
+      }
+    update();
+    if (!mClosed)
+      {
+        mOwner.mReactor.schedule(
+          mPacer, std::chrono::ceil<std::chrono::milliseconds>(mNext - now));
+      }
+  }
+
+  /** @brief Queue one request or chunk, meant to go out at \p intended */
+  void send(clock::time_point intended)
+  {
+    if (mClosed)
+      {
+        return;
+      }
+    if (datagram())
+      {
+        if (request())
+          {
+            // Tagged, so a late reply can't pass for a newer request's.
+            ::memcpy(mDgram.data(), &mSeq, sizeof(mSeq));
+          }
+        // Datagrams go out one by one, a queue would merge them.
+        if (mSock.write(mDgram.data(), mDgram.size()) < 0)
+          {
+            mOwner.mTotal.errors++;
+            mOwner.mInterval.errors++;
+            return;
+          }
+        sent(mDgram.size());
+      }
+    else
+      {
+        mOut.push(mOwner.mPayload);
+        flush();
+      }
+    if (request())
+      {
+        mOutstanding.push_back({mSeq++, intended});
+        if (datagram())
+          {
+            arm(clock::now());
+          }
+      }
+  }
+
+  void sent(size_t bytes)
+  {
+    mOwner.mTotal.bytesOut += bytes;
+    mOwner.mInterval.bytesOut += bytes;
+  }
+
+  void flush()
+  {
+    const ssize_t ret = mSock.write(mOut);
+
+    if (ret < 0)
+      {
+        fail();
+        return;
+      }
+    sent(ret);
+  }
+
+  void writable()
+  {
+    if (!request() && mOwner.mOpts.rate <= 0)
+      {
+        // Stream as fast as the socket takes it.
+        while (mOut.size() < 4 * mOwner.mPayload.size())
+          {
+            mOut.push(mOwner.mPayload);
+          }
+      }
+    flush();
+  }
+
+  void readable()
+  {
+    const auto size = mOwner.mPayload.size();
+
+    while (!mClosed)
+      {
+        mIn.clear();
+
+        auto res = mSock.read(mIn);
+
+        mOwner.mTotal.bytesIn += res.bytes;
+        mOwner.mInterval.bytesIn += res.bytes;
+        if (request() && datagram())
+          {
+            const auto now = clock::now();
+            auto data = mIn.readable();
+
+            // Echoed datagrams are request sized and come back to back.
+            while (data.size() >= size)
+              {
+                uint64_t seq;
+
+                ::memcpy(&seq, data.data(), sizeof(seq));
+                answered(seq, now);
+                data = data.subspan(size);
+              }
+          }
+        else if (request())
+          {
+            const auto now = clock::now();
+
+            mPending += res.bytes;
+            while (mPending >= size && !mOutstanding.empty())
+              {
+                completed(mOutstanding.front().sent, now);
+                mOutstanding.pop_front();
+                mPending -= size;
+                if (closedLoop())
+                  {
+                    send(now);
+                  }
+              }
+          }
+        if (res.status == SocketConnection::readStatus::READ_EOF ||
+            res.status == SocketConnection::readStatus::READ_ERROR)
+          {
+            LOG_INF("Connection ", &mSock, " closed by peer");
+            fail();
+          }
+        else if (res.status != SocketConnection::readStatus::READ_FULL)
+          {
+            break;
+          }
+      }
+  }
+
+  /** @brief Poll EPOLLOUT only while there's something to send */
+  void update()
+  {
+    uint32_t events = EPOLLIN;
+
+    if (mClosed)
+      {
+        return;
+      }
+    if (!mOut.empty() || (!request() && mOwner.mOpts.rate <= 0))
+      {
+        events |= EPOLLOUT;
+      }
+    if (events != mEvents && mOwner.mReactor.modify(mSock.fd(), *this, events))
+      {
+        mEvents = events;
+      }
+  }
+
+  void fail()
+  {
+    mOwner.mTotal.errors++;
+    mOwner.mInterval.errors++;
+    close();
+    mOwner.closed(*this);
+  }
+
+  void close()
+  {
+    if (!mClosed)
+      {
+        mClosed = true;
+        mPacer.cancel();
+        mExpiry.cancel();
+        mOwner.mReactor.remove(mSock.fd(), *this);
+        if (mConnected)
+          {
+            mOwner.mConnected--;
+          }
+      }
+  }
+
+  /** @brief Request waiting for its response */
+  struct outstanding
+  {
+    uint64_t seq;
+    clock::time_point sent; //!< When it was meant to go out.
+  };
+
+  LoadGenerator &mOwner;
+  SocketConnection mSock;
+  WriteQueue mOut;
+  Buffer mIn{65536};
+  std::string mDgram; //!< Tagged copy of the payload, datagrams only.
+  std::deque<outstanding> mOutstanding; //!< Oldest first.
+  uint64_t mSeq{0};   //!< Tag of the next request.
+  size_t mPending{0}; //!< Response bytes not yet a whole response.
+  const clock::time_point mStarted;
+  clock::time_point mNext;
+  clock::duration mGap{0};
+  Timer mPacer;
+  Timer mExpiry; //!< Armed for the oldest outstanding datagram request.
+  uint32_t mEvents{0};
+  bool mConnected{false};
+  bool mClosed{false};
+};
+
+LoadGenerator::LoadGenerator(const Socket::endpoint &dst,
+                             const options &opts)
+  : mDst(dst), mOpts(opts),
+    mPayload(std::max<size_t>(opts.size, (opts.type == SOCK_DGRAM &&
+                                           opts.mode == pattern::PATTERN_REQUEST)
+                                            ? sizeof(uint64_t)
+                                            : 1),
+             'x'),
+    mReportTimer([this]() { report(); }),
+    mEndTimer([this]() { mReactor.stop(0); })
+{
+}
+
+LoadGenerator::~LoadGenerator() = default;
+
+int LoadGenerator::run()
+{
+  unsigned int i;
+
+  mStart = mLastReport = clock::now();
+  for (i = 0; i < mOpts.connections; i++)
+    {
+      try
+        {
+          auto conn = std::make_unique<Conn>(*this, i);
+
+          if (!conn->start())
+            {
+              throw std::system_error(errno, std::system_category(),
+                                      "Failed to register connection");
+            }
+          mConns.emplace_back(std::move(conn));
+        }
+      catch (std::system_error &e)
+        {
+          LOG_ERR("Connection ", i, " failed: ", e.what());
+          mTotal.errors++;
+        }
+    }
+  if (mConns.empty())
+    {
+      std::cerr << "No connections could be opened" << std::endl;
+      return -1;
+    }
+  mReactor.schedule(mReportTimer, (mOpts.interval.count() > 0)
+                                    ? mOpts.interval
+                                    : std::chrono::seconds(1));
+  if (mOpts.duration.count() > 0)
+    {
+      mReactor.schedule(mEndTimer, mOpts.duration);
+    }
+  mReactor.run();
+  summary();
+  return (mTotal.requests || mTotal.bytesOut) ? 0 : -1;
+}
+
+void LoadGenerator::closed(Conn &conn)
+{
+  (void)conn;
+  if (std::all_of(mConns.begin(), mConns.end(),
+                  [](const auto &c) { return c->closed(); }))
+    {
+      std::cerr << "All connections closed" << std::endl;
+      mReactor.stop(-1);
+    }
+}
+
+void LoadGenerator::report()
+{
+  const auto now = clock::now();
+  const double secs = std::chrono::duration<double>(now - mLastReport).count();
+
+  if (mOpts.interval.count() > 0)
+    {
+      std::cout << std::fixed << std::setprecision(1) << std::setw(6)
+                << std::chrono::duration<double>(now - mStart).count()
+                << "s  conns " << mConnected;
+      if (mOpts.mode == pattern::PATTERN_REQUEST)
+        {
+          std::cout << "  req/s " << std::setprecision(0)
+                    << mInterval.requests / secs << "  p50 "
+                    << duration(mIntervalLatency.percentile(50)) << "  p99 "
+                    << duration(mIntervalLatency.percentile(99))
+                    << "  p99.9 "
+                    << duration(mIntervalLatency.percentile(99.9))
+                    << "  max " << duration(mIntervalLatency.max());
+        }
+      std::cout << std::setprecision(2) << "  out "
+                << megabytes(mInterval.bytesOut, secs) << " MB/s  in "
+                << megabytes(mInterval.bytesIn, secs) << " MB/s";
+      if (mInterval.errors || mInterval.timeouts || mInterval.late)
+        {
+          std::cout << "  errors " << mInterval.errors << "  timeouts "
+                    << mInterval.timeouts << "  late " << mInterval.late;
+        }
+      std::cout << std::endl;
+    }
+  mInterval = {};
+  mIntervalLatency.reset();
+  mLastReport = now;
+  mReactor.schedule(mReportTimer, (mOpts.interval.count() > 0)
+                                    ? mOpts.interval
+                                    : std::chrono::seconds(1));
+}
+
+void LoadGenerator::summary()
+{
+  const double secs =
+    std::chrono::duration<double>(clock::now() - mStart).count();
+
+  std::cout << std::fixed << std::setprecision(2) << "--- " << secs
+            << "s, " << mConnectLatency.count() << "/" << mOpts.connections
+            << " connected, connect p50 "
+            << duration(mConnectLatency.percentile(50)) << " p99 "
+            << duration(mConnectLatency.percentile(99)) << " max "
+            << duration(mConnectLatency.max()) << std::endl;
+  if (mOpts.mode == pattern::PATTERN_REQUEST)
+    {
+      std::cout << std::setprecision(0) << "requests " << mTotal.requests
+                << " (" << mTotal.requests / secs << "/s)  timeouts "
+                << mTotal.timeouts << "  late " << mTotal.late << std::endl;
+      std::cout << "latency min " << duration(mLatency.min()) << " mean "
+                << duration(mLatency.mean());
+      for (double p : {50.0, 90.0, 99.0, 99.9, 99.99})
+        {
+          std::cout << " p" << std::defaultfloat << std::setprecision(6)
+                    << p << " " << duration(mLatency.percentile(p));
+        }
+      std::cout << " max " << duration(mLatency.max()) << std::endl;
+    }
+  std::cout << std::fixed << std::setprecision(2) << "bytes out "
+            << mTotal.bytesOut << " (" << megabytes(mTotal.bytesOut, secs)
+            << " MB/s)  in " << mTotal.bytesIn << " ("
+            << megabytes(mTotal.bytesIn, secs) << " MB/s)  errors "
+            << mTotal.errors << std::endl;
+}
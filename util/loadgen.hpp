@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "epoll.hpp"
+#include "histogram.hpp"
+#include "socket.hpp"
+#include "timerwheel.hpp"
+
+namespace Sukat
+{
+/** @brief Drives load over many connections and reports latency
+ *
+ * Each connection either sends fixed size requests and times the equally
+ * sized response an echo server sends back, or streams data as fast as or
+ * at the rate it is allowed. With a rate, requests are sent on schedule
+ * whether or not earlier ones were answered, and latency is measured from
+ * the scheduled time so a stalled server isn't hidden by a stalled client
+ * (coordinated omission). Without a rate, each connection keeps one request
+ * outstanding.
+ */
+class LoadGenerator
+{
+ public:
+  enum class pattern
+  {
+    PATTERN_REQUEST, //!< Request/response, latency measured.
+    PATTERN_STREAM   //!< One way stream, replies are discarded.
+  };
+
+  /** @brief Run parameters
+   *
+   * Datagram requests start with a sequence tag, so are at least 8 bytes.
+   */
+  struct options
+  {
+    unsigned int connections{1};
+    __socket_type type{SOCK_STREAM};
+    pattern mode{pattern::PATTERN_REQUEST};
+    size_t size{64};                    //!< Bytes per request or write.
+    double rate{0};                     //!< Per second over all, 0 for max.
+    std::chrono::seconds duration{10};  //!< 0 to run until stopped.
+    std::chrono::seconds interval{1};   //!< Between reports, 0 for none.
+    std::chrono::milliseconds timeout{1000}; //!< Datagram response timeout.
+  };
+
+  LoadGenerator(const Socket::endpoint &dst, const options &opts);
+  ~LoadGenerator();
+
+  LoadGenerator(const LoadGenerator &) = delete;
+
+  /**
+   * @brief Connect, run for the duration and print the summary.
+   *
+   * @return 0 if any request or byte went through.
+   */
+  int run();
+
+  Reactor &reactor()
+  {
+    return mReactor;
+  }
+
+ private:
+  class Conn;
+  friend class Conn;
+
+  using clock = std::chrono::steady_clock;
+
+  /** @brief Running totals, also kept per report interval */
+  struct counters
+  {
+    uint64_t requests{0};
+    uint64_t bytesOut{0};
+    uint64_t bytesIn{0};
+    uint64_t errors{0};
+    uint64_t timeouts{0};
+    uint64_t late{0}; //!< Datagram replies to requests already timed out.
+  };
+
+  void report();
+  void summary();
+  void closed(Conn &conn);
+
+  const Socket::endpoint mDst;
+  const options mOpts;
+  const std::string mPayload;
+  Reactor mReactor;
+  std::vector<std::unique_ptr<Conn>> mConns;
+  size_t mConnected{0};
+  counters mTotal, mInterval;
+  Histogram mLatency, mIntervalLatency, mConnectLatency; //!< In ns.
+  clock::time_point mStart, mLastReport;
+  Timer mReportTimer;
+  Timer mEndTimer;
+};
+} // namespace Sukat
@@ -0,0 +1,558 @@
+#include "loadserver.hpp"
+
+#include <iomanip>
+#include <iostream>
+
+#include "buffer.hpp"
+#include "logging.hpp"
+
+extern "C"
+{
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+}
+
+using namespace Sukat;
+
+namespace
+{
+constexpr size_t chargenLine = 72;
+constexpr size_t chargenChars = 95; //!< Printable ASCII, '!' to '~'.
+
+/** @brief \p lines RFC 864 lines, each rotated one character from the last */
+std::string chargenLines(size_t lines)
+{
+  std::string out;
+  size_t i, j;
+
+  out.reserve(lines * (chargenLine + 2));
+  for (i = 0; i < lines; i++)
+    {
+      for (j = 0; j < chargenLine; j++)
+        {
+          out += static_cast<char>('!' + (i + j) % chargenChars);
+        }
+      out += "\r\n";
+    }
+  return out;
+}
+
+/** @brief Pattern of one chargen period, extended by \p chunk bytes so any
+ * slice of that length is contiguous */
+std::string chargenPattern(size_t chunk)
+{
+  const std::string period = chargenLines(chargenChars);
+  std::string out;
+
+  while (out.size() < period.size() + chunk)
+    {
+      out += period;
+    }
+  return out;
+}
+
+double megabytes(uint64_t bytes, double secs)
+{
+  return (secs > 0) ? bytes / secs / 1e6 : 0;
+}
+} // namespace
+
+/** @brief One accepted stream client */
+class LoadServer::Client : public SocketConnection, public EventHandler
+{
+ public:
+  Client(LoadServer &owner, SocketConnection &&conn)
+    : SocketConnection(std::move(conn)), mOwner(owner)
+  {
+  }
+
+  bool start()
+  {
+    mEvents = wanted();
+    return mOwner.mReactor.add(fd(), *this, mEvents);
+  }
+
+  virtual void handleEvent(uint32_t events) override
+  {
+    if (events & EPOLLERR)
+      {
+        fail(polloutReady());
+      }
+    if (!mDone && (events & EPOLLIN))
+      {
+        readable();
+      }
+    if (!mDone && (events & EPOLLOUT))
+      {
+        writable();
+      }
+    if (!mDone && (events & EPOLLHUP) && !(events & EPOLLIN))
+      {
+        // Gone while we weren't reading, nobody to send to.
+        mDone = true;
+      }
+    if (mDone)
+      {
+        // Destroys this.
+        mOwner.close(*this);
+        return;
+      }
+    update();
+  }
+
+ private:
+  bool echo() const
+  {
+    return mOwner.mOpts.mode == service::SERVICE_ECHO;
+  }
+
+  bool chargen() const
+  {
+    return mOwner.mOpts.mode == service::SERVICE_CHARGEN;
+  }
+
+  void readable()
+  {
+    while (true)
+      {
+        auto res = read(mIn);
+
+        mOwner.received(res.bytes);
+        if (echo())
+          {
+            mOut.push(mIn.view());
+          }
+        mIn.clear();
+        if (res.status == readStatus::READ_EOF)
+          {
+            mEof = true;
+            break;
+          }
+        if (res.status == readStatus::READ_ERROR)
+          {
+            fail(res.error);
+            return;
+          }
+        if (res.status != readStatus::READ_FULL ||
+            (echo() && mOut.blocked()))
+          {
+            break;
+          }
+      }
+    if (!mOut.empty())
+      {
+        flush();
+      }
+    // Whatever was echoed is still sent, chargen has nobody to send to.
+    mDone = mDone || (mEof && (mOut.empty() || chargen()));
+  }
+
+  void writable()
+  {
+    if (chargen())
+      {
+        while (mOut.size() < 4 * mOwner.mChunk)
+          {
+            mOut.push(mOwner.chargen(mOffset, mOwner.mChunk));
+          }
+      }
+    flush();
+    mDone = mDone || (mEof && mOut.empty());
+  }
+
+  void flush()
+  {
+    const ssize_t ret = write(mOut);
+
+    if (ret < 0)
+      {
+        fail(errno);
+        return;
+      }
+    mOwner.sent(ret);
+  }
+
+  /** @brief Close on \p err. Clients leaving with echoes unread reset the
+   * connection, so resets aren't counted as errors. */
+  void fail(int err)
+  {
+    LOG_INF("Client ", this, " failed: ", ::strerror(err));
+    if (err != ECONNRESET && err != EPIPE)
+      {
+        mOwner.error();
+      }
+    mDone = true;
+  }
+
+  /** @brief Stop reading while echoes back up, poll EPOLLOUT while there's
+   * something to send */
+  uint32_t wanted() const
+  {
+    uint32_t events = 0;
+
+    if (!mEof && !(echo() && mOut.blocked()))
+      {
+        events |= EPOLLIN;
+      }
+    if (!mOut.empty() || chargen())
+      {
+        events |= EPOLLOUT;
+      }
+    return events;
+  }
+
+  void update()
+  {
+    const uint32_t events = wanted();
+
+    if (events != mEvents && mOwner.mReactor.modify(fd(), *this, events))
+      {
+        mEvents = events;
+      }
+  }
+
+  LoadServer &mOwner;
+  WriteQueue mOut;
+  Buffer mIn{65536};
+  size_t mOffset{0}; //!< Position in the chargen pattern.
+  uint32_t mEvents{0};
+  bool mEof{false};
+  bool mDone{false};
+};
+
+LoadServer::LoadServer(const Socket::endpoint &src, const options &opts)
+  : mOpts(opts),
+    mChunk((opts.size) ? opts.size : (datagram()) ? 512 : 16384),
+    mPattern(chargenPattern(mChunk)),
+    mListenerEvent([this](uint32_t) {
+      if (datagram())
+        {
+          receive();
+        }
+      else
+        {
+          accept();
+        }
+    }),
+    mSignalEvent([this](uint32_t) {
+      struct signalfd_siginfo info;
+
+      if (::read(mSignalFd->fd(), &info, sizeof(info)) == sizeof(info))
+        {
+          LOG_INF("Stopping on signal ", info.ssi_signo);
+        }
+      mReactor.stop(0);
+    }),
+    mReportTimer([this]() { report(); }),
+    mEndTimer([this]() { mReactor.stop(0); }),
+    mAcceptTimer([this]() {
+      if (!mReactor.modify(mStream->fd(), mListenerEvent, EPOLLIN))
+        {
+          LOG_ERR("Failed to resume accepting: ", ::strerror(errno));
+          mReactor.stop(-1);
+        }
+    })
+{
+  const auto &sun = reinterpret_cast<const struct sockaddr_un &>(src.first);
+
+  if (src.first.ss_family == AF_UNIX && sun.sun_path[0] != '\0')
+    {
+      struct stat st;
+
+      // A stale socket from an earlier run would fail the bind. Anything
+      // else at the path is left for the bind to refuse.
+      mUnixPath = sun.sun_path;
+      if (!::lstat(mUnixPath.c_str(), &st) && S_ISSOCK(st.st_mode))
+        {
+          std::error_code ec;
+
+          std::filesystem::remove(mUnixPath, ec);
+        }
+    }
+  if (datagram())
+    {
+      const int rcvbuf = 4 * 1024 * 1024;
+
+      mDemux = std::make_unique<SocketListenerUdpDemux>(src, 32, dgramMax,
+                                                        mDgramPool);
+      // Many peers starting at once overflow the default buffer.
+      if (::setsockopt(mDemux->fd(), SOL_SOCKET, SO_RCVBUF, &rcvbuf,
+                       sizeof(rcvbuf)))
+        {
+          LOG_INF("Failed to grow receive buffer: ", ::strerror(errno));
+        }
+    }
+  else
+    {
+      mStream = std::make_unique<SocketListenerStream>(src);
+    }
+  if (!mReactor.add((mDemux) ? mDemux->fd() : mStream->fd(), mListenerEvent))
+    {
+      throw std::system_error(errno, std::system_category(),
+                              "Failed to register listener");
+    }
+}
+
+LoadServer::~LoadServer()
+{
+  if (!mUnixPath.empty())
+    {
+      std::error_code ec;
+
+      std::filesystem::remove(mUnixPath, ec);
+    }
+}
+
+int LoadServer::run()
+{
+  sigset_t mask, old;
+
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  if (!::sigprocmask(SIG_BLOCK, &mask, &old))
+    {
+      mSignalFd.emplace(::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC));
+      if (mSignalFd->fd() == -1 ||
+          !mReactor.add(mSignalFd->fd(), mSignalEvent))
+        {
+          LOG_ERR("No signalfd, summary lost on signals: ",
+                  ::strerror(errno));
+          mSignalFd.reset();
+          ::sigprocmask(SIG_SETMASK, &old, nullptr);
+        }
+    }
+
+  mStart = mLastReport = clock::now();
+  std::cout << "Listening on "
+            << ((mDemux) ? static_cast<Socket *>(mDemux.get())
+                         : static_cast<Socket *>(mStream.get()))
+            << std::endl;
+  mReactor.schedule(mReportTimer, (mOpts.interval.count() > 0)
+                                    ? mOpts.interval
+                                    : std::chrono::seconds(1));
+  if (mOpts.duration.count() > 0)
+    {
+      mReactor.schedule(mEndTimer, mOpts.duration);
+    }
+  mReactor.run();
+  summary();
+
+  if (mSignalFd)
+    {
+      mReactor.remove(mSignalFd->fd(), mSignalEvent);
+      mSignalFd.reset();
+      ::sigprocmask(SIG_SETMASK, &old, nullptr);
+    }
+  return (mTotal.accepted) ? 0 : -1;
+}
+
+void LoadServer::accept()
+{
+  try
+    {
+      acceptBurst();
+    }
+  catch (const std::system_error &e)
+    {
+      const int err = e.code().value();
+
+      LOG_INF("Failed to accept: ", ::strerror(err));
+      error();
+      // Clients resetting before accept or a failed handshake only cost
+      // that client, the next may well succeed.
+      if (err == ECONNABORTED || err == EPROTO || err == EPERM)
+        {
+          return;
+        }
+      // Out of fds or memory. The listener stays readable, so stop
+      // polling it for a moment rather than spin until clients leave.
+      if (mReactor.modify(mStream->fd(), mListenerEvent, 0))
+        {
+          mReactor.schedule(mAcceptTimer, acceptBackoff);
+        }
+    }
+}
+
+void LoadServer::acceptBurst()
+{
+  // Bounded so a connection storm doesn't starve established clients.
+  mStream->accept(
+    [this](SocketConnection &&conn, std::vector<uint8_t> &) {
+      const int fd = conn.fd();
+
+      if (mClients.emplace(fd, *this, std::move(conn)))
+        {
+          if (mClients.find(fd)->start())
+            {
+              mTotal.accepted++;
+              mInterval.accepted++;
+              mPeak = std::max(mPeak, mClients.size());
+              return;
+            }
+          LOG_ERR("Failed to register client fd ", fd, ": ",
+                  ::strerror(errno));
+          mClients.erase(fd);
+        }
+      error();
+    },
+    nullptr, 64);
+}
+
+void LoadServer::receive()
+{
+  // One clock read per batch is close enough for idle expiry.
+  const auto now = clock::now();
+  auto serve = [this, now](UdpPeer &peer, std::span<uint8_t> data) {
+    std::string_view reply;
+
+    mPeerSeen[peer.peer()] = now;
+    received(data.size());
+    mTotal.datagramsIn++;
+    mInterval.datagramsIn++;
+    if (mOpts.mode == service::SERVICE_ECHO)
+      {
+        reply = {reinterpret_cast<const char *>(data.data()), data.size()};
+      }
+    else if (mOpts.mode == service::SERVICE_CHARGEN)
+      {
+        // One datagram answered by one, offset shared over all peers.
+        reply = chargen(mDgramOffset, mChunk);
+      }
+    else
+      {
+        return;
+      }
+    if (peer.write(reply) < 0)
+      {
+        // Full socket buffer, the peer sees it as loss.
+        error();
+        return;
+      }
+    sent(reply.size());
+    mTotal.datagramsOut++;
+    mInterval.datagramsOut++;
+  };
+
+  mDemux->process(
+    [&](UdpPeer &peer, std::span<uint8_t> data) {
+      mTotal.accepted++;
+      mInterval.accepted++;
+      mPeak = std::max(mPeak, mDemux->size());
+      serve(peer, data);
+    },
+    serve);
+}
+
+void LoadServer::close(Client &client)
+{
+  const int fd = client.fd();
+
+  mReactor.remove(fd, client);
+  mClients.erase(fd);
+  mTotal.closed++;
+  mInterval.closed++;
+}
+
+void LoadServer::received(size_t bytes)
+{
+  mTotal.bytesIn += bytes;
+  mInterval.bytesIn += bytes;
+}
+
+void LoadServer::sent(size_t bytes)
+{
+  mTotal.bytesOut += bytes;
+  mInterval.bytesOut += bytes;
+}
+
+void LoadServer::error()
+{
+  mTotal.errors++;
+  mInterval.errors++;
+}
+
+std::string_view LoadServer::chargen(size_t &offset, size_t len) const
+{
+  const size_t period = mPattern.size() - mChunk;
+  std::string_view out(mPattern.data() + offset, len);
+
+  offset = (offset + len) % period;
+  return out;
+}
+
+void LoadServer::report()
+{
+  const auto now = clock::now();
+  const double secs = std::chrono::duration<double>(now - mLastReport).count();
+
+  if (mDemux)
+    {
+      expire(now);
+    }
+  if (mOpts.interval.count() > 0)
+    {
+      std::cout << std::fixed << std::setprecision(1) << std::setw(6)
+                << std::chrono::duration<double>(now - mStart).count()
+                << "s  clients "
+                << ((mDemux) ? mDemux->size() : mClients.size())
+                << std::setprecision(0) << "  new/s "
+                << mInterval.accepted / secs;
+      std::cout << "  closed/s " << mInterval.closed / secs;
+      if (mDemux)
+        {
+          std::cout << "  dgrams/s in " << mInterval.datagramsIn / secs
+                    << " out " << mInterval.datagramsOut / secs;
+        }
+      std::cout << std::setprecision(2) << "  in "
+                << megabytes(mInterval.bytesIn, secs) << " MB/s  out "
+                << megabytes(mInterval.bytesOut, secs) << " MB/s";
+      if (mInterval.errors)
+        {
+          std::cout << "  errors " << mInterval.errors;
+        }
+      std::cout << std::endl;
+    }
+  mInterval = {};
+  mLastReport = now;
+  mReactor.schedule(mReportTimer, (mOpts.interval.count() > 0)
+                                    ? mOpts.interval
+                                    : std::chrono::seconds(1));
+}
+
+void LoadServer::expire(clock::time_point now)
+{
+  // Also a client's end, so counted as closed.
+  std::erase_if(mPeerSeen, [&](const auto &seen) {
+    if (now - seen.second < mOpts.idle)
+      {
+        return false;
+      }
+    LOG_DBG("Peer ", Socket::endpoint_to_string(seen.first), " idle");
+    mDemux->remove(seen.first);
+    mTotal.closed++;
+    mInterval.closed++;
+    return true;
+  });
+}
+
+void LoadServer::summary()
+{
+  const double secs =
+    std::chrono::duration<double>(clock::now() - mStart).count();
+
+  std::cout << std::fixed << std::setprecision(2) << "--- " << secs
+            << "s, " << mTotal.accepted << " clients, peak " << mPeak
+            << " concurrent, " << mTotal.closed << " closed" << std::endl;
+  if (mDemux)
+    {
+      std::cout << "datagrams in " << mTotal.datagramsIn << " out "
+                << mTotal.datagramsOut << std::endl;
+    }
+  std::cout << "bytes in " << mTotal.bytesIn << " ("
+            << megabytes(mTotal.bytesIn, secs) << " MB/s)  out "
+            << mTotal.bytesOut << " (" << megabytes(mTotal.bytesOut, secs)
+            << " MB/s)  errors " << mTotal.errors << std::endl;
+}
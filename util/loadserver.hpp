@@ -0,0 +1,134 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "epoll.hpp"
+#include "registry.hpp"
+#include "socket.hpp"
+#include "timerwheel.hpp"
+
+namespace Sukat
+{
+/** @brief Serves many clients from one event loop and reports throughput
+ *
+ * The counterpart of LoadGenerator. Stream clients, TCP or Unix, are
+ * accepted into a Registry and served by the Reactor. Datagram peers share
+ * the listening socket through SocketListenerUdpDemux, so thousands of them
+ * cost no extra fds.
+ */
+class LoadServer
+{
+ public:
+  enum class service
+  {
+    SERVICE_ECHO,    //!< Send everything back.
+    SERVICE_DISCARD, //!< Read and drop.
+    SERVICE_CHARGEN  //!< Send RFC 864 lines, drop what's read.
+  };
+
+  struct options
+  {
+    __socket_type type{SOCK_STREAM};
+    service mode{service::SERVICE_ECHO};
+    size_t size{0};                    //!< Chargen write or datagram, 0 auto.
+    std::chrono::seconds duration{0};  //!< 0 to run until stopped.
+    std::chrono::seconds interval{1};  //!< Between reports, 0 for none.
+    std::chrono::seconds idle{10};     //!< Datagram peers silent this long
+                                       //!< are forgotten.
+  };
+
+  /**
+   * @param src         End-point to listen on.
+   * @param opts        What to serve.
+   *
+   * @throw std::system_error If listening fails.
+   */
+  LoadServer(const Socket::endpoint &src, const options &opts);
+  ~LoadServer();
+
+  LoadServer(const LoadServer &) = delete;
+
+  /**
+   * @brief Serve until the duration ends or SIGINT/SIGTERM, print summary.
+   *
+   * @return 0 if any client was served.
+   */
+  int run();
+
+  Reactor &reactor()
+  {
+    return mReactor;
+  }
+
+ private:
+  class Client;
+  friend class Client;
+
+  using clock = std::chrono::steady_clock;
+
+  /** @brief Running totals, also kept per report interval */
+  struct counters
+  {
+    uint64_t accepted{0};
+    uint64_t closed{0};
+    uint64_t bytesOut{0};
+    uint64_t bytesIn{0};
+    uint64_t datagramsIn{0};
+    uint64_t datagramsOut{0};
+    uint64_t errors{0};
+  };
+
+  /** @brief Accept a burst, backing off on errors like EMFILE */
+  void accept();
+  void acceptBurst();
+  void receive();
+  void close(Client &client);
+  void received(size_t bytes);
+  void sent(size_t bytes);
+  void error();
+  void report();
+  void summary();
+
+  /** @brief Forget datagram peers idle longer than options::idle */
+  void expire(clock::time_point now);
+
+  /** @brief Next \p len chargen bytes from \p offset, which is advanced */
+  std::string_view chargen(size_t &offset, size_t len) const;
+
+  bool datagram() const
+  {
+    return mOpts.type == SOCK_DGRAM;
+  }
+
+  const options mOpts;
+  const size_t mChunk;        //!< Bytes per chargen write or datagram.
+  const std::string mPattern; //!< One chargen period plus a chunk.
+  std::filesystem::path mUnixPath; //!< Removed on exit, if not abstract.
+  std::unique_ptr<SocketListenerStream> mStream;
+  BufferPool mDgramPool{dgramMax, 32}; //!< Receive buffers of mDemux.
+  std::unique_ptr<SocketListenerUdpDemux> mDemux;
+  Reactor mReactor;
+  EventCallback<std::function<void(uint32_t)>> mListenerEvent;
+  Registry<Client> mClients;
+  std::optional<Fd> mSignalFd;
+  EventCallback<std::function<void(uint32_t)>> mSignalEvent;
+  counters mTotal, mInterval;
+  size_t mPeak{0};        //!< Most concurrent clients.
+  size_t mDgramOffset{0}; //!< Chargen position of datagram replies.
+  std::unordered_map<Socket::endpoint, clock::time_point,
+                     Socket::endpointHash, Socket::endpointEqual>
+    mPeerSeen; //!< Last datagram from each known peer.
+  clock::time_point mStart, mLastReport;
+  Timer mReportTimer;
+  Timer mEndTimer;
+  Timer mAcceptTimer; //!< Resumes accepting after a backoff.
+
+  static constexpr std::chrono::milliseconds acceptBackoff{10};
+  static constexpr size_t dgramMax = 65536; //!< Covers any datagram.
+};
+} // namespace Sukat
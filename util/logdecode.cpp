@@ -0,0 +1,45 @@
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "binlog.hpp"
+
+extern "C"
+{
+#include <stdlib.h>
+}
+
+using namespace Sukat;
+
+void usage(const std::string bin)
+{
+  std::cout << bin << ": Render a binary log as text." << std::endl;
+  std::cout << "Usage: " << bin << " <logfile>" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc != 2 || std::string(argv[1]) == "-h")
+    {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  std::ifstream in(argv[1], std::ios::binary);
+
+  if (!in)
+    {
+      std::cerr << "Failed to open " << argv[1] << std::endl;
+      return EXIT_FAILURE;
+    }
+  try
+    {
+      BinaryLog::decode(in, std::cout);
+    }
+  catch (std::runtime_error &e)
+    {
+      std::cerr << argv[1] << ": " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}